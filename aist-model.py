@@ -0,0 +1,84 @@
+# Writes AIST models in the format read by src/aist/model.cpp.
+# Converting raw weights of the original net:
+#   python aist-model.py weights.bin model.aist
+
+import struct
+import sys
+from array import array
+
+MAGIC = b'AIST'
+VERSION = 1
+NO_WEIGHTS = 0xFFFFFFFF
+DTYPE_FP32 = 1
+
+FROM_IMAGE = 1
+IN_2D = 2
+UP_CONV_32_T_3 = 3
+TO_IMAGE = 4
+# Weights of both halves, each: depthwise [9][64] (kernel index kx * 3 + ky), depthwise bias [64],
+# pointwise [64 out][64 in], then In2D [2][64].
+RESIDUAL_BLOCK_64 = 5
+# params: spatial divisor, in channels, out channels, groups, stride, reflect.
+# Weights [out][in / groups][3 * 3] (kernel index kx * 3 + ky), then bias [out], the first layer reads the image.
+GROUPED_CONV = 6
+
+
+def align_to_256(size):
+    return (size + 255) // 256 * 256
+
+
+def write_model(path, layers):
+    """layers: list of (type, params, weights), weights is (shape, flat list of floats) or None."""
+    tensors = []
+    data = bytearray()
+    layer_table = bytearray()
+    for layer_type, params, weights in layers:
+        index = NO_WEIGHTS
+        if weights is not None:
+            shape, values = weights
+            values = array('f', values)
+            if sys.byteorder != 'little':
+                values.byteswap()
+            data.extend(b'\0' * (align_to_256(len(data)) - len(data)))
+            index = len(tensors)
+            nbytes = len(values) * values.itemsize
+            tensors.append(struct.pack('<6I2Q', DTYPE_FP32, len(shape), *shape, *[0] * (4 - len(shape)), len(data), nbytes))
+            data.extend(values.tobytes())
+        params = list(params) + [0] * (6 - len(params))
+        layer_table.extend(struct.pack('<8I', layer_type, index, *params))
+    data_offset = align_to_256(32 + len(layer_table) + 40 * len(tensors))
+    with open(path, 'wb') as file:
+        file.write(struct.pack('<4s3I2Q', MAGIC, VERSION, len(layers), len(tensors), data_offset, len(data)))
+        file.write(layer_table)
+        file.write(b''.join(tensors))
+        file.write(b'\0' * (data_offset - file.tell()))
+        file.write(data)
+
+
+def convert_raw(raw_path, path):
+    raw = array('f')
+    with open(raw_path, 'rb') as file:
+        raw.frombytes(file.read())
+    if sys.byteorder != 'little':
+        raw.byteswap()
+    offset = 0
+
+    def take(*shape):
+        nonlocal offset
+        count = 1
+        for dim in shape:
+            count *= dim
+        tensor = (list(shape), raw[offset:offset + count])
+        offset = align_to_256((offset + count) * 4) // 4
+        return tensor
+
+    write_model(path, [
+        (FROM_IMAGE, [], take(32, 3, 3, 3)),
+        (IN_2D, [2, 32, 1], take(2, 32)),
+        (UP_CONV_32_T_3, [], take(32 * 3 * 3 * 3 + 3)),
+        (TO_IMAGE, [], None),
+    ])
+
+
+if __name__ == '__main__':
+    convert_raw(sys.argv[1], sys.argv[2])
@@ -1,46 +1,106 @@
+#include <cmath>
 #include "fromimage_layer.hpp"
 
 const uint32_t code[] = {
 #include "aist/from_image.comp.h"
 };
 
+const uint32_t fp16Code[] = {
+#include "aist/from_image.comp.fp16.h"
+};
+
+const uint32_t directCode[] = {
+#include "aist/from_image_direct.comp.h"
+};
+
+const uint32_t directFp16Code[] = {
+#include "aist/from_image_direct.comp.fp16.h"
+};
+
+vkBasalt::aist::TensorId vkBasalt::aist::FromImageLayer::planTensors(TensorPlanner *planner, TensorId input) {
+    outputTensor = planner->createTensor((imageExtent.width / 2 * (imageExtent.height / 2) * 32) * tensorElementSize());
+    if (pStatsConsumer != nullptr) {
+        statsTensor = pStatsConsumer->planStatistics(planner);
+    }
+    return outputTensor;
+}
+
 void vkBasalt::aist::FromImageLayer::createLayout(DsCounterHolder *counters) {
-    Layer::createLayout(true);
+    //The tiled shader declares the statistics binding even when it doesn't write it.
+    Layer::createLayout(true, tiled ? 2 : 1);
     counters->images += chainCount;
     counters->uniforms++;
-    counters->intermediates += chainCount;
+    counters->intermediates += chainCount * (tiled ? 2 : 1);
 }
 
 void vkBasalt::aist::FromImageLayer::createPipeline() {
-    VkShaderModuleCreateInfo shaderCreateInfo{
-            .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO, .pNext = nullptr,
-            .flags = 0,
-            .codeSize = sizeof(code), .pCode = code
+    if (!tiled) {
+        createComputeModule(directCode, sizeof(directCode), directFp16Code, sizeof(directFp16Code));
+        Layer::createPipeline();
+        return;
+    }
+    createComputeModule(code, sizeof(code), fp16Code, sizeof(fp16Code));
+    createPipelineLayout();
+
+    struct {
+        uint32_t width;
+        uint32_t height;
+        VkBool32 stats;
+    } specialization{imageExtent.width, imageExtent.height, pStatsConsumer != nullptr};
+    uint32_t constIdx = 0;
+    VkSpecializationMapEntry specEntries[]{
+            {.constantID = constIdx++, .offset=offsetof(decltype(specialization), width), .size=sizeof(uint32_t)},
+            {.constantID = constIdx++, .offset=offsetof(decltype(specialization), height), .size=sizeof(uint32_t)},
+            {.constantID = constIdx++, .offset=offsetof(decltype(specialization), stats), .size=sizeof(VkBool32)},
     };
-    VkResult result = pLogicalDevice->vkd.CreateShaderModule(
-            pLogicalDevice->device,
-            &shaderCreateInfo,
-            nullptr,
-            &computeModule
-    );
-    ASSERT_VULKAN(result)
-    Layer::createPipeline();
+    VkSpecializationInfo specInfo{
+            .mapEntryCount = constIdx, .pMapEntries = specEntries,
+            .dataSize = sizeof(specialization), .pData = &specialization,
+    };
+    createComputePipeline(specInfo);
+}
+
+void vkBasalt::aist::FromImageLayer::fuseStatistics(In2D *pStatsConsumer) {
+    if (!tiled) {
+        Logger::err("AIST: only the tiled FromImage kernel can produce statistics");
+        return;
+    }
+    this->pStatsConsumer = pStatsConsumer;
+}
+
+uint32_t vkBasalt::aist::FromImageLayer::workgroupCount() const {
+    return (uint32_t) std::ceil(imageExtent.width / imageSizeProportion)
+           * (uint32_t) std::ceil(imageExtent.height / imageSizeProportion);
 }
 
-vkBasalt::aist::FromImageLayer::FromImageLayer(LogicalDevice *pDevice, VkExtent2D extent2D, uint32_t chainCount)
-        : Layer(pDevice, extent2D, chainCount) {
-    depth = 8;
-    imageSizeProportion = 8.0;
+vkBasalt::aist::FromImageLayer::FromImageLayer(
+        LogicalDevice *pDevice,
+        VkExtent2D extent2D,
+        uint32_t chainCount,
+        TensorPrecision precision,
+        bool tiled
+) : Layer(pDevice, extent2D, chainCount, precision), tiled(tiled) {
+    if (tiled) {
+        //8 × 8 outputs with stride 2 per workgroup, all channels at once.
+        depth = 1;
+        imageSizeProportion = 16.0;
+    } else {
+        depth = 8;
+        imageSizeProportion = 8.0;
+    }
 }
 
 void vkBasalt::aist::FromImageLayer::writeSets(DsWriterHolder holder, uint32_t chainIdx) {
-    VkWriteDescriptorSet writes[] = {*holder.weights, *holder.inImage, *holder.intermediate};
+    VkWriteDescriptorSet writes[] = {*holder.weights, *holder.inImage, *holder.intermediate, *holder.intermediate};
     auto pWeightsInfo = const_cast<VkDescriptorBufferInfo *>(holder.weights->pBufferInfo);
     pWeightsInfo->range = alignTo256Bytes((32 * 3 * 3 * 3) * 4);
     writes[0].dstSet = commonDescriptorSet;
-    auto pOutInfo = const_cast<VkDescriptorBufferInfo *>(holder.intermediate->pBufferInfo);
-    pOutInfo->offset = 0;
-    pOutInfo->range = alignTo256Bytes((imageExtent.width / 2 * (imageExtent.height / 2) * 32) * 4);
-    writes[2].dstSet = writes[1].dstSet = perChainDescriptorSets[chainIdx];
-    Layer::writeSets(std::size(writes), writes);
+    VkDescriptorBufferInfo outInfo = tensorBufferInfo(holder, outputTensor);
+    writes[2].pBufferInfo = &outInfo;
+    //Without fusion nothing is written there, the output tensor just keeps the descriptor valid.
+    VkDescriptorBufferInfo statsInfo = tensorBufferInfo(holder, pStatsConsumer != nullptr ? statsTensor : outputTensor);
+    writes[3].pBufferInfo = &statsInfo;
+    writes[3].dstBinding = 2;
+    writes[3].dstSet = writes[2].dstSet = writes[1].dstSet = perChainDescriptorSets[chainIdx];
+    Layer::writeSets(tiled ? 4 : 3, writes);
 }
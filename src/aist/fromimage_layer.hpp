@@ -1,11 +1,20 @@
 #pragma once
 
 #include "nn_layer.h"
+#include "in_2d_layer.hpp"
 
 namespace vkBasalt::aist {
     class FromImageLayer : public Layer {
     public:
-        FromImageLayer(LogicalDevice *pDevice, VkExtent2D extent2D, uint32_t chainCount);
+        FromImageLayer(
+                LogicalDevice *pDevice,
+                VkExtent2D extent2D,
+                uint32_t chainCount,
+                TensorPrecision precision,
+                bool tiled = true
+        );
+
+        TensorId planTensors(TensorPlanner *planner, TensorId input) override;
 
         void createLayout(DsCounterHolder *counters) override;
 
@@ -13,5 +22,15 @@ namespace vkBasalt::aist {
 
         void createPipeline() override;
 
+        //Makes the tiled kernel write partial statistics of its output for the given In2D.
+        void fuseStatistics(In2D *pStatsConsumer);
+
+        uint32_t workgroupCount() const;
+
+    protected:
+        //Tiled kernel shares the input tile and weights across a workgroup, direct one reads them per channel.
+        bool tiled;
+        In2D *pStatsConsumer = nullptr;
+        TensorId statsTensor = 0;
      };
 }
\ No newline at end of file
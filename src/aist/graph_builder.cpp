@@ -0,0 +1,218 @@
+#include "graph_builder.hpp"
+
+#include "fromimage_layer.hpp"
+#include "grouped_conv_layer.hpp"
+#include "in_2d_layer.hpp"
+#include "up_conv_32_3_layer.hpp"
+#include "to_image_layer.hpp"
+#include "residual_block_layer.hpp"
+
+//Shape of a GroupedConv model layer, the first layer of the graph reads the image.
+static vkBasalt::aist::GroupedConvLayer::Shape groupedConvShape(const vkBasalt::aist::LayerDesc &desc, bool imageInput) {
+    return {
+            .imageInput = imageInput,
+            .spatialDivisor = desc.params[0],
+            .inChannels = desc.params[1],
+            .outChannels = desc.params[2],
+            .groups = desc.params[3],
+            .stride = desc.params[4],
+            .reflect = desc.params[5] != 0,
+    };
+}
+
+//What a layer reads or writes: the image at full resolution or a tensor spatialDivisor times smaller than it.
+struct TensorShape {
+    uint32_t channels;
+    uint32_t spatialDivisor;
+};
+
+//The first layer reads the image and the last one writes it.
+static const TensorShape imageShape{.channels = 3, .spatialDivisor = 1};
+
+//Parameters come straight from the model file. Rejects layers whose shader would divide by zero or never finish
+//choosing a workgroup size, and layers that don't read the shape the layer before writes, their shaders would index
+//past its tensor.
+static bool checkLayer(
+        const vkBasalt::aist::LayerDesc &desc,
+        uint32_t idx,
+        uint32_t layerCount,
+        TensorShape input,
+        TensorShape &output
+) {
+    using vkBasalt::aist::LayerType;
+    auto reject = [idx](const std::string &reason) {
+        vkBasalt::Logger::err("AIST: layer " + std::to_string(idx) + " " + reason);
+        return false;
+    };
+    auto checkChannels = [&reject](uint32_t channels) {
+        if (channels == 0 || channels % 4 != 0) {
+            return reject("has " + std::to_string(channels) + " channels, expected a non-zero multiple of 4");
+        }
+        return true;
+    };
+    TensorShape expected;
+    switch (desc.type) {
+        case LayerType::FromImage:
+            expected = imageShape;
+            output = {.channels = 32, .spatialDivisor = 2};
+            break;
+        case LayerType::In2D:
+            if (desc.params[0] == 0) {
+                return reject("has a spatial divisor of 0");
+            }
+            if (!checkChannels(desc.params[1])) {
+                return false;
+            }
+            expected = output = {.channels = desc.params[1], .spatialDivisor = desc.params[0]};
+            break;
+        case LayerType::UpConv32t3:
+            expected = {.channels = 32, .spatialDivisor = 2};
+            output = imageShape;
+            break;
+        case LayerType::ToImage:
+            expected = output = imageShape;
+            break;
+        case LayerType::ResidualBlock64:
+            if (desc.params[0] == 0) {
+                return reject("has a spatial divisor of 0");
+            }
+            expected = output = {.channels = 64, .spatialDivisor = desc.params[0]};
+            break;
+        case LayerType::GroupedConv: {
+            auto shape = groupedConvShape(desc, idx == 0);
+            if (shape.spatialDivisor == 0 || shape.groups == 0 || shape.stride == 0) {
+                return reject("has a spatial divisor, group count or stride of 0");
+            }
+            if (shape.imageInput) {
+                if (shape.inChannels != imageShape.channels || shape.spatialDivisor != 1) {
+                    return reject("reads the image, it needs 3 input channels and a spatial divisor of 1");
+                }
+            } else if (!checkChannels(shape.inChannels)) {
+                return false;
+            }
+            if (!checkChannels(shape.outChannels)) {
+                return false;
+            }
+            if (shape.inChannels % shape.groups != 0 || shape.outChannels % shape.groups != 0) {
+                return reject("can't split its channels into " + std::to_string(shape.groups) + " groups");
+            }
+            if (shape.stride > 2) {
+                return reject("has a stride of " + std::to_string(shape.stride) + ", expected 1 or 2");
+            }
+            expected = {.channels = shape.inChannels, .spatialDivisor = shape.spatialDivisor};
+            output = {.channels = shape.outChannels, .spatialDivisor = shape.spatialDivisor * shape.stride};
+            break;
+        }
+        default:
+            return reject("has the unknown type " + std::to_string(uint32_t(desc.type)));
+    }
+    //Otherwise a layer would read a tensor nothing wrote, or the output image would never be written.
+    bool readsImage = desc.type == LayerType::FromImage || (desc.type == LayerType::GroupedConv && idx == 0);
+    if (readsImage != (idx == 0)) {
+        return reject(idx == 0 ? "has to read the image" : "reads the image, only the first layer can");
+    }
+    if ((desc.type == LayerType::ToImage) != (idx + 1 == layerCount)) {
+        return reject(desc.type == LayerType::ToImage ? "writes the image, only the last layer can" : "has to be a ToImage");
+    }
+    if (expected.channels != input.channels || expected.spatialDivisor != input.spatialDivisor) {
+        return reject(
+                "reads " + std::to_string(expected.channels) + " channels at 1/" + std::to_string(expected.spatialDivisor)
+                + " of the image size, but the layer before writes " + std::to_string(input.channels) + " at 1/"
+                + std::to_string(input.spatialDivisor)
+        );
+    }
+    return true;
+}
+
+//Number of fp32 weights the layer expects, checked against the model tensor.
+static uint64_t expectedWeights(const vkBasalt::aist::LayerDesc &desc) {
+    using vkBasalt::aist::LayerType;
+    switch (desc.type) {
+        case LayerType::FromImage:
+            return 32 * 3 * 3 * 3;
+        case LayerType::In2D:
+            return desc.params[1] * 2;
+        case LayerType::UpConv32t3:
+            return 32 * 3 * 3 * 3 + 3;
+        case LayerType::ToImage:
+            return 0;
+        case LayerType::ResidualBlock64:
+            return vkBasalt::aist::ResidualBlock64::weightsSize / 4;
+        case LayerType::GroupedConv:
+            return vkBasalt::aist::GroupedConvLayer::weightCount(groupedConvShape(desc, false));
+    }
+    return 0;
+}
+
+std::vector<std::unique_ptr<vkBasalt::aist::Layer>> vkBasalt::aist::buildGraph(
+        const Model &model,
+        const GraphOptions &options,
+        LogicalDevice *pLogicalDevice,
+        VkExtent2D imageExtent,
+        uint32_t chainCount
+) {
+    std::vector<std::unique_ptr<Layer>> layers;
+    const auto &descs = model.layers();
+    if (descs.empty()) {
+        Logger::err("AIST: model has no layers");
+        return {};
+    }
+    TensorShape shape = imageShape;
+    for (uint32_t i = 0; i < descs.size(); i++) {
+        const LayerDesc &desc = descs[i];
+        if (!checkLayer(desc, i, descs.size(), shape, shape)) {
+            return {};
+        }
+        uint64_t weightsSize = desc.weights == Model::noWeights ? 0 : model.tensors()[desc.weights].size;
+        if (weightsSize != expectedWeights(desc) * sizeof(float)) {
+            Logger::err(
+                    "AIST: layer " + std::to_string(i) + " has " + std::to_string(weightsSize) + " bytes of weights, expected "
+                    + std::to_string(expectedWeights(desc) * sizeof(float))
+            );
+            return {};
+        }
+        switch (desc.type) {
+            case LayerType::FromImage:
+                layers.emplace_back(new FromImageLayer(
+                        pLogicalDevice, imageExtent, chainCount, options.precision, options.tiledFromImage
+                ));
+                break;
+            case LayerType::In2D: {
+                auto pFromImage = dynamic_cast<FromImageLayer *>(layers.empty() ? nullptr : layers.back().get());
+                bool fuse = options.fuseStatistics && options.tiledFromImage && pFromImage != nullptr
+                            && desc.params[0] == 2 && desc.params[1] == 32;
+                auto pIn2D = new In2D(
+                        pLogicalDevice, imageExtent, chainCount, options.precision,
+                        desc.params[0], desc.params[1], desc.params[2] != 0,
+                        fuse ? pFromImage->workgroupCount() : 0
+                );
+                if (fuse) {
+                    pFromImage->fuseStatistics(pIn2D);
+                }
+                layers.emplace_back(pIn2D);
+                break;
+            }
+            case LayerType::UpConv32t3:
+                layers.emplace_back(new UpConv32t3(pLogicalDevice, imageExtent, chainCount, options.precision));
+                break;
+            case LayerType::ToImage:
+                layers.emplace_back(new ToImageLayer(pLogicalDevice, imageExtent, chainCount, options.precision));
+                break;
+            case LayerType::ResidualBlock64:
+                layers.emplace_back(new ResidualBlock64(
+                        pLogicalDevice, imageExtent, chainCount, options.precision, desc.params[0]
+                ));
+                break;
+            case LayerType::GroupedConv:
+                layers.emplace_back(new GroupedConvLayer(
+                        pLogicalDevice, imageExtent, chainCount, options.precision,
+                        groupedConvShape(desc, layers.empty())
+                ));
+                break;
+            default:
+                Logger::err("AIST: unknown layer type " + std::to_string(uint32_t(desc.type)));
+                return {};
+        }
+    }
+    return layers;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "model.hpp"
+#include "nn_layer.h"
+
+namespace vkBasalt::aist {
+    struct GraphOptions {
+        TensorPrecision precision;
+        //Use the tiled kernel for FromImage layers.
+        bool tiledFromImage;
+        //Let a tiled FromImage produce statistics for the In2D right after it.
+        bool fuseStatistics;
+    };
+
+    //Instantiates layers of the model, one per model layer and in the same order.
+    //Returns no layers if the model describes something these layers can't run.
+    std::vector<std::unique_ptr<Layer>> buildGraph(
+            const Model &model,
+            const GraphOptions &options,
+            LogicalDevice *pLogicalDevice,
+            VkExtent2D imageExtent,
+            uint32_t chainCount
+    );
+}
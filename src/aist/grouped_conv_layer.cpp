@@ -0,0 +1,122 @@
+#include "grouped_conv_layer.hpp"
+
+const uint32_t code[] = {
+#include "aist/grouped_conv.comp.h"
+};
+
+const uint32_t fp16Code[] = {
+#include "aist/grouped_conv.comp.fp16.h"
+};
+
+const uint32_t imageCode[] = {
+#include "aist/grouped_conv_image.comp.h"
+};
+
+const uint32_t imageFp16Code[] = {
+#include "aist/grouped_conv_image.comp.fp16.h"
+};
+
+vkBasalt::aist::GroupedConvLayer::GroupedConvLayer(
+        LogicalDevice *pDevice,
+        VkExtent2D extent2D,
+        uint32_t chainCount,
+        TensorPrecision precision,
+        const Shape &shape
+) : Layer(pDevice, extent2D, chainCount, precision), shape(shape),
+    specialization{
+            .width = extent2D.width, .height = extent2D.height,
+            .spatialDivisor = shape.spatialDivisor,
+            .inChannels = shape.inChannels, .outChannels = shape.outChannels,
+            .groups = shape.groups, .stride = shape.stride,
+            .reflect = shape.reflect,
+    } {
+    if (shape.groups == 0 || shape.inChannels % shape.groups != 0 || shape.outChannels % shape.groups != 0) {
+        Logger::err(
+                "AIST GroupedConv: " + std::to_string(shape.inChannels) + " → " + std::to_string(shape.outChannels)
+                + " channels can't be split into " + std::to_string(shape.groups) + " groups"
+        );
+    }
+    if (shape.stride < 1 || shape.stride > 2) {
+        Logger::err("AIST GroupedConv: stride should be 1 or 2, got " + std::to_string(shape.stride));
+    }
+    if (shape.imageInput && (shape.inChannels != 3 || shape.spatialDivisor != 1)) {
+        Logger::err("AIST GroupedConv: image input has 3 channels at full resolution");
+    }
+    //8 × 8 outputs per workgroup, all channels at once.
+    imageSizeProportion = 8.0f * shape.spatialDivisor * shape.stride;
+}
+
+uint64_t vkBasalt::aist::GroupedConvLayer::weightCount(const Shape &shape) {
+    if (shape.groups == 0) {
+        return 0;
+    }
+    return uint64_t(shape.outChannels) * (shape.inChannels / shape.groups) * 3 * 3 + shape.outChannels;
+}
+
+vkBasalt::aist::TensorId vkBasalt::aist::GroupedConvLayer::planTensors(TensorPlanner *planner, TensorId input) {
+    if (!shape.imageInput) {
+        planner->useTensor(input);
+        inputTensor = input;
+    }
+    uint32_t divisor = shape.spatialDivisor * shape.stride;
+    outputTensor = planner->createTensor(
+            (imageExtent.width / divisor) * (imageExtent.height / divisor) * shape.outChannels * tensorElementSize()
+    );
+    return outputTensor;
+}
+
+void vkBasalt::aist::GroupedConvLayer::createLayout(DsCounterHolder *counters) {
+    Layer::createLayout(shape.imageInput, 1, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+    if (shape.imageInput) {
+        counters->images += chainCount;
+    }
+    counters->intermediates += 1 + chainCount * (shape.imageInput ? 1 : 2);
+}
+
+void vkBasalt::aist::GroupedConvLayer::createPipeline() {
+    if (shape.imageInput) {
+        createComputeModule(imageCode, sizeof(imageCode), imageFp16Code, sizeof(imageFp16Code));
+    } else {
+        createComputeModule(code, sizeof(code), fp16Code, sizeof(fp16Code));
+    }
+    createPipelineLayout();
+
+    uint32_t constIdx = 0;
+    VkSpecializationMapEntry specEntries[]{
+            {.constantID = constIdx++, .offset=offsetof(Specialization, width), .size=sizeof(Specialization::width)},
+            {.constantID = constIdx++, .offset=offsetof(Specialization, height), .size=sizeof(Specialization::height)},
+            {.constantID = constIdx++, .offset=offsetof(Specialization, spatialDivisor), .size=sizeof(Specialization::spatialDivisor)},
+            {.constantID = constIdx++, .offset=offsetof(Specialization, inChannels), .size=sizeof(Specialization::inChannels)},
+            {.constantID = constIdx++, .offset=offsetof(Specialization, outChannels), .size=sizeof(Specialization::outChannels)},
+            {.constantID = constIdx++, .offset=offsetof(Specialization, groups), .size=sizeof(Specialization::groups)},
+            {.constantID = constIdx++, .offset=offsetof(Specialization, stride), .size=sizeof(Specialization::stride)},
+            {.constantID = constIdx++, .offset=offsetof(Specialization, reflect), .size=sizeof(Specialization::reflect)},
+    };
+    VkSpecializationInfo specInfo{
+            .mapEntryCount = constIdx, .pMapEntries = specEntries,
+            .dataSize = sizeof(specialization), .pData = &specialization,
+    };
+    createComputePipeline(specInfo);
+}
+
+void vkBasalt::aist::GroupedConvLayer::writeSets(DsWriterHolder holder, uint32_t chainIdx) {
+    VkWriteDescriptorSet writes[] = {
+            *holder.weights,
+            shape.imageInput ? *holder.inImage : *holder.intermediate,
+            *holder.intermediate,
+    };
+    auto pWeightsInfo = const_cast<VkDescriptorBufferInfo *>(holder.weights->pBufferInfo);
+    pWeightsInfo->range = weightCount(shape) * 4;
+    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writes[0].dstSet = commonDescriptorSet;
+    VkDescriptorBufferInfo inInfo = tensorBufferInfo(holder, inputTensor);
+    if (!shape.imageInput) {
+        writes[1].pBufferInfo = &inInfo;
+    }
+    writes[1].dstBinding = 0;
+    VkDescriptorBufferInfo outInfo = tensorBufferInfo(holder, outputTensor);
+    writes[2].pBufferInfo = &outInfo;
+    writes[2].dstBinding = 1;
+    writes[2].dstSet = writes[1].dstSet = perChainDescriptorSets[chainIdx];
+    Layer::writeSets(std::size(writes), writes);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "nn_layer.h"
+
+namespace vkBasalt::aist {
+    //Strided grouped 3 × 3 convolution with bias, every shape runs the same specialized kernel.
+    class GroupedConvLayer : public Layer {
+    public:
+        struct Shape {
+            //Reads the input image instead of a tensor, inChannels must be 3 and spatialDivisor 1.
+            bool imageInput;
+            //Input tensor is this many times smaller than the image.
+            uint32_t spatialDivisor;
+            uint32_t inChannels;
+            uint32_t outChannels;
+            uint32_t groups;
+            //1 or 2.
+            uint32_t stride;
+            //Reflect padding, otherwise clamp to edge.
+            bool reflect;
+        };
+
+        GroupedConvLayer(
+                LogicalDevice *pDevice,
+                VkExtent2D extent2D,
+                uint32_t chainCount,
+                TensorPrecision precision,
+                const Shape &shape
+        );
+
+        //Weights are [outChannels][inChannels / groups][3 × 3], followed by [outChannels] biases.
+        static uint64_t weightCount(const Shape &shape);
+
+        TensorId planTensors(TensorPlanner *planner, TensorId input) override;
+
+        void createLayout(DsCounterHolder *counters) override;
+
+        void createPipeline() override;
+
+        void writeSets(DsWriterHolder holder, uint32_t chainIdx) override;
+
+    private:
+        const Shape shape;
+
+        struct Specialization {
+            uint32_t width;
+            uint32_t height;
+            uint32_t spatialDivisor;
+            uint32_t inChannels;
+            uint32_t outChannels;
+            uint32_t groups;
+            uint32_t stride;
+            VkBool32 reflect;
+        } specialization;
+    };
+}
@@ -1,28 +1,108 @@
 #include <cmath>
+#include <algorithm>
+#include <limits>
 #include "in_2d_layer.hpp"
 
 const uint32_t code[] = {
 #include "aist/in_2d.comp.h"
 };
 
-vkBasalt::aist::In2D::Specialization::Specialization(VkExtent2D extent2D, uint32_t spatialDivisor, uint32_t channels)
-    : width(extent2D.width), height(extent2D.height), spatialDivisor(spatialDivisor), channels(channels) {}
+const uint32_t fp16Code[] = {
+#include "aist/in_2d.comp.fp16.h"
+};
+
+//Should match MAX_INVOCATIONS in the shader.
+static const uint32_t maxInvocations = 256;
+//Upper bound for partial statistics the finalizing workgroup goes through.
+static const uint32_t maxReduceGroups = 1024;
+//Pixels every reducing invocation should accumulate at least before it's worth another workgroup.
+static const uint32_t pixelsPerInvocation = 16;
+
+vkBasalt::aist::In2D::Specialization::Specialization(
+        VkExtent2D extent2D,
+        uint32_t spatialDivisor,
+        uint32_t channels,
+        bool relu,
+        uint32_t fusedGroups,
+        bool residual
+) : width(extent2D.width), height(extent2D.height), spatialDivisor(spatialDivisor), channels(channels),
+    quads(channels / 4), rows(1), reduceGroups(1), relu(relu), residual(residual), mergeGroups(0) {
+    if (channels % 4 != 0) {
+        Logger::err("AIST In2D: channels should be a multiple of 4, got " + std::to_string(channels));
+    }
+    while (quads * rows * 2 <= maxInvocations) {
+        rows *= 2;
+    }
+    if (fusedGroups > 0) {
+        //Every workgroup of the producing convolution leaves its own partial statistics.
+        //They are merged from its fp32 results, while the stored tensor may be fp16,
+        //so fused scale and shift differ from unfused ones by the rounding of the tensor.
+        reduceGroups = fusedGroups;
+        if (fusedGroups > maxReduceGroups) {
+            //Thousands of tiles at 1080p and above, merge them in chunks before finalization.
+            uint32_t chunk = (fusedGroups + maxReduceGroups - 1) / maxReduceGroups;
+            mergeGroups = (fusedGroups + chunk - 1) / chunk;
+        }
+        return;
+    }
+    uint32_t pixels = (height / spatialDivisor) * (width / spatialDivisor);
+    uint32_t pixelsPerGroup = rows * pixelsPerInvocation;
+    reduceGroups = std::clamp((pixels + pixelsPerGroup - 1) / pixelsPerGroup, 1u, maxReduceGroups);
+}
 
 vkBasalt::aist::In2D::In2D(
         LogicalDevice *pDevice,
         VkExtent2D extent2D,
         uint32_t chainCount,
+        TensorPrecision precision,
         uint32_t spatialDivisor,
-        uint32_t channels
-) : Layer(pDevice, extent2D, chainCount), specialization(extent2D, spatialDivisor, channels) {
+        uint32_t channels,
+        bool relu,
+        uint32_t fusedGroups,
+        bool residual
+) : Layer(pDevice, extent2D, chainCount, precision),
+    specialization(extent2D, spatialDivisor, channels, relu, fusedGroups, residual), fused(fusedGroups > 0) {
     imageSizeProportion = spatialDivisor;
     depth = 1;
 }
 
+VkDeviceSize vkBasalt::aist::In2D::statsSize() const {
+    // shift + scale, partial means + M2 and partial counts, then as much for merged partials; all are vec4.
+    return alignTo256Bytes(
+            (specialization.quads * 2
+             + (specialization.reduceGroups + specialization.mergeGroups) * (specialization.quads * 2 + 1)) * 4 * 4
+    );
+}
+
+vkBasalt::aist::TensorId vkBasalt::aist::In2D::planTensors(TensorPlanner *planner, TensorId input) {
+    planner->useTensor(input);
+    //Normalization happens in place, only statistics need memory of their own.
+    if (fused) {
+        planner->useTensor(statsTensor);
+    } else {
+        statsTensor = planner->createTensor(statsSize());
+    }
+    inputTensor = outputTensor = input;
+    if (specialization.residual) {
+        planner->useTensor(residualTensor);
+        outputTensor = residualTensor;
+    }
+    return outputTensor;
+}
+
+void vkBasalt::aist::In2D::setResidualTensor(TensorId tensor) {
+    residualTensor = tensor;
+}
+
+vkBasalt::aist::TensorId vkBasalt::aist::In2D::planStatistics(TensorPlanner *planner) {
+    statsTensor = planner->createTensor(statsSize());
+    return statsTensor;
+}
+
 void vkBasalt::aist::In2D::createLayout(DsCounterHolder *counters) {
-    Layer::createLayout(false);
+    Layer::createLayout(false, 2);
     counters->uniforms++;
-    counters->intermediates += chainCount * 2;
+    counters->intermediates += chainCount * 3;
 }
 
 void vkBasalt::aist::In2D::createPipelineLayout() {
@@ -54,18 +134,7 @@ void vkBasalt::aist::In2D::createPipelineLayout() {
 }
 
 void vkBasalt::aist::In2D::createPipeline() {
-    VkShaderModuleCreateInfo shaderCreateInfo{
-            .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO, .pNext = nullptr,
-            .flags = 0,
-            .codeSize = sizeof(code), .pCode = code
-    };
-    VkResult result = pLogicalDevice->vkd.CreateShaderModule(
-            pLogicalDevice->device,
-            &shaderCreateInfo,
-            nullptr,
-            &computeModule
-    );
-    ASSERT_VULKAN(result)
+    createComputeModule(code, sizeof(code), fp16Code, sizeof(fp16Code));
 
     createPipelineLayout();
 
@@ -75,72 +144,40 @@ void vkBasalt::aist::In2D::createPipeline() {
             {.constantID = constIdx++, .offset=offsetof(Specialization, height), .size=sizeof(Specialization::height)},
             {.constantID = constIdx++, .offset=offsetof(Specialization, spatialDivisor), .size=sizeof(Specialization::spatialDivisor)},
             {.constantID = constIdx++, .offset=offsetof(Specialization, channels), .size=sizeof(Specialization::channels)},
+            {.constantID = constIdx++, .offset=offsetof(Specialization, quads), .size=sizeof(Specialization::quads)},
+            {.constantID = constIdx++, .offset=offsetof(Specialization, rows), .size=sizeof(Specialization::rows)},
+            {.constantID = constIdx++, .offset=offsetof(Specialization, reduceGroups), .size=sizeof(Specialization::reduceGroups)},
+            {.constantID = constIdx++, .offset=offsetof(Specialization, relu), .size=sizeof(Specialization::relu)},
+            {.constantID = constIdx++, .offset=offsetof(Specialization, residual), .size=sizeof(Specialization::residual)},
+            {.constantID = constIdx++, .offset=offsetof(Specialization, mergeGroups), .size=sizeof(Specialization::mergeGroups)},
     };
     VkSpecializationInfo specInfo{
             .mapEntryCount = constIdx, .pMapEntries = specEntries,
             .dataSize = sizeof(specialization), .pData = &specialization,
     };
-    VkComputePipelineCreateInfo computePipelineCreateInfo{
-            .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
-            .pNext = nullptr,
-            .flags = 0,
-            .stage = {
-                    .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, .pNext = nullptr,
-                    .flags = 0,
-                    .stage = VK_SHADER_STAGE_COMPUTE_BIT,
-                    .module = computeModule, .pName = "main",
-                    .pSpecializationInfo = &specInfo,
-            },
-            .layout = pipelineLayout,
-            .basePipelineHandle = VK_NULL_HANDLE,
-            .basePipelineIndex = -1,
-    };
-
-    result = pLogicalDevice->vkd.CreateComputePipelines(
-            pLogicalDevice->device,
-            VK_NULL_HANDLE,
-            1,
-            &computePipelineCreateInfo,
-            nullptr,
-            &computePipeline
-    );
-    ASSERT_VULKAN(result)
+    createComputePipeline(specInfo);
 }
 
 void vkBasalt::aist::In2D::writeSets(DsWriterHolder holder, uint32_t chainIdx) {
-    VkWriteDescriptorSet writes[] = {*holder.weights, *holder.intermediate, *holder.intermediate};
+    VkWriteDescriptorSet writes[] = {*holder.weights, *holder.intermediate, *holder.intermediate, *holder.intermediate};
     auto pWeightsInfo = const_cast<VkDescriptorBufferInfo *>(holder.weights->pBufferInfo);
-    uint32_t weightsSize = alignTo256Bytes(specialization.channels * 2 * 4);
-    pWeightsInfo->range = weightsSize;
+    pWeightsInfo->range = alignTo256Bytes(specialization.channels * 2 * 4);
     writes[0].dstSet = commonDescriptorSet;
     //We're modifying values in place.
+    VkDescriptorBufferInfo tensorInfo = tensorBufferInfo(holder, inputTensor);
+    writes[1].pBufferInfo = &tensorInfo;
     writes[1].dstBinding = 0;
-    //But also need a small one to store stats;
-    VkDescriptorBufferInfo statsBufferInfo = *holder.intermediate->pBufferInfo;
-    statsBufferInfo.range = weightsSize;
-    statsBufferInfo.offset = statsBufferInfo.offset == 0
-            ? weightsSize
-            : (statsBufferInfo.offset - weightsSize);
-    writes[2].pBufferInfo = &statsBufferInfo;
-    writes[2].dstSet = writes[1].dstSet = perChainDescriptorSets[chainIdx];
+    VkDescriptorBufferInfo statsInfo = tensorBufferInfo(holder, statsTensor);
+    writes[2].pBufferInfo = &statsInfo;
+    //Without a residual the shader doesn't touch it, the input keeps the descriptor valid.
+    VkDescriptorBufferInfo residualInfo = tensorBufferInfo(holder, specialization.residual ? residualTensor : inputTensor);
+    writes[3].pBufferInfo = &residualInfo;
+    writes[3].dstBinding = 2;
+    writes[3].dstSet = writes[2].dstSet = writes[1].dstSet = perChainDescriptorSets[chainIdx];
     Layer::writeSets(std::size(writes), writes);
 }
 
-void vkBasalt::aist::In2D::appendCommands(VkCommandBuffer commandBuffer, uint32_t chainIdx,
-                                          VkBufferMemoryBarrier *bufferBarrierDto) {
-    uint32_t substage = 0;
-    pLogicalDevice->vkd.CmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
-    VkDescriptorSet sets[]{
-            commonDescriptorSet,
-            perChainDescriptorSets[chainIdx],
-    };
-    pLogicalDevice->vkd.CmdBindDescriptorSets(
-            commandBuffer,
-            VK_PIPELINE_BIND_POINT_COMPUTE,
-            pipelineLayout, 0,
-            std::size(sets), sets,
-            0, nullptr
-    );
+void vkBasalt::aist::In2D::dispatchSubstage(VkCommandBuffer commandBuffer, uint32_t substage, uint32_t groupCount) {
     pLogicalDevice->vkd.CmdPushConstants(
             commandBuffer,
             pipelineLayout,
@@ -148,23 +185,16 @@ void vkBasalt::aist::In2D::appendCommands(VkCommandBuffer commandBuffer, uint32_
             sizeof(substage),
             &substage
     );
-    pLogicalDevice->vkd.CmdDispatch(
-            commandBuffer,
-            1,
-            1,
-            depth
-    );
-    pLogicalDevice->vkd.CmdPipelineBarrier(
-            commandBuffer,
-            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-            0,
-            0, nullptr,
-            1, bufferBarrierDto,
-            0, nullptr
-    );
-    substage += 0;
+    pLogicalDevice->vkd.CmdDispatch(commandBuffer, groupCount, 1, 1);
+}
+
+void vkBasalt::aist::In2D::appendCommands(VkCommandBuffer commandBuffer, uint32_t chainIdx,
+                                          VkBufferMemoryBarrier *bufferBarrierDto) {
     pLogicalDevice->vkd.CmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
+    VkDescriptorSet sets[]{
+            commonDescriptorSet,
+            perChainDescriptorSets[chainIdx],
+    };
     pLogicalDevice->vkd.CmdBindDescriptorSets(
             commandBuffer,
             VK_PIPELINE_BIND_POINT_COMPUTE,
@@ -172,17 +202,32 @@ void vkBasalt::aist::In2D::appendCommands(VkCommandBuffer commandBuffer, uint32_
             std::size(sets), sets,
             0, nullptr
     );
-    pLogicalDevice->vkd.CmdPushConstants(
-            commandBuffer,
-            pipelineLayout,
-            VK_SHADER_STAGE_COMPUTE_BIT, 0,
-            sizeof(substage),
-            &substage
-    );
-    pLogicalDevice->vkd.CmdDispatch(
-            commandBuffer,
-            (uint32_t) std::ceil(imageExtent.width / imageSizeProportion),
-            (uint32_t) std::ceil(imageExtent.height / imageSizeProportion),
-            depth
+    uint32_t pixels = (imageExtent.height / specialization.spatialDivisor) * (imageExtent.width / specialization.spatialDivisor);
+    uint32_t invocations = specialization.quads * specialization.rows;
+    uint32_t normalizeGroups = std::min(
+            (pixels * specialization.quads + invocations - 1) / invocations,
+            (uint32_t) std::numeric_limits<uint16_t>::max()
     );
+    uint32_t groupCounts[]{specialization.reduceGroups, specialization.mergeGroups, 1, normalizeGroups};
+    //Fused statistics are already there, only finalization and normalization remain.
+    uint32_t firstSubstage = fused ? 1 : 0;
+    bool dispatched = false;
+    for (uint32_t substage = firstSubstage; substage < std::size(groupCounts); substage++) {
+        if (groupCounts[substage] == 0) {
+            continue;
+        }
+        if (dispatched) {
+            pLogicalDevice->vkd.CmdPipelineBarrier(
+                    commandBuffer,
+                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                    0,
+                    0, nullptr,
+                    1, bufferBarrierDto,
+                    0, nullptr
+            );
+        }
+        dispatchSubstage(commandBuffer, substage, groupCounts[substage]);
+        dispatched = true;
+    }
 }
@@ -5,7 +5,25 @@
 namespace vkBasalt::aist {
     class In2D : public Layer {
     public:
-        In2D(LogicalDevice *pDevice, VkExtent2D extent2D, uint32_t chainCount, uint32_t spatialDivisor, uint32_t channels);
+        In2D(
+                LogicalDevice *pDevice,
+                VkExtent2D extent2D,
+                uint32_t chainCount,
+                TensorPrecision precision,
+                uint32_t spatialDivisor,
+                uint32_t channels,
+                bool relu = true,
+                uint32_t fusedGroups = 0,
+                bool residual = false
+        );
+
+        //With residual, the normalized input is added in place to this tensor, which becomes the output.
+        void setResidualTensor(TensorId tensor);
+
+        //The producing convolution calls it while planning its own tensors, when statistics are fused.
+        TensorId planStatistics(TensorPlanner *planner);
+
+        TensorId planTensors(TensorPlanner *planner, TensorId input) override;
 
         void createLayout(DsCounterHolder *counters) override;
 
@@ -19,13 +37,36 @@ namespace vkBasalt::aist {
     protected:
         void createPipelineLayout() override;
 
+        void dispatchSubstage(VkCommandBuffer commandBuffer, uint32_t substage, uint32_t groupCount);
+
         const struct Specialization {
-            Specialization(VkExtent2D extent2D, uint32_t spatialDivisor, uint32_t channels);
+            Specialization(
+                    VkExtent2D extent2D,
+                    uint32_t spatialDivisor,
+                    uint32_t channels,
+                    bool relu,
+                    uint32_t fusedGroups,
+                    bool residual
+            );
 
             uint32_t width;
             uint32_t height;
             uint32_t spatialDivisor;
             uint32_t channels;
+            uint32_t quads;
+            uint32_t rows;
+            uint32_t reduceGroups;
+            VkBool32 relu;
+            VkBool32 residual;
+            //Partials are first merged into this many when there are too many to finalize at once, 0 skips merging.
+            uint32_t mergeGroups;
         } specialization;
+
+        //Partial statistics come from the previous layer, the first substage is skipped.
+        const bool fused;
+        TensorId statsTensor = 0;
+        TensorId residualTensor = 0;
+
+        VkDeviceSize statsSize() const;
     };
 }
@@ -0,0 +1,178 @@
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include "model.hpp"
+#include "nn_layer.h"
+
+namespace {
+    struct FileHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t layerCount;
+        uint32_t tensorCount;
+        uint64_t dataOffset;
+        uint64_t dataSize;
+    };
+    static_assert(sizeof(FileHeader) == 32);
+
+    struct FileLayer {
+        uint32_t type;
+        uint32_t weights;
+        uint32_t params[6];
+    };
+    static_assert(sizeof(FileLayer) == 32);
+
+    struct FileTensor {
+        uint32_t dtype;
+        uint32_t rank;
+        uint32_t shape[4];
+        uint64_t offset;
+        uint64_t size;
+    };
+    static_assert(sizeof(FileTensor) == 40);
+}
+
+bool vkBasalt::aist::Model::load(const std::string &fileName) {
+    std::ifstream file(fileName, std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+        Logger::err("AIST: can't open model " + fileName);
+        return false;
+    }
+    std::vector<char> contents{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    if (contents.size() < sizeof(magic) || std::memcmp(contents.data(), magic, sizeof(magic)) != 0) {
+        Logger::info("AIST: " + fileName + " has no model header, loading it as raw weights");
+        parseLegacy(std::move(contents));
+        return true;
+    }
+    return parse(contents);
+}
+
+bool vkBasalt::aist::Model::parse(const std::vector<char> &file) {
+    FileHeader header;
+    if (file.size() < sizeof(header)) {
+        Logger::err("AIST: model header is truncated");
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (header.version != version) {
+        Logger::err("AIST: unsupported model version " + std::to_string(header.version));
+        return false;
+    }
+    uint64_t tablesEnd = sizeof(header)
+                         + uint64_t(header.layerCount) * sizeof(FileLayer)
+                         + uint64_t(header.tensorCount) * sizeof(FileTensor);
+    //Compared against what is left of the file, the sum of two values from the file could overflow.
+    if (tablesEnd > header.dataOffset || header.dataOffset > file.size() || header.dataSize > file.size() - header.dataOffset) {
+        Logger::err("AIST: model tables or data exceed the file");
+        return false;
+    }
+
+    const char *cursor = file.data() + sizeof(header);
+    tensorDescs.resize(header.tensorCount);
+    const char *tensorsStart = cursor + header.layerCount * sizeof(FileLayer);
+    for (uint32_t i = 0; i < header.tensorCount; i++) {
+        FileTensor fileTensor;
+        std::memcpy(&fileTensor, tensorsStart + i * sizeof(FileTensor), sizeof(fileTensor));
+        if (fileTensor.dtype != uint32_t(DataType::fp32)) {
+            Logger::err("AIST: tensor " + std::to_string(i) + " has unsupported dtype " + std::to_string(fileTensor.dtype));
+            return false;
+        }
+        if (fileTensor.rank > std::size(fileTensor.shape)) {
+            Logger::err("AIST: tensor " + std::to_string(i) + " has rank above 4");
+            return false;
+        }
+        if (fileTensor.offset % 256 != 0 || fileTensor.offset > header.dataSize
+            || fileTensor.size > header.dataSize - fileTensor.offset) {
+            Logger::err("AIST: tensor " + std::to_string(i) + " is misaligned or out of data");
+            return false;
+        }
+        //Stops growing once it exceeds the size, so that the product of four dimensions can't wrap around.
+        uint64_t elements = 1;
+        for (uint32_t d = 0; d < fileTensor.rank && elements <= fileTensor.size; d++) {
+            elements *= fileTensor.shape[d];
+        }
+        if (fileTensor.size % sizeof(float) != 0 || elements != fileTensor.size / sizeof(float)) {
+            Logger::err("AIST: shape of tensor " + std::to_string(i) + " doesn't match its size");
+            return false;
+        }
+        tensorDescs[i] = {
+                .dtype = DataType(fileTensor.dtype),
+                .rank = fileTensor.rank,
+                .shape = {fileTensor.shape[0], fileTensor.shape[1], fileTensor.shape[2], fileTensor.shape[3]},
+                .offset = fileTensor.offset,
+                .size = fileTensor.size,
+        };
+    }
+
+    layerDescs.resize(header.layerCount);
+    for (uint32_t i = 0; i < header.layerCount; i++) {
+        FileLayer fileLayer;
+        std::memcpy(&fileLayer, cursor + i * sizeof(FileLayer), sizeof(fileLayer));
+        if (fileLayer.weights != noWeights && fileLayer.weights >= header.tensorCount) {
+            Logger::err("AIST: layer " + std::to_string(i) + " refers to a missing tensor");
+            return false;
+        }
+        layerDescs[i] = {.type = LayerType(fileLayer.type), .weights = fileLayer.weights};
+        std::memcpy(layerDescs[i].params, fileLayer.params, sizeof(fileLayer.params));
+    }
+
+    weightsData.assign(file.begin() + header.dataOffset, file.begin() + header.dataOffset + header.dataSize);
+    Logger::debug(
+            "AIST: loaded model with " + std::to_string(layerDescs.size()) + " layers and "
+            + std::to_string(tensorDescs.size()) + " tensors"
+    );
+    return true;
+}
+
+void vkBasalt::aist::Model::parseLegacy(std::vector<char> &&file) {
+    // Weights of every layer start at the next 256-byte boundary, as the original net bound them.
+    auto addTensor = [this](std::initializer_list<uint32_t> shape) {
+        uint64_t offset = 0;
+        if (!tensorDescs.empty()) {
+            offset = Layer::alignTo256Bytes(tensorDescs.back().offset + tensorDescs.back().size);
+        }
+        TensorDesc tensor{.dtype = DataType::fp32, .rank = uint32_t(shape.size()), .shape = {}, .offset = offset};
+        uint64_t elements = 1;
+        uint32_t d = 0;
+        for (uint32_t dim : shape) {
+            tensor.shape[d++] = dim;
+            elements *= dim;
+        }
+        tensor.size = elements * sizeof(float);
+        tensorDescs.push_back(tensor);
+        return uint32_t(tensorDescs.size() - 1);
+    };
+    layerDescs = {
+            {.type = LayerType::FromImage, .weights = addTensor({32, 3, 3, 3})},
+            {.type = LayerType::In2D, .weights = addTensor({2, 32}), .params = {2, 32, true}},
+            // 32 × 3 × 3 × 3 kernel followed by 3 biases.
+            {.type = LayerType::UpConv32t3, .weights = addTensor({32 * 3 * 3 * 3 + 3})},
+            {.type = LayerType::ToImage, .weights = noWeights},
+    };
+    weightsData = std::move(file);
+    uint64_t expectedSize = tensorDescs.back().offset + tensorDescs.back().size;
+    if (weightsData.size() < expectedSize) {
+        Logger::warn(
+                "AIST: raw weights have " + std::to_string(weightsData.size()) + " bytes, expected at least "
+                + std::to_string(expectedSize)
+        );
+        weightsData.resize(expectedSize);
+    }
+}
+
+const std::vector<vkBasalt::aist::LayerDesc> &vkBasalt::aist::Model::layers() const {
+    return layerDescs;
+}
+
+const std::vector<vkBasalt::aist::TensorDesc> &vkBasalt::aist::Model::tensors() const {
+    return tensorDescs;
+}
+
+const std::vector<char> &vkBasalt::aist::Model::data() const {
+    return weightsData;
+}
+
+VkDeviceSize vkBasalt::aist::Model::weightsOffset(uint32_t layerIdx) const {
+    uint32_t weights = layerDescs[layerIdx].weights;
+    return weights == noWeights ? 0 : tensorDescs[weights].offset;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "../vulkan_include.hpp"
+
+namespace vkBasalt::aist {
+    /*
+     * Binary model, all integers are little endian:
+     *   FileHeader;
+     *   FileLayer[layerCount] - layers in execution order;
+     *   FileTensor[tensorCount] - weights of layers;
+     *   data at dataOffset, dataSize bytes, tensor offsets are relative to it.
+     * Tensor offsets must be multiples of 256, so every tensor can be bound as a uniform buffer directly.
+     * Files without the magic are treated as raw weights of the original FromImage → In2D → UpConv → ToImage net.
+     */
+    enum class LayerType : uint32_t {
+        FromImage = 1,
+        //params: spatialDivisor, channels, relu.
+        In2D = 2,
+        UpConv32t3 = 3,
+        ToImage = 4,
+        //params: spatialDivisor. Two depthwise-separable 64-channel convolutions with a skip connection.
+        ResidualBlock64 = 5,
+        //params: spatialDivisor, inChannels, outChannels, groups, stride, reflect. Reads the image when it's the first layer.
+        GroupedConv = 6,
+    };
+
+    enum class DataType : uint32_t {
+        fp32 = 1,
+    };
+
+    struct LayerDesc {
+        LayerType type;
+        //Index into tensors or noWeights.
+        uint32_t weights;
+        uint32_t params[6];
+    };
+
+    struct TensorDesc {
+        DataType dtype;
+        uint32_t rank;
+        uint32_t shape[4];
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    class Model {
+    public:
+        static constexpr char magic[4] = {'A', 'I', 'S', 'T'};
+        static constexpr uint32_t version = 1;
+        static constexpr uint32_t noWeights = UINT32_MAX;
+
+        //Logs the reason and returns false if the file can't be used.
+        bool load(const std::string &fileName);
+
+        const std::vector<LayerDesc> &layers() const;
+
+        const std::vector<TensorDesc> &tensors() const;
+
+        //Weights of all layers, uploaded to the GPU as one uniform buffer.
+        const std::vector<char> &data() const;
+
+        //Offset of the layer weights in data().
+        VkDeviceSize weightsOffset(uint32_t layerIdx) const;
+
+    private:
+        std::vector<LayerDesc> layerDescs;
+        std::vector<TensorDesc> tensorDescs;
+        std::vector<char> weightsData;
+
+        bool parse(const std::vector<char> &file);
+
+        void parseLegacy(std::vector<char> &&file);
+    };
+}
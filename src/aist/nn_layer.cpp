@@ -1,13 +1,38 @@
 #include <cmath>
 #include "nn_layer.h"
 
-vkBasalt::aist::Layer::Layer(LogicalDevice *pLogicalDevice, VkExtent2D imageExtent, uint32_t chainCount) :
-        pLogicalDevice(pLogicalDevice), imageExtent(imageExtent), chainCount(chainCount) {
+vkBasalt::aist::Layer::Layer(
+        LogicalDevice *pLogicalDevice,
+        VkExtent2D imageExtent,
+        uint32_t chainCount,
+        TensorPrecision precision
+) : pLogicalDevice(pLogicalDevice), imageExtent(imageExtent), chainCount(chainCount), precision(precision) {
     perChainDescriptorSets.resize(chainCount);
 }
 
+void vkBasalt::aist::Layer::createComputeModule(
+        const uint32_t *code,
+        size_t codeSize,
+        const uint32_t *fp16Code,
+        size_t fp16CodeSize
+) {
+    bool isFp16 = precision == TensorPrecision::fp16;
+    VkShaderModuleCreateInfo shaderCreateInfo{
+            .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO, .pNext = nullptr,
+            .flags = 0,
+            .codeSize = isFp16 ? fp16CodeSize : codeSize,
+            .pCode = isFp16 ? fp16Code : code,
+    };
+    VkResult result = pLogicalDevice->vkd.CreateShaderModule(
+            pLogicalDevice->device,
+            &shaderCreateInfo,
+            nullptr,
+            &computeModule
+    );
+    ASSERT_VULKAN(result)
+}
+
 void vkBasalt::aist::Layer::createPipeline() {
-    VkResult result;
     createPipelineLayout();
 
     uint32_t constIdx = 0;
@@ -19,6 +44,10 @@ void vkBasalt::aist::Layer::createPipeline() {
             .mapEntryCount = constIdx, .pMapEntries = specEntries,
             .dataSize = sizeof(imageExtent), .pData = &imageExtent,
     };
+    createComputePipeline(specInfo);
+}
+
+void vkBasalt::aist::Layer::createComputePipeline(const VkSpecializationInfo &specInfo) {
     VkComputePipelineCreateInfo computePipelineCreateInfo{
             .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
             .pNext = nullptr,
@@ -35,9 +64,9 @@ void vkBasalt::aist::Layer::createPipeline() {
             .basePipelineIndex = -1,
     };
 
-    result = pLogicalDevice->vkd.CreateComputePipelines(
+    VkResult result = pLogicalDevice->vkd.CreateComputePipelines(
             pLogicalDevice->device,
-            VK_NULL_HANDLE,
+            pLogicalDevice->pipelineCache,
             1,
             &computePipelineCreateInfo,
             nullptr,
@@ -95,23 +124,28 @@ vkBasalt::aist::Layer::~Layer() {
     }
 }
 
-void vkBasalt::aist::Layer::createLayout(bool tapsIntoImage) {
-    uint32_t bindingIndex = 0;
-    VkDescriptorSetLayoutBinding weightsBindings[]{
-            {
-                    .binding = bindingIndex++,
-                    .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                    .descriptorCount = 1,
-                    .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
-                    .pImmutableSamplers = nullptr,
-            },
-    };
+void vkBasalt::aist::Layer::createLayout(
+        bool tapsIntoImage,
+        uint32_t storageBuffers,
+        uint32_t weightBuffers,
+        VkDescriptorType weightsType
+) {
+    std::vector<VkDescriptorSetLayoutBinding> weightsBindings(weightBuffers, {
+            .binding = 0,
+            .descriptorType = weightsType,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .pImmutableSamplers = nullptr,
+    });
+    for (uint32_t i = 0; i < weightsBindings.size(); i++) {
+        weightsBindings[i].binding = i;
+    }
     VkDescriptorSetLayoutCreateInfo descriptorSetCreateInfo = {
             .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
             .pNext = nullptr,
             .flags = 0,
-            .bindingCount = bindingIndex,
-            .pBindings    = weightsBindings,
+            .bindingCount = weightBuffers,
+            .pBindings    = weightsBindings.data(),
     };
 
     VkResult result = pLogicalDevice->vkd.CreateDescriptorSetLayout(
@@ -122,28 +156,22 @@ void vkBasalt::aist::Layer::createLayout(bool tapsIntoImage) {
     );
     ASSERT_VULKAN(result)
 
-    bindingIndex = 0;
-    VkDescriptorSetLayoutBinding storageBindings[]{
-            {
-                    .binding = bindingIndex++,
-                    .descriptorType = tapsIntoImage
-                                      ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE
-                                      : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-                    .descriptorCount = 1,
-                    .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
-                    .pImmutableSamplers = nullptr,
-            },
-            {
-                    .binding = bindingIndex++,
-                    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-                    .descriptorCount = 1,
-                    .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
-                    .pImmutableSamplers = nullptr,
-            }
-    };
+    std::vector<VkDescriptorSetLayoutBinding> storageBindings(1 + storageBuffers, {
+            .binding = 0,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .pImmutableSamplers = nullptr,
+    });
+    for (uint32_t i = 0; i < storageBindings.size(); i++) {
+        storageBindings[i].binding = i;
+    }
+    if (tapsIntoImage) {
+        storageBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    }
 
-    descriptorSetCreateInfo.bindingCount = bindingIndex;
-    descriptorSetCreateInfo.pBindings = storageBindings;
+    descriptorSetCreateInfo.bindingCount = storageBindings.size();
+    descriptorSetCreateInfo.pBindings = storageBindings.data();
     result = pLogicalDevice->vkd.CreateDescriptorSetLayout(
             pLogicalDevice->device,
             &descriptorSetCreateInfo,
@@ -191,6 +219,14 @@ void vkBasalt::aist::Layer::writeSets(uint32_t count, VkWriteDescriptorSet *writ
     );
 }
 
+VkDescriptorBufferInfo vkBasalt::aist::Layer::tensorBufferInfo(DsWriterHolder holder, TensorId tensor) {
+    return {
+            .buffer = holder.intermediate->pBufferInfo->buffer,
+            .offset = holder.tensors->offset(tensor),
+            .range = holder.tensors->size(tensor),
+    };
+}
+
 void vkBasalt::aist::Layer::dispatchPipeline(VkCommandBuffer commandBuffer, uint32_t chainIdx) {
     pLogicalDevice->vkd.CmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
     VkDescriptorSet sets[]{
@@ -217,6 +253,14 @@ void vkBasalt::aist::Layer::appendCommands(VkCommandBuffer commandBuffer, uint32
     dispatchPipeline(commandBuffer, chainIdx);
 }
 
+VkDeviceSize vkBasalt::aist::Layer::tensorElementSize(TensorPrecision precision) {
+    return precision == TensorPrecision::fp16 ? 2 : 4;
+}
+
+VkDeviceSize vkBasalt::aist::Layer::tensorElementSize() const {
+    return tensorElementSize(precision);
+}
+
 VkDeviceSize vkBasalt::aist::Layer::alignTo256Bytes(VkDeviceSize size) {
     VkDeviceSize overWholeWeight = size % 256;
     if (overWholeWeight > 0) {
@@ -2,8 +2,15 @@
 
 #include "../vulkan_include.hpp"
 #include "../logical_device.hpp"
+#include "tensor_planner.hpp"
 
 namespace vkBasalt::aist {
+    //Storage type of tensors in intermediate buffers. Shaders always calculate in 32-bit floats.
+    enum class TensorPrecision {
+        fp32,
+        fp16,
+    };
+
     struct DsCounterHolder {
         uint32_t images;
         uint32_t uniforms;
@@ -14,12 +21,18 @@ namespace vkBasalt::aist {
         VkWriteDescriptorSet *outImage;
         VkWriteDescriptorSet *intermediate;
         VkWriteDescriptorSet *weights;
+        const TensorPlanner *tensors;
     };
 
     class Layer {
     public:
         static VkDeviceSize alignTo256Bytes(VkDeviceSize size);
 
+        static VkDeviceSize tensorElementSize(TensorPrecision precision);
+
+        //Declares tensors the layer reads and writes, returns the one the next layer should read.
+        virtual TensorId planTensors(TensorPlanner *planner, TensorId input) = 0;
+
         virtual void createLayout(DsCounterHolder *counters) = 0;
 
         virtual void writeSets(DsWriterHolder holder, uint32_t chainIdx) = 0;
@@ -37,11 +50,12 @@ namespace vkBasalt::aist {
         virtual ~Layer();
 
     protected:
-        Layer(LogicalDevice *pLogicalDevice, VkExtent2D imageExtent, uint32_t chainCount);
+        Layer(LogicalDevice *pLogicalDevice, VkExtent2D imageExtent, uint32_t chainCount, TensorPrecision precision);
 
         LogicalDevice *pLogicalDevice;
         VkExtent2D imageExtent;
         uint32_t chainCount;
+        TensorPrecision precision;
         float imageSizeProportion = 16.0;
         uint32_t depth = 1;
         VkDescriptorSetLayout commonDescriptorSetLayout = nullptr;
@@ -51,13 +65,31 @@ namespace vkBasalt::aist {
         VkShaderModule computeModule = VK_NULL_HANDLE;
         VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
         VkPipeline computePipeline = VK_NULL_HANDLE;
+        TensorId inputTensor = 0;
+        TensorId outputTensor = 0;
 
-        void createLayout(bool tapsIntoImage);
+        //Binding 0 is the input image or tensor, followed by storageBuffers bindings of storage buffers.
+        //The common set has weightBuffers bindings of weights of weightsType.
+        void createLayout(
+                bool tapsIntoImage,
+                uint32_t storageBuffers = 1,
+                uint32_t weightBuffers = 1,
+                VkDescriptorType weightsType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER
+        );
+
+        //Picks the shader variant matching tensor precision.
+        void createComputeModule(const uint32_t *code, size_t codeSize, const uint32_t *fp16Code, size_t fp16CodeSize);
+
+        VkDeviceSize tensorElementSize() const;
 
         virtual void createPipelineLayout();
 
+        void createComputePipeline(const VkSpecializationInfo &specInfo);
+
         void writeSets(uint32_t count, VkWriteDescriptorSet *writes);
 
+        static VkDescriptorBufferInfo tensorBufferInfo(DsWriterHolder holder, TensorId tensor);
+
         void dispatchPipeline(VkCommandBuffer commandBuffer, uint32_t chainIdx);
     };
 }
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include "residual_block_layer.hpp"
+
+vkBasalt::aist::ResidualBlock64::ResidualBlock64(
+        LogicalDevice *pDevice,
+        VkExtent2D extent2D,
+        uint32_t chainCount,
+        TensorPrecision precision,
+        uint32_t spatialDivisor
+) : Layer(pDevice, extent2D, chainCount, precision),
+    stages{
+            std::make_unique<SepConv64>(pDevice, extent2D, chainCount, precision, spatialDivisor),
+            std::make_unique<In2D>(pDevice, extent2D, chainCount, precision, spatialDivisor, 64, true),
+            std::make_unique<SepConv64>(pDevice, extent2D, chainCount, precision, spatialDivisor),
+            std::make_unique<In2D>(pDevice, extent2D, chainCount, precision, spatialDivisor, 64, false, 0, true),
+    } {
+}
+
+vkBasalt::aist::TensorId vkBasalt::aist::ResidualBlock64::planTensors(TensorPlanner *planner, TensorId input) {
+    inputTensor = outputTensor = input;
+    //The block input stays alive until the last In2D adds the skip connection to it.
+    planner->useTensor(input);
+    static_cast<In2D *>(stages[3].get())->setResidualTensor(input);
+    TensorId tensor = input;
+    for (auto &stage : stages) {
+        tensor = stage->planTensors(planner, tensor);
+    }
+    return tensor;
+}
+
+void vkBasalt::aist::ResidualBlock64::createLayout(DsCounterHolder *counters) {
+    for (auto &stage : stages) {
+        stage->createLayout(counters);
+    }
+}
+
+void vkBasalt::aist::ResidualBlock64::writeSets(DsWriterHolder holder, uint32_t chainIdx) {
+    auto pWeightsInfo = const_cast<VkDescriptorBufferInfo *>(holder.weights->pBufferInfo);
+    VkDeviceSize offset = pWeightsInfo->offset;
+    VkDeviceSize stageSizes[]{
+            SepConv64::depthwiseSize + SepConv64::pointwiseSize,
+            64 * 2 * 4,
+            SepConv64::depthwiseSize + SepConv64::pointwiseSize,
+            64 * 2 * 4,
+    };
+    for (uint32_t i = 0; i < std::size(stages); i++) {
+        pWeightsInfo->offset = offset;
+        stages[i]->writeSets(holder, chainIdx);
+        offset += stageSizes[i];
+    }
+}
+
+void vkBasalt::aist::ResidualBlock64::createDescriptorSets(VkDescriptorPool descriptorPool) {
+    for (auto &stage : stages) {
+        stage->createDescriptorSets(descriptorPool);
+    }
+}
+
+void vkBasalt::aist::ResidualBlock64::createPipeline() {
+    for (auto &stage : stages) {
+        stage->createPipeline();
+    }
+}
+
+void vkBasalt::aist::ResidualBlock64::appendCommands(VkCommandBuffer commandBuffer, uint32_t chainIdx,
+                                                     VkBufferMemoryBarrier *bufferBarrierDto) {
+    for (uint32_t i = 0; i < std::size(stages); i++) {
+        if (i > 0) {
+            pLogicalDevice->vkd.CmdPipelineBarrier(
+                    commandBuffer,
+                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                    0,
+                    0, nullptr,
+                    1, bufferBarrierDto,
+                    0, nullptr
+            );
+        }
+        stages[i]->appendCommands(commandBuffer, chainIdx, bufferBarrierDto);
+    }
+}
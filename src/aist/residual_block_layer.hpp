@@ -0,0 +1,43 @@
+#pragma once
+
+#include <memory>
+
+#include "in_2d_layer.hpp"
+#include "sep_conv_64_layer.hpp"
+
+namespace vkBasalt::aist {
+    //x + IN(SepConv(ReLU(IN(SepConv(x))))) on a 64-channel tensor, the sum is written over x.
+    class ResidualBlock64 : public Layer {
+    public:
+        //Weights of both halves: SepConv64 depthwise and pointwise, then In2D scales and shifts.
+        static constexpr VkDeviceSize weightsSize = 2 * (SepConv64::depthwiseSize + SepConv64::pointwiseSize + 64 * 2 * 4);
+
+        ResidualBlock64(
+                LogicalDevice *pDevice,
+                VkExtent2D extent2D,
+                uint32_t chainCount,
+                TensorPrecision precision,
+                uint32_t spatialDivisor
+        );
+
+        TensorId planTensors(TensorPlanner *planner, TensorId input) override;
+
+        void createLayout(DsCounterHolder *counters) override;
+
+        void writeSets(DsWriterHolder holder, uint32_t chainIdx) override;
+
+        void createDescriptorSets(VkDescriptorPool descriptorPool) override;
+
+        void createPipeline() override;
+
+        void appendCommands(
+                VkCommandBuffer commandBuffer,
+                uint32_t chainIdx,
+                VkBufferMemoryBarrier *bufferBarrierDto
+        ) override;
+
+    private:
+        //In execution order.
+        std::unique_ptr<Layer> stages[4];
+    };
+}
@@ -0,0 +1,74 @@
+#include "sep_conv_64_layer.hpp"
+
+const uint32_t code[] = {
+#include "aist/sep_conv_64.comp.h"
+};
+
+const uint32_t fp16Code[] = {
+#include "aist/sep_conv_64.comp.fp16.h"
+};
+
+vkBasalt::aist::SepConv64::SepConv64(
+        LogicalDevice *pDevice,
+        VkExtent2D extent2D,
+        uint32_t chainCount,
+        TensorPrecision precision,
+        uint32_t spatialDivisor
+) : Layer(pDevice, extent2D, chainCount, precision),
+    specialization{.width = extent2D.width, .height = extent2D.height, .spatialDivisor = spatialDivisor} {
+    //Workgroup covers 8 × 8 tensor pixels.
+    imageSizeProportion = 8.0f * spatialDivisor;
+}
+
+vkBasalt::aist::TensorId vkBasalt::aist::SepConv64::planTensors(TensorPlanner *planner, TensorId input) {
+    planner->useTensor(input);
+    inputTensor = input;
+    uint32_t pixels = (imageExtent.width / specialization.spatialDivisor)
+                      * (imageExtent.height / specialization.spatialDivisor);
+    outputTensor = planner->createTensor(pixels * 64 * tensorElementSize());
+    return outputTensor;
+}
+
+void vkBasalt::aist::SepConv64::createLayout(DsCounterHolder *counters) {
+    Layer::createLayout(false, 1, 2);
+    counters->uniforms += 2;
+    counters->intermediates += chainCount * 2;
+}
+
+void vkBasalt::aist::SepConv64::createPipeline() {
+    createComputeModule(code, sizeof(code), fp16Code, sizeof(fp16Code));
+    createPipelineLayout();
+
+    uint32_t constIdx = 0;
+    VkSpecializationMapEntry specEntries[]{
+            {.constantID = constIdx++, .offset=offsetof(Specialization, width), .size=sizeof(Specialization::width)},
+            {.constantID = constIdx++, .offset=offsetof(Specialization, height), .size=sizeof(Specialization::height)},
+            {.constantID = constIdx++, .offset=offsetof(Specialization, spatialDivisor), .size=sizeof(Specialization::spatialDivisor)},
+    };
+    VkSpecializationInfo specInfo{
+            .mapEntryCount = constIdx, .pMapEntries = specEntries,
+            .dataSize = sizeof(specialization), .pData = &specialization,
+    };
+    createComputePipeline(specInfo);
+}
+
+void vkBasalt::aist::SepConv64::writeSets(DsWriterHolder holder, uint32_t chainIdx) {
+    VkWriteDescriptorSet writes[] = {*holder.weights, *holder.weights, *holder.intermediate, *holder.intermediate};
+    VkDescriptorBufferInfo depthwiseInfo = *holder.weights->pBufferInfo;
+    depthwiseInfo.range = depthwiseSize;
+    //Both sizes are multiples of 256, so the pointwise kernel stays aligned for binding.
+    VkDescriptorBufferInfo pointwiseInfo = depthwiseInfo;
+    pointwiseInfo.offset += depthwiseSize;
+    pointwiseInfo.range = pointwiseSize;
+    writes[0].pBufferInfo = &depthwiseInfo;
+    writes[1].pBufferInfo = &pointwiseInfo;
+    writes[1].dstBinding = 1;
+    writes[1].dstSet = writes[0].dstSet = commonDescriptorSet;
+    VkDescriptorBufferInfo inInfo = tensorBufferInfo(holder, inputTensor);
+    writes[2].pBufferInfo = &inInfo;
+    writes[2].dstBinding = 0;
+    VkDescriptorBufferInfo outInfo = tensorBufferInfo(holder, outputTensor);
+    writes[3].pBufferInfo = &outInfo;
+    writes[3].dstSet = writes[2].dstSet = perChainDescriptorSets[chainIdx];
+    Layer::writeSets(std::size(writes), writes);
+}
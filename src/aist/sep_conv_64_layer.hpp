@@ -0,0 +1,38 @@
+#pragma once
+
+#include "nn_layer.h"
+
+namespace vkBasalt::aist {
+    //Depthwise 3 × 3 with reflect padding and bias followed by pointwise 1 × 1 without bias, 64 channels.
+    class SepConv64 : public Layer {
+    public:
+        //Depthwise kernel [9][64], kernel index is kx × 3 + ky, then 64 biases.
+        static constexpr VkDeviceSize depthwiseSize = (9 * 64 + 64) * 4;
+        //Pointwise kernel [64 outputs][64 inputs].
+        static constexpr VkDeviceSize pointwiseSize = 64 * 64 * 4;
+
+        SepConv64(
+                LogicalDevice *pDevice,
+                VkExtent2D extent2D,
+                uint32_t chainCount,
+                TensorPrecision precision,
+                uint32_t spatialDivisor
+        );
+
+        TensorId planTensors(TensorPlanner *planner, TensorId input) override;
+
+        void createLayout(DsCounterHolder *counters) override;
+
+        void createPipeline() override;
+
+        //Weights start at the offset of holder.weights: depthwiseSize bytes, then pointwiseSize bytes.
+        void writeSets(DsWriterHolder holder, uint32_t chainIdx) override;
+
+    private:
+        struct Specialization {
+            uint32_t width;
+            uint32_t height;
+            uint32_t spatialDivisor;
+        } specialization;
+    };
+}
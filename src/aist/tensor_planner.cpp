@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <numeric>
+#include "tensor_planner.hpp"
+#include "nn_layer.h"
+
+void vkBasalt::aist::TensorPlanner::beginLayer() {
+    currentLayer = layerCount++;
+}
+
+vkBasalt::aist::TensorId vkBasalt::aist::TensorPlanner::createTensor(VkDeviceSize size) {
+    tensors.push_back({
+            .size = Layer::alignTo256Bytes(size),
+            .offset = 0,
+            .firstLayer = currentLayer,
+            .lastLayer = currentLayer,
+    });
+    return tensors.size() - 1;
+}
+
+void vkBasalt::aist::TensorPlanner::useTensor(TensorId tensor) {
+    tensors[tensor].lastLayer = std::max(tensors[tensor].lastLayer, currentLayer);
+}
+
+void vkBasalt::aist::TensorPlanner::plan() {
+    //Greedy by size: the largest tensors get placed first, each at the lowest offset
+    //that doesn't collide with an already placed tensor alive at the same time.
+    std::vector<TensorId> order(tensors.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this](TensorId a, TensorId b) {
+        return tensors[a].size > tensors[b].size;
+    });
+    std::vector<const Tensor *> placed;
+    plannedSize = 0;
+    for (TensorId id : order) {
+        Tensor &tensor = tensors[id];
+        std::vector<const Tensor *> conflicts;
+        for (const Tensor *other : placed) {
+            if (other->firstLayer <= tensor.lastLayer && tensor.firstLayer <= other->lastLayer) {
+                conflicts.push_back(other);
+            }
+        }
+        std::sort(conflicts.begin(), conflicts.end(), [](const Tensor *a, const Tensor *b) {
+            return a->offset < b->offset;
+        });
+        tensor.offset = 0;
+        for (const Tensor *other : conflicts) {
+            if (tensor.offset + tensor.size <= other->offset) {
+                break;
+            }
+            tensor.offset = std::max(tensor.offset, other->offset + other->size);
+        }
+        placed.push_back(&tensor);
+        plannedSize = std::max(plannedSize, tensor.offset + tensor.size);
+    }
+}
+
+VkDeviceSize vkBasalt::aist::TensorPlanner::offset(TensorId tensor) const {
+    return tensors[tensor].offset;
+}
+
+VkDeviceSize vkBasalt::aist::TensorPlanner::size(TensorId tensor) const {
+    return tensors[tensor].size;
+}
+
+VkDeviceSize vkBasalt::aist::TensorPlanner::totalSize() const {
+    return plannedSize;
+}
+
+VkDeviceSize vkBasalt::aist::TensorPlanner::unaliasedSize() const {
+    VkDeviceSize sum = 0;
+    for (const auto &tensor : tensors) {
+        sum += tensor.size;
+    }
+    return sum;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+
+#include "../vulkan_include.hpp"
+
+namespace vkBasalt::aist {
+    typedef uint32_t TensorId;
+
+    //Places every tensor of the network into one buffer.
+    //Tensors that are never alive during the same layer may share memory.
+    class TensorPlanner {
+    public:
+        //Following calls refer to the next layer in execution order.
+        void beginLayer();
+
+        //The tensor is alive from the current layer on.
+        TensorId createTensor(VkDeviceSize size);
+
+        //Extends the lifetime of the tensor up to the current layer.
+        void useTensor(TensorId tensor);
+
+        void plan();
+
+        VkDeviceSize offset(TensorId tensor) const;
+
+        VkDeviceSize size(TensorId tensor) const;
+
+        //Bytes of the shared buffer, valid after plan().
+        VkDeviceSize totalSize() const;
+
+        //Bytes needed if no tensors were aliased.
+        VkDeviceSize unaliasedSize() const;
+
+    private:
+        struct Tensor {
+            VkDeviceSize size;
+            VkDeviceSize offset;
+            uint32_t firstLayer;
+            uint32_t lastLayer;
+        };
+
+        std::vector<Tensor> tensors;
+        uint32_t layerCount = 0;
+        uint32_t currentLayer = 0;
+        VkDeviceSize plannedSize = 0;
+    };
+}
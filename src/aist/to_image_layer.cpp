@@ -5,8 +5,22 @@ const uint32_t code[] = {
 #include "aist/to_image.comp.h"
 };
 
-vkBasalt::aist::ToImageLayer::ToImageLayer(LogicalDevice *pDevice, VkExtent2D extent2D, uint32_t chainCount)
-        : Layer(pDevice, extent2D, chainCount) {}
+const uint32_t fp16Code[] = {
+#include "aist/to_image.comp.fp16.h"
+};
+
+vkBasalt::aist::ToImageLayer::ToImageLayer(
+        LogicalDevice *pDevice,
+        VkExtent2D extent2D,
+        uint32_t chainCount,
+        TensorPrecision precision
+) : Layer(pDevice, extent2D, chainCount, precision) {}
+
+vkBasalt::aist::TensorId vkBasalt::aist::ToImageLayer::planTensors(TensorPlanner *planner, TensorId input) {
+    planner->useTensor(input);
+    inputTensor = outputTensor = input;
+    return outputTensor;
+}
 
 void vkBasalt::aist::ToImageLayer::createLayout(DsCounterHolder *counters) {
     uint32_t bindingIndex = 0;
@@ -68,23 +82,14 @@ void vkBasalt::aist::ToImageLayer::createPipelineLayout() {
 }
 
 void vkBasalt::aist::ToImageLayer::createPipeline() {
-    VkShaderModuleCreateInfo shaderCreateInfo{
-            .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO, .pNext = nullptr,
-            .flags = 0,
-            .codeSize = sizeof(code), .pCode = code
-    };
-    VkResult result = pLogicalDevice->vkd.CreateShaderModule(
-            pLogicalDevice->device,
-            &shaderCreateInfo,
-            nullptr,
-            &computeModule
-    );
-    ASSERT_VULKAN(result)
+    createComputeModule(code, sizeof(code), fp16Code, sizeof(fp16Code));
     Layer::createPipeline();
 }
 
 void vkBasalt::aist::ToImageLayer::writeSets(DsWriterHolder holder, uint32_t chainIdx) {
     VkWriteDescriptorSet writes[] = {*holder.outImage, *holder.intermediate};
+    VkDescriptorBufferInfo inInfo = tensorBufferInfo(holder, inputTensor);
+    writes[1].pBufferInfo = &inInfo;
     writes[0].dstSet = writes[1].dstSet = perChainDescriptorSets[chainIdx];
     Layer::writeSets(std::size(writes), writes);
 }
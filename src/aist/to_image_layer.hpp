@@ -5,7 +5,9 @@
 namespace vkBasalt::aist {
     class ToImageLayer : public Layer {
     public:
-        ToImageLayer(LogicalDevice *pDevice, VkExtent2D extent2D, uint32_t chainCount);
+        ToImageLayer(LogicalDevice *pDevice, VkExtent2D extent2D, uint32_t chainCount, TensorPrecision precision);
+
+        TensorId planTensors(TensorPlanner *planner, TensorId input) override;
 
         void createLayout(DsCounterHolder *counters) override;
 
@@ -5,18 +5,14 @@
 namespace vkBasalt::aist {
     class UpConv32t3 : public Layer {
     public:
-        UpConv32t3(LogicalDevice *pDevice, VkExtent2D extent2D, uint32_t chainCount);
+        UpConv32t3(LogicalDevice *pDevice, VkExtent2D extent2D, uint32_t chainCount, TensorPrecision precision);
+
+        TensorId planTensors(TensorPlanner *planner, TensorId input) override;
 
         void createLayout(DsCounterHolder *counters) override;
 
         void createPipeline() override;
 
         void writeSets(DsWriterHolder holder, uint32_t chainIdx) override;
-
-        void appendCommands(VkCommandBuffer commandBuffer, uint32_t chainIdx,
-                            VkBufferMemoryBarrier *bufferBarrierDto) override;
-
-    protected:
-        void createPipelineLayout() override;
     };
 }
@@ -1,6 +1,9 @@
 #include "vulkan_include.hpp"
 
+#include <atomic>
+#include <chrono>
 #include <mutex>
+#include <thread>
 #include <map>
 #include <vector>
 #include <unordered_map>
@@ -10,6 +13,8 @@
 #include <cstring>
 
 #include "util.hpp"
+#include "dispatch_map.hpp"
+#include "pipeline_cache.hpp"
 #include "keyboard_input.hpp"
 
 #include "logical_device.hpp"
@@ -25,19 +30,13 @@
 #include "buffer.hpp"
 #include "config.hpp"
 #include "fake_swapchain.hpp"
+#include "upload_batch.hpp"
 #include "renderpass.hpp"
 #include "format.hpp"
 #include "logger.hpp"
 
 #include "effect.hpp"
-#include "effect_aist.hpp"
-#include "effect_fxaa.hpp"
-#include "effect_cas.hpp"
-#include "effect_dls.hpp"
-#include "effect_smaa.hpp"
-#include "effect_deband.hpp"
-#include "effect_lut.hpp"
-#include "effect_reshade.hpp"
+#include "effect_factory.hpp"
 #include "effect_transfer.hpp"
 
 #define VKBASALT_NAME "VK_LAYER_VKBASALT_post_processing"
@@ -49,12 +48,12 @@ namespace vkBasalt
     Logger Logger::s_instance;
 
     // layer book-keeping information, to store dispatch tables by key
-    std::unordered_map<void*, VkLayerInstanceDispatchTable>               instanceDispatchMap;
-    std::unordered_map<void*, VkInstance>                                 instanceMap;
-    std::unordered_map<void*, std::shared_ptr<LogicalDevice>>             deviceMap;
-    std::unordered_map<VkSwapchainKHR, std::shared_ptr<LogicalSwapchain>> swapchainMap;
+    // Lookups don't lock, everything that changes a device or its swapchains holds LogicalDevice::lock instead of one global lock.
+    DispatchMap<void*, VkLayerInstanceDispatchTable>               instanceDispatchMap;
+    DispatchMap<void*, VkInstance>                                 instanceMap;
+    DispatchMap<void*, std::shared_ptr<LogicalDevice>>             deviceMap;
+    DispatchMap<VkSwapchainKHR, std::shared_ptr<LogicalSwapchain>> swapchainMap;
 
-    std::mutex globalLock;
 #ifdef _GCC_
     using scoped_lock __attribute__((unused)) = std::lock_guard<std::mutex>;
 #else
@@ -123,22 +122,17 @@ namespace vkBasalt
         layer_init_instance_dispatch_table(*pInstance, &dispatchTable, gpa);
 
         // store the table by key
-        {
-            scoped_lock l(globalLock);
-            instanceDispatchMap[GetKey(*pInstance)] = dispatchTable;
-            instanceMap[GetKey(*pInstance)]         = *pInstance;
-        }
+        instanceDispatchMap.set(GetKey(*pInstance), dispatchTable);
+        instanceMap.set(GetKey(*pInstance), *pInstance);
 
         return ret;
     }
 
     VK_LAYER_EXPORT void VKAPI_CALL vkBasalt_DestroyInstance(VkInstance instance, const VkAllocationCallbacks* pAllocator)
     {
-        scoped_lock l(globalLock);
-
         Logger::trace("vkDestroyInstance");
 
-        VkLayerInstanceDispatchTable dispatchTable = instanceDispatchMap[GetKey(instance)];
+        VkLayerInstanceDispatchTable dispatchTable = instanceDispatchMap.get(GetKey(instance));
 
         dispatchTable.DestroyInstance(instance, pAllocator);
 
@@ -177,9 +171,10 @@ namespace vkBasalt
         // check and activate extentions
         uint32_t extensionCount = 0;
 
-        instanceDispatchMap[GetKey(physicalDevice)].EnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+        VkLayerInstanceDispatchTable instanceDispatchTable = instanceDispatchMap.get(GetKey(physicalDevice));
+        instanceDispatchTable.EnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
         std::vector<VkExtensionProperties> extensionProperties(extensionCount);
-        instanceDispatchMap[GetKey(physicalDevice)].EnumerateDeviceExtensionProperties(
+        instanceDispatchTable.EnumerateDeviceExtensionProperties(
             physicalDevice, nullptr, &extensionCount, extensionProperties.data());
 
         bool supportsMutableFormat = false;
@@ -242,6 +237,52 @@ namespace vkBasalt
             modifiedCreateInfo.pNext = &toAddIfNotSet;
         }
 
+        // AIST can keep its tensors in half precision, which only needs 16-bit storage buffer access.
+        VkPhysicalDevice16BitStorageFeatures supported16BitStorage{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_16BIT_STORAGE_FEATURES,
+            .pNext = nullptr,
+        };
+        VkPhysicalDeviceFeatures2 supportedFeatures{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+            .pNext = &supported16BitStorage,
+        };
+        instanceDispatchTable.GetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures);
+        bool supportsStorage16Bit = supported16BitStorage.storageBuffer16BitAccess;
+
+        // BCn compressed DDS textures of ReShade effects can be uploaded as they are.
+        bool supportsTextureCompressionBC = supportedFeatures.features.textureCompressionBC;
+        if (supportsTextureCompressionBC)
+        {
+            deviceFeatures.textureCompressionBC = VK_TRUE;
+        }
+
+        VkPhysicalDevice16BitStorageFeatures storage16BitToAddIfNotSet{
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_16BIT_STORAGE_FEATURES,
+            .pNext = const_cast<void *>(modifiedCreateInfo.pNext),
+            .storageBuffer16BitAccess = true,
+        };
+        if (supportsStorage16Bit) {
+            subfeatures = &modifiedCreateInfo;
+            while (subfeatures != nullptr) {
+                if (subfeatures->sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES) {
+                    ((VkPhysicalDeviceVulkan11Features *) subfeatures)->storageBuffer16BitAccess = true;
+                    Logger::debug("Enabled 16-bit storage on PD_V_1_1_Features");
+                    break;
+                }
+                if (subfeatures->sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_16BIT_STORAGE_FEATURES) {
+                    ((VkPhysicalDevice16BitStorageFeatures *) subfeatures)->storageBuffer16BitAccess = true;
+                    Logger::debug("Enabled 16-bit storage on PD_16BS_Features");
+                    break;
+                }
+                subfeatures = (VkDeviceCreateInfo *) subfeatures->pNext;
+            }
+            if (subfeatures == nullptr) {
+                Logger::debug("Added PD_16BS_Features");
+                storage16BitToAddIfNotSet.pNext = const_cast<void *>(modifiedCreateInfo.pNext);
+                modifiedCreateInfo.pNext = &storage16BitToAddIfNotSet;
+            }
+        }
+
         VkResult ret = createFunc(physicalDevice, &modifiedCreateInfo, pAllocator, pDevice);
 
         // fetch our own dispatch table for the functions we need, into the next layer
@@ -250,37 +291,45 @@ namespace vkBasalt
 
         std::shared_ptr<LogicalDevice> pLogicalDevice(new LogicalDevice());
         pLogicalDevice->vkd                   = dispatchTable;
-        pLogicalDevice->vki                   = instanceDispatchMap[GetKey(physicalDevice)];
+        pLogicalDevice->vki                   = instanceDispatchTable;
         pLogicalDevice->device                = *pDevice;
         pLogicalDevice->physicalDevice        = physicalDevice;
-        pLogicalDevice->instance              = instanceMap[GetKey(physicalDevice)];
+        pLogicalDevice->instance              = instanceMap.get(GetKey(physicalDevice));
         pLogicalDevice->queue                 = VK_NULL_HANDLE;
         pLogicalDevice->queueFamilyIndex      = 0;
         pLogicalDevice->commandPool           = VK_NULL_HANDLE;
-        pLogicalDevice->supportsMutableFormat = supportsMutableFormat;
+        pLogicalDevice->supportsMutableFormat        = supportsMutableFormat;
+        pLogicalDevice->supportsStorage16Bit         = supportsStorage16Bit;
+        pLogicalDevice->supportsTextureCompressionBC = supportsTextureCompressionBC;
+        pLogicalDevice->queueSubmit2          = (LogicalDevice::PFN_QueueSubmit2) gdpa(*pDevice, "vkQueueSubmit2");
+        pLogicalDevice->queueSubmit2KHR       = (LogicalDevice::PFN_QueueSubmit2) gdpa(*pDevice, "vkQueueSubmit2KHR");
+        pLogicalDevice->pipelineCache         = createPipelineCache(pLogicalDevice.get());
 
         // store the table by key
-        {
-            scoped_lock l(globalLock);
-            deviceMap[GetKey(*pDevice)] = pLogicalDevice;
-        }
+        deviceMap.set(GetKey(*pDevice), pLogicalDevice);
 
         return ret;
     }
 
     VK_LAYER_EXPORT void VKAPI_CALL vkBasalt_DestroyDevice(VkDevice device, const VkAllocationCallbacks* pAllocator)
     {
-        scoped_lock l(globalLock);
-
         Logger::trace("vkDestroyDevice");
 
-        LogicalDevice* pLogicalDevice = deviceMap[GetKey(device)].get();
+        // The application may not use the device anywhere else while destroying it, so there is nothing to lock.
+        std::shared_ptr<LogicalDevice> pLogicalDevice = deviceMap.get(GetKey(device));
         if (pLogicalDevice->commandPool != VK_NULL_HANDLE)
         {
             Logger::debug("DestroyCommandPool");
             pLogicalDevice->vkd.DestroyCommandPool(device, pLogicalDevice->commandPool, pAllocator);
         }
 
+        if (pLogicalDevice->pipelineCache != VK_NULL_HANDLE)
+        {
+            savePipelineCache(pLogicalDevice.get());
+            pLogicalDevice->vkd.DestroyPipelineCache(device, pLogicalDevice->pipelineCache, nullptr);
+        }
+
+        pLogicalDevice->memoryAllocator.destroy(pLogicalDevice.get());
         pLogicalDevice->vkd.DestroyDevice(device, pAllocator);
 
         deviceMap.erase(GetKey(device));
@@ -324,6 +373,7 @@ namespace vkBasalt
             commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
 
             Logger::debug("found graphic capable queue");
+            scoped_lock queueLock(pLogicalDevice->queueLock);
             pLogicalDevice->vkd.CreateCommandPool(pLogicalDevice->device, &commandPoolCreateInfo, nullptr, &pLogicalDevice->commandPool);
             pLogicalDevice->queue            = *pQueue;
             pLogicalDevice->queueFamilyIndex = queueFamilyIndex;
@@ -332,11 +382,10 @@ namespace vkBasalt
 
     VKAPI_ATTR void VKAPI_CALL vkBasalt_GetDeviceQueue2(VkDevice device, const VkDeviceQueueInfo2* pQueueInfo, VkQueue* pQueue)
     {
-        scoped_lock l(globalLock);
-
         Logger::trace("vkGetDeviceQueue2");
 
-        LogicalDevice* pLogicalDevice = deviceMap[GetKey(device)].get();
+        LogicalDevice* pLogicalDevice = deviceMap.get(GetKey(device)).get();
+        scoped_lock    l(pLogicalDevice->lock);
 
         pLogicalDevice->vkd.GetDeviceQueue2(device, pQueueInfo, pQueue);
 
@@ -345,11 +394,10 @@ namespace vkBasalt
 
     VKAPI_ATTR void VKAPI_CALL vkBasalt_GetDeviceQueue(VkDevice device, uint32_t queueFamilyIndex, uint32_t queueIndex, VkQueue* pQueue)
     {
-        scoped_lock l(globalLock);
-
         Logger::trace("vkGetDeviceQueue");
 
-        LogicalDevice* pLogicalDevice = deviceMap[GetKey(device)].get();
+        LogicalDevice* pLogicalDevice = deviceMap.get(GetKey(device)).get();
+        scoped_lock    l(pLogicalDevice->lock);
 
         pLogicalDevice->vkd.GetDeviceQueue(device, queueFamilyIndex, queueIndex, pQueue);
 
@@ -361,11 +409,9 @@ namespace vkBasalt
                                                                const VkAllocationCallbacks*    pAllocator,
                                                                VkSwapchainKHR*                 pSwapchain)
     {
-        scoped_lock l(globalLock);
-
         Logger::trace("vkCreateSwapchainKHR");
 
-        LogicalDevice* pLogicalDevice = deviceMap[GetKey(device)].get();
+        LogicalDevice* pLogicalDevice = deviceMap.get(GetKey(device)).get();
 
         VkSwapchainCreateInfoKHR modifiedCreateInfo = *pCreateInfo;
 
@@ -406,27 +452,160 @@ namespace vkBasalt
 
         VkResult result = pLogicalDevice->vkd.CreateSwapchainKHR(device, &modifiedCreateInfo, pAllocator, pSwapchain);
 
-        swapchainMap[*pSwapchain] = pLogicalSwapchain;
+        // Games recreate the swapchain with the same size on alt-tab or fullscreen toggles, the effects of the old one only
+        // need to be pointed at the new images then.
+        std::shared_ptr<LogicalSwapchain> pOldSwapchain = swapchainMap.get(pCreateInfo->oldSwapchain);
+        if (pOldSwapchain)
+        {
+            // Effects that aren't done yet get created again for the new swapchain.
+            pOldSwapchain->stopEffectsThread();
+        }
+
+        scoped_lock l(pLogicalDevice->lock);
+        if (pOldSwapchain && result == VK_SUCCESS)
+        {
+            uint32_t imageCount = 0;
+            pLogicalDevice->vkd.GetSwapchainImagesKHR(device, *pSwapchain, &imageCount, nullptr);
+            pOldSwapchain->handOverEffects(pLogicalSwapchain.get(), imageCount);
+        }
+        swapchainMap.set(*pSwapchain, pLogicalSwapchain);
 
         return result;
     }
 
+    // Runs on LogicalSwapchain::effectsThread. The effects only get published under the device lock once all of them are
+    // built, so presenting and the depth image hooks never see a half built chain.
+    static void createEffects(LogicalSwapchain* pLogicalSwapchain, std::vector<std::string> effectStrings)
+    {
+        LogicalDevice* pLogicalDevice = pLogicalSwapchain->pLogicalDevice;
+
+        std::vector<std::shared_ptr<Effect>> effects;
+        // Uploads of all effects go to the GPU at once, instead of each one waiting for the queue to be idle.
+        std::unique_ptr<UploadBatch> uploads(new UploadBatch(pLogicalDevice));
+        uploads->makeCurrent();
+        std::vector<std::shared_ptr<Effect>> reusableEffects = std::move(pLogicalSwapchain->reusableEffects);
+        if (reusableEffects.size())
+        {
+            // The old swapchain may still have frames in flight that use the views and framebuffers getting replaced.
+            scoped_lock queueLock(pLogicalDevice->queueLock);
+            pLogicalDevice->vkd.QueueWaitIdle(pLogicalDevice->queue);
+        }
+        auto reuseOrCreate = [&](uint32_t i, const std::vector<VkImage>& firstImages, const std::vector<VkImage>& secondImages, auto create) {
+            if (i < reusableEffects.size() && reusableEffects[i]->rebindImages(firstImages, secondImages))
+            {
+                Logger::debug("reused effect " + std::to_string(i));
+                effects.push_back(reusableEffects[i]);
+            }
+            else
+            {
+                effects.push_back(create());
+            }
+        };
+
+        auto effectsStart = std::chrono::steady_clock::now();
+        // Without mutable format support the last effect can't write the swapchain images, a transfer at the end copies to them.
+        uint32_t stepCount = effectStrings.size() + !pLogicalDevice->supportsMutableFormat;
+        auto     fakeImageSet = [&](uint32_t set) {
+            return std::vector<VkImage>(pLogicalSwapchain->fakeImages.begin() + pLogicalSwapchain->imageCount * set,
+                                        pLogicalSwapchain->fakeImages.begin() + pLogicalSwapchain->imageCount * (set + 1));
+        };
+        for (uint32_t i = 0; i < stepCount; i++)
+        {
+            if (pLogicalSwapchain->cancelEffects)
+            {
+                Logger::debug("swapchain got destroyed before its effects were created");
+                return;
+            }
+
+            std::vector<VkImage> firstImages  = fakeImageSet(fakeImageInputSet(i));
+            std::vector<VkImage> secondImages = i == stepCount - 1 ? pLogicalSwapchain->images : fakeImageSet(fakeImageOutputSet(i));
+            if (i == effectStrings.size())
+            {
+                reuseOrCreate(i, firstImages, secondImages, [&]() {
+                    return std::shared_ptr<Effect>(new TransferEffect(
+                        pLogicalDevice, pLogicalSwapchain->format, pLogicalSwapchain->imageExtent, firstImages, secondImages, pConfig.get()));
+                });
+                continue;
+            }
+
+            Logger::debug("current effectString " + effectStrings[i]);
+            reuseOrCreate(i, firstImages, secondImages, [&]() {
+                return createEffect(effectStrings[i],
+                                    pLogicalDevice,
+                                    pLogicalSwapchain->format,
+                                    pLogicalSwapchain->imageExtent,
+                                    firstImages,
+                                    secondImages,
+                                    pConfig.get());
+            });
+        }
+        // Whatever couldn't be rebound goes away here, the queue is idle.
+        reusableEffects.clear();
+        uploads->submit();
+
+        // Most of it is compiling pipelines, compare with an empty cache directory to see what the pipeline cache saves.
+        Logger::info("created effects in "
+                     + std::to_string(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - effectsStart).count())
+                     + " ms");
+        // Games don't always destroy the device before exiting.
+        savePipelineCache(pLogicalDevice);
+        pLogicalDevice->memoryAllocator.logStatistics();
+
+        Logger::debug("effect string count: " + std::to_string(effectStrings.size()));
+        Logger::debug("effect count: " + std::to_string(effects.size()));
+
+        std::unique_ptr<Profiler> profiler;
+        if (Profiler::enabled())
+        {
+            profiler.reset(Profiler::create(pLogicalDevice, pLogicalSwapchain->imageCount));
+        }
+
+        scoped_lock l(pLogicalDevice->lock);
+        scoped_lock queueLock(pLogicalDevice->queueLock);
+
+        VkImageView depthImageView = pLogicalDevice->depthImageViews.size() ? pLogicalDevice->depthImageViews[0] : VK_NULL_HANDLE;
+        VkImage     depthImage     = pLogicalDevice->depthImageViews.size() ? pLogicalDevice->depthImages[0] : VK_NULL_HANDLE;
+        VkFormat    depthFormat    = pLogicalDevice->depthImageViews.size() ? pLogicalDevice->depthFormats[0] : VK_FORMAT_UNDEFINED;
+
+        pLogicalSwapchain->effects  = std::move(effects);
+        pLogicalSwapchain->profiler = std::move(profiler);
+        pLogicalSwapchain->uploads  = std::move(uploads);
+
+        pLogicalSwapchain->commandBuffersEffect = allocateCommandBuffer(pLogicalDevice, pLogicalSwapchain->imageCount);
+        Logger::debug("allocated ComandBuffers " + std::to_string(pLogicalSwapchain->commandBuffersEffect.size()));
+
+        writeCommandBuffers(pLogicalDevice,
+                            pLogicalSwapchain->effects,
+                            depthImage,
+                            depthImageView,
+                            depthFormat,
+                            pLogicalSwapchain->commandBuffersEffect,
+                            pLogicalSwapchain->profiler.get());
+        Logger::debug("wrote CommandBuffers");
+        for (unsigned int i = 0; i < pLogicalSwapchain->imageCount; i++)
+        {
+            Logger::debug(std::to_string(i) + " writen commandbuffer " + convertToString(pLogicalSwapchain->commandBuffersEffect[i]));
+        }
+
+        pLogicalSwapchain->effectsReady.store(true, std::memory_order_release);
+    }
+
     VKAPI_ATTR VkResult VKAPI_CALL vkBasalt_GetSwapchainImagesKHR(VkDevice       device,
                                                                   VkSwapchainKHR swapchain,
                                                                   uint32_t*      pCount,
                                                                   VkImage*       pSwapchainImages)
     {
-        scoped_lock l(globalLock);
         Logger::trace("vkGetSwapchainImagesKHR " + std::to_string(*pCount));
 
-        LogicalDevice* pLogicalDevice = deviceMap[GetKey(device)].get();
+        LogicalDevice* pLogicalDevice = deviceMap.get(GetKey(device)).get();
 
         if (pSwapchainImages == nullptr)
         {
             return pLogicalDevice->vkd.GetSwapchainImagesKHR(device, swapchain, pCount, pSwapchainImages);
         }
 
-        LogicalSwapchain* pLogicalSwapchain = swapchainMap[swapchain].get();
+        scoped_lock       l(pLogicalDevice->lock);
+        LogicalSwapchain* pLogicalSwapchain = swapchainMap.get(swapchain).get();
 
         // If the images got already requested once, return them again instead of creating new images
         if (pLogicalSwapchain->fakeImages.size())
@@ -440,8 +619,8 @@ namespace vkBasalt
 
         std::vector<std::string> effectStrings = pConfig->getOption<std::vector<std::string>>("effects", {"cas"});
 
-        // create 1 more set of images when we can't use the swapchain it self
-        uint32_t fakeImageCount = *pCount * (effectStrings.size() + !pLogicalDevice->supportsMutableFormat);
+        // the transfer at the end counts as one more effect when we can't use the swapchain it self
+        uint32_t fakeImageCount = *pCount * fakeImageSetCount(effectStrings.size() + !pLogicalDevice->supportsMutableFormat, true);
 
         pLogicalSwapchain->fakeImages =
             createFakeSwapchainImages(pLogicalDevice, pLogicalSwapchain->swapchainCreateInfo, fakeImageCount, pLogicalSwapchain->fakeImageMemory);
@@ -454,118 +633,8 @@ namespace vkBasalt
             pSwapchainImages[i] = pLogicalSwapchain->fakeImages[i];
         }
 
-        VkFormat unormFormat = convertToUNORM(pLogicalSwapchain->format);
-        VkFormat srgbFormat  = convertToSRGB(pLogicalSwapchain->format);
-
-        for (uint32_t i = 0; i < effectStrings.size(); i++)
-        {
-            Logger::debug("current effectString " + effectStrings[i]);
-            std::vector<VkImage> firstImages(pLogicalSwapchain->fakeImages.begin() + pLogicalSwapchain->imageCount * i,
-                                             pLogicalSwapchain->fakeImages.begin() + pLogicalSwapchain->imageCount * (i + 1));
-            Logger::debug(std::to_string(firstImages.size()) + " images in firstImages");
-            std::vector<VkImage> secondImages;
-            if (i == effectStrings.size() - 1)
-            {
-                secondImages = pLogicalDevice->supportsMutableFormat
-                                   ? pLogicalSwapchain->images
-                                   : std::vector<VkImage>(pLogicalSwapchain->fakeImages.end() - pLogicalSwapchain->imageCount,
-                                                          pLogicalSwapchain->fakeImages.end());
-                Logger::debug("using swapchain images as second images");
-            }
-            else
-            {
-                secondImages = std::vector<VkImage>(pLogicalSwapchain->fakeImages.begin() + pLogicalSwapchain->imageCount * (i + 1),
-                                                    pLogicalSwapchain->fakeImages.begin() + pLogicalSwapchain->imageCount * (i + 2));
-                Logger::debug("not using swapchain images as second images");
-            }
-            Logger::debug(std::to_string(secondImages.size()) + " images in secondImages");
-            if (effectStrings[i] == std::string("fxaa"))
-            {
-                pLogicalSwapchain->effects.push_back(std::shared_ptr<Effect>(
-                    new FxaaEffect(pLogicalDevice, srgbFormat, pLogicalSwapchain->imageExtent, firstImages, secondImages, pConfig.get())));
-                Logger::debug("created FxaaEffect");
-            }
-            else if (effectStrings[i] == std::string("cas"))
-            {
-                pLogicalSwapchain->effects.push_back(std::shared_ptr<Effect>(
-                    new CasEffect(pLogicalDevice, unormFormat, pLogicalSwapchain->imageExtent, firstImages, secondImages, pConfig.get())));
-                Logger::debug("created CasEffect");
-            }
-            else if (effectStrings[i] == std::string("deband"))
-            {
-                pLogicalSwapchain->effects.push_back(std::shared_ptr<Effect>(
-                    new DebandEffect(pLogicalDevice, unormFormat, pLogicalSwapchain->imageExtent, firstImages, secondImages, pConfig.get())));
-                Logger::debug("created DebandEffect");
-            }
-            else if (effectStrings[i] == std::string("smaa"))
-            {
-                pLogicalSwapchain->effects.push_back(std::shared_ptr<Effect>(
-                    new SmaaEffect(pLogicalDevice, unormFormat, pLogicalSwapchain->imageExtent, firstImages, secondImages, pConfig.get())));
-                Logger::debug("created SmaaEffect");
-            }
-            else if (effectStrings[i] == std::string("lut"))
-            {
-                pLogicalSwapchain->effects.push_back(std::shared_ptr<Effect>(
-                    new LutEffect(pLogicalDevice, unormFormat, pLogicalSwapchain->imageExtent, firstImages, secondImages, pConfig.get())));
-                Logger::debug("created LutEffect");
-            }
-            else if (effectStrings[i] == std::string("dls"))
-            {
-                pLogicalSwapchain->effects.push_back(std::shared_ptr<Effect>(
-                    new DlsEffect(pLogicalDevice, unormFormat, pLogicalSwapchain->imageExtent, firstImages, secondImages, pConfig.get())));
-                Logger::debug("created DlsEffect");
-            }
-            else if (effectStrings[i] == std::string("aist"))
-            {
-                pLogicalSwapchain->effects.push_back(std::shared_ptr<Effect>(
-                    new AistEffect(pLogicalDevice, unormFormat, pLogicalSwapchain->imageExtent, firstImages, secondImages, pConfig.get())));
-                Logger::debug("created AistEffect");
-            }
-            else
-            {
-                pLogicalSwapchain->effects.push_back(std::shared_ptr<Effect>(new ReshadeEffect(pLogicalDevice,
-                                                                                               pLogicalSwapchain->format,
-                                                                                               pLogicalSwapchain->imageExtent,
-                                                                                               firstImages,
-                                                                                               secondImages,
-                                                                                               pConfig.get(),
-                                                                                               effectStrings[i])));
-                Logger::debug("created ReshadeEffect");
-            }
-        }
-
-        if (!pLogicalDevice->supportsMutableFormat)
-        {
-            pLogicalSwapchain->effects.push_back(std::shared_ptr<Effect>(new TransferEffect(
-                pLogicalDevice,
-                pLogicalSwapchain->format,
-                pLogicalSwapchain->imageExtent,
-                std::vector<VkImage>(pLogicalSwapchain->fakeImages.end() - pLogicalSwapchain->imageCount, pLogicalSwapchain->fakeImages.end()),
-                pLogicalSwapchain->images,
-                pConfig.get())));
-        }
-
-        VkImageView depthImageView = pLogicalDevice->depthImageViews.size() ? pLogicalDevice->depthImageViews[0] : VK_NULL_HANDLE;
-        VkImage     depthImage     = pLogicalDevice->depthImageViews.size() ? pLogicalDevice->depthImages[0] : VK_NULL_HANDLE;
-        VkFormat    depthFormat    = pLogicalDevice->depthImageViews.size() ? pLogicalDevice->depthFormats[0] : VK_FORMAT_UNDEFINED;
-
-        Logger::debug("effect string count: " + std::to_string(effectStrings.size()));
-        Logger::debug("effect count: " + std::to_string(pLogicalSwapchain->effects.size()));
-
-        pLogicalSwapchain->commandBuffersEffect = allocateCommandBuffer(pLogicalDevice, pLogicalSwapchain->imageCount);
-        Logger::debug("allocated ComandBuffers " + std::to_string(pLogicalSwapchain->commandBuffersEffect.size()) + " for swapchain "
-                      + convertToString(swapchain));
-
-        writeCommandBuffers(
-            pLogicalDevice, pLogicalSwapchain->effects, depthImage, depthImageView, depthFormat, pLogicalSwapchain->commandBuffersEffect);
-        Logger::debug("wrote CommandBuffers");
-
         pLogicalSwapchain->semaphores = createSemaphores(pLogicalDevice, pLogicalSwapchain->imageCount);
         Logger::debug("created semaphores");
-        for (unsigned int i = 0; i < pLogicalSwapchain->imageCount; i++)
-        {
-            Logger::debug(std::to_string(i) + " writen commandbuffer " + convertToString(pLogicalSwapchain->commandBuffersEffect[i]));
-        }
         Logger::trace("vkGetSwapchainImagesKHR");
 
         pLogicalSwapchain->defaultTransfer = std::shared_ptr<Effect>(new TransferEffect(
@@ -576,101 +645,205 @@ namespace vkBasalt
             pLogicalSwapchain->images,
             pConfig.get()));
 
-        pLogicalSwapchain->commandBuffersNoEffect = allocateCommandBuffer(pLogicalDevice, pLogicalSwapchain->imageCount);
-
-        writeCommandBuffers(pLogicalDevice,
-                            {pLogicalSwapchain->defaultTransfer},
-                            VK_NULL_HANDLE,
-                            VK_NULL_HANDLE,
-                            VK_FORMAT_UNDEFINED,
-                            pLogicalSwapchain->commandBuffersNoEffect);
+        {
+            scoped_lock queueLock(pLogicalDevice->queueLock);
+            pLogicalSwapchain->commandBuffersNoEffect = allocateCommandBuffer(pLogicalDevice, pLogicalSwapchain->imageCount);
+
+            writeCommandBuffers(pLogicalDevice,
+                                {pLogicalSwapchain->defaultTransfer},
+                                VK_NULL_HANDLE,
+                                VK_NULL_HANDLE,
+                                VK_FORMAT_UNDEFINED,
+                                pLogicalSwapchain->commandBuffersNoEffect);
+        }
 
         for (unsigned int i = 0; i < pLogicalSwapchain->imageCount; i++)
         {
             Logger::debug(std::to_string(i) + " writen commandbuffer " + convertToString(pLogicalSwapchain->commandBuffersNoEffect[i]));
         }
 
+        // Compiling shaders and uploading textures takes seconds, the game keeps presenting without effects meanwhile.
+        pLogicalSwapchain->effectsThread = std::thread(createEffects, pLogicalSwapchain, std::move(effectStrings));
+
         return result;
     }
 
-    VKAPI_ATTR VkResult VKAPI_CALL vkBasalt_QueuePresentKHR(VkQueue queue, const VkPresentInfoKHR* pPresentInfo)
+    // Effect threads submit uploads to the queue the layer shares with the application, Vulkan wants every use of a queue
+    // externally synchronized, so the application's submits on it take queueLock as well. queue itself is written under
+    // queueLock, so it is compared with queueLock held.
+    template<typename Call>
+    static VkResult callSynchronized(LogicalDevice* pLogicalDevice, VkQueue queue, Call call)
     {
-        scoped_lock l(globalLock);
+        std::unique_lock<std::mutex> queueLock(pLogicalDevice->queueLock);
+        if (queue != pLogicalDevice->queue)
+        {
+            queueLock.unlock();
+        }
+        return call();
+    }
 
+    VKAPI_ATTR VkResult VKAPI_CALL vkBasalt_QueueSubmit(VkQueue queue, uint32_t submitCount, const VkSubmitInfo* pSubmits, VkFence fence)
+    {
+        LogicalDevice* pLogicalDevice = deviceMap.get(GetKey(queue)).get();
+        return callSynchronized(
+            pLogicalDevice, queue, [&]() { return pLogicalDevice->vkd.QueueSubmit(queue, submitCount, pSubmits, fence); });
+    }
+
+    // DXVK 2 only submits through vkQueueSubmit2.
+    VKAPI_ATTR VkResult VKAPI_CALL vkBasalt_QueueSubmit2(VkQueue queue, uint32_t submitCount, const void* pSubmits, VkFence fence)
+    {
+        LogicalDevice* pLogicalDevice = deviceMap.get(GetKey(queue)).get();
+        return callSynchronized(
+            pLogicalDevice, queue, [&]() { return pLogicalDevice->queueSubmit2(queue, submitCount, pSubmits, fence); });
+    }
+
+    VKAPI_ATTR VkResult VKAPI_CALL vkBasalt_QueueSubmit2KHR(VkQueue queue, uint32_t submitCount, const void* pSubmits, VkFence fence)
+    {
+        LogicalDevice* pLogicalDevice = deviceMap.get(GetKey(queue)).get();
+        return callSynchronized(
+            pLogicalDevice, queue, [&]() { return pLogicalDevice->queueSubmit2KHR(queue, submitCount, pSubmits, fence); });
+    }
+
+    VKAPI_ATTR VkResult VKAPI_CALL vkBasalt_QueueBindSparse(VkQueue                 queue,
+                                                            uint32_t                bindInfoCount,
+                                                            const VkBindSparseInfo* pBindInfo,
+                                                            VkFence                 fence)
+    {
+        LogicalDevice* pLogicalDevice = deviceMap.get(GetKey(queue)).get();
+        return callSynchronized(
+            pLogicalDevice, queue, [&]() { return pLogicalDevice->vkd.QueueBindSparse(queue, bindInfoCount, pBindInfo, fence); });
+    }
+
+    VKAPI_ATTR VkResult VKAPI_CALL vkBasalt_QueueWaitIdle(VkQueue queue)
+    {
+        LogicalDevice* pLogicalDevice = deviceMap.get(GetKey(queue)).get();
+        return callSynchronized(pLogicalDevice, queue, [&]() { return pLogicalDevice->vkd.QueueWaitIdle(queue); });
+    }
+
+    VKAPI_ATTR VkResult VKAPI_CALL vkBasalt_DeviceWaitIdle(VkDevice device)
+    {
+        LogicalDevice* pLogicalDevice = deviceMap.get(GetKey(device)).get();
+        scoped_lock    queueLock(pLogicalDevice->queueLock);
+        return pLogicalDevice->vkd.DeviceWaitIdle(device);
+    }
+
+    VKAPI_ATTR VkResult VKAPI_CALL vkBasalt_QueuePresentKHR(VkQueue queue, const VkPresentInfoKHR* pPresentInfo)
+    {
         static uint32_t keySymbol = convertToKeySym(pConfig->getOption<std::string>("toggleKey", "Home"));
 
-        static bool pressed       = false;
-        static bool presentEffect = true;
+        // Shared by every device, which may present from different threads.
+        static std::atomic<bool> pressed       = false;
+        static std::atomic<bool> presentEffect = true;
 
-        if (isKeyPressed(keySymbol))
+        // Only reads the snapshot of the input thread, no round trip to the X server.
+        bool keyDown = isKeyPressed(keySymbol);
+        if (pressed.exchange(keyDown) != keyDown && keyDown)
         {
-            if (!pressed)
-            {
-                presentEffect = !presentEffect;
-                pressed       = true;
-            }
-        }
-        else
-        {
-            pressed = false;
+            presentEffect = !presentEffect;
         }
 
-        LogicalDevice* pLogicalDevice = deviceMap[GetKey(queue)].get();
+        LogicalDevice* pLogicalDevice = deviceMap.get(GetKey(queue)).get();
+        // Effects and swapchains of this device, the queue is also used by effect threads for uploads. Both are released
+        // before presenting.
+        std::unique_lock<std::mutex> l(pLogicalDevice->lock);
+        std::unique_lock<std::mutex> queueLock(pLogicalDevice->queueLock);
 
         std::vector<VkSemaphore> presentSemaphores;
         presentSemaphores.reserve(pPresentInfo->swapchainCount);
 
+        std::vector<VkSemaphore>          waitSemaphores(pPresentInfo->pWaitSemaphores, pPresentInfo->pWaitSemaphores + pPresentInfo->waitSemaphoreCount);
         std::vector<VkPipelineStageFlags> waitStages(pPresentInfo->waitSemaphoreCount, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
 
         for (unsigned int i = 0; i < (*pPresentInfo).swapchainCount; i++)
         {
             uint32_t          index             = (*pPresentInfo).pImageIndices[i];
             VkSwapchainKHR    swapchain         = (*pPresentInfo).pSwapchains[i];
-            LogicalSwapchain* pLogicalSwapchain = swapchainMap[swapchain].get();
+            LogicalSwapchain* pLogicalSwapchain = swapchainMap.get(swapchain).get();
+            // Without effects until the effect thread is done with them.
+            bool useEffects = presentEffect && pLogicalSwapchain->effectsReady.load(std::memory_order_acquire);
 
             for (auto& effect : pLogicalSwapchain->effects)
             {
-                effect->updateEffect();
+                effect->updateEffect(index);
+            }
+
+            if (i > 0)
+            {
+                waitSemaphores.clear();
+                waitStages.clear();
+            }
+            if (useEffects && pLogicalSwapchain->uploads)
+            {
+                VkSemaphore uploadSemaphore = pLogicalSwapchain->uploads->takeSemaphore();
+                if (uploadSemaphore != VK_NULL_HANDLE)
+                {
+                    waitSemaphores.push_back(uploadSemaphore);
+                    waitStages.push_back(VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+                }
+                else
+                {
+                    // Only the staging memory goes, the wait for the semaphore may still be pending.
+                    pLogicalSwapchain->uploads->releaseStaging();
+                }
             }
 
             VkSubmitInfo submitInfo;
             submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
             submitInfo.pNext              = nullptr;
-            submitInfo.waitSemaphoreCount = i == 0 ? pPresentInfo->waitSemaphoreCount : 0;
-            submitInfo.pWaitSemaphores    = i == 0 ? pPresentInfo->pWaitSemaphores : nullptr;
-            submitInfo.pWaitDstStageMask  = i == 0 ? waitStages.data() : nullptr;
+            submitInfo.waitSemaphoreCount = waitSemaphores.size();
+            submitInfo.pWaitSemaphores    = waitSemaphores.data();
+            submitInfo.pWaitDstStageMask  = waitStages.data();
             submitInfo.commandBufferCount = 1;
             submitInfo.pCommandBuffers =
-                presentEffect ? &(pLogicalSwapchain->commandBuffersEffect[index]) : &(pLogicalSwapchain->commandBuffersNoEffect[index]);
+                useEffects ? &(pLogicalSwapchain->commandBuffersEffect[index]) : &(pLogicalSwapchain->commandBuffersNoEffect[index]);
             submitInfo.signalSemaphoreCount = 1;
             submitInfo.pSignalSemaphores    = &(pLogicalSwapchain->semaphores[index]);
 
             presentSemaphores.push_back(pLogicalSwapchain->semaphores[index]);
 
+            Profiler* pProfiler = useEffects ? pLogicalSwapchain->profiler.get() : nullptr;
+            if (pProfiler)
+            {
+                // The previous submission of this image is usually done by now, its results don't need waiting for.
+                pProfiler->collect(index);
+            }
+
             VkResult vr = pLogicalDevice->vkd.QueueSubmit(pLogicalDevice->queue, 1, &submitInfo, VK_NULL_HANDLE);
 
             if (vr != VK_SUCCESS)
             {
                 return vr;
             }
+            if (pProfiler)
+            {
+                pProfiler->submitted(index);
+            }
         }
 
         VkPresentInfoKHR presentInfo   = *pPresentInfo;
         presentInfo.waitSemaphoreCount = presentSemaphores.size();
         presentInfo.pWaitSemaphores    = presentSemaphores.data();
 
-        return pLogicalDevice->vkd.QueuePresentKHR(queue, &presentInfo);
+        // A present blocked by vsync must not stall uploads and application submits, so queueLock is only taken again if
+        // the present goes to the queue the layer submits to.
+        queueLock.unlock();
+        l.unlock();
+        return callSynchronized(pLogicalDevice, queue, [&]() { return pLogicalDevice->vkd.QueuePresentKHR(queue, &presentInfo); });
     }
 
     VKAPI_ATTR void VKAPI_CALL vkBasalt_DestroySwapchainKHR(VkDevice device, VkSwapchainKHR swapchain, const VkAllocationCallbacks* pAllocator)
     {
-        scoped_lock l(globalLock);
         // we need to delete the infos of the oldswapchain
 
         Logger::trace("vkDestroySwapchainKHR " + convertToString(swapchain));
-        swapchainMap[swapchain]->destroy();
+        LogicalDevice*                    pLogicalDevice    = deviceMap.get(GetKey(device)).get();
+        std::shared_ptr<LogicalSwapchain> pLogicalSwapchain = swapchainMap.get(swapchain);
+        // Before locking, the effect thread takes the device lock to finish.
+        pLogicalSwapchain->stopEffectsThread();
+
+        scoped_lock l(pLogicalDevice->lock);
+        pLogicalSwapchain->destroy();
         swapchainMap.erase(swapchain);
-        LogicalDevice* pLogicalDevice = deviceMap[GetKey(device)].get();
 
         pLogicalDevice->vkd.DestroySwapchainKHR(device, swapchain, pAllocator);
     }
@@ -680,9 +853,8 @@ namespace vkBasalt
                                                         const VkAllocationCallbacks* pAllocator,
                                                         VkImage*                     pImage)
     {
-        scoped_lock l(globalLock);
-
-        LogicalDevice* pLogicalDevice = deviceMap[GetKey(device)].get();
+        // Most images aren't depth images, those get created without taking any lock.
+        LogicalDevice* pLogicalDevice = deviceMap.get(GetKey(device)).get();
         if (isDepthFormat(pCreateInfo->format) && pCreateInfo->samples == VK_SAMPLE_COUNT_1_BIT
             && ((pCreateInfo->usage & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) == VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT))
         {
@@ -693,7 +865,8 @@ namespace vkBasalt
 
             VkImageCreateInfo modifiedCreateInfo = *pCreateInfo;
             modifiedCreateInfo.usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
-            VkResult result = pLogicalDevice->vkd.CreateImage(device, &modifiedCreateInfo, pAllocator, pImage);
+            VkResult    result = pLogicalDevice->vkd.CreateImage(device, &modifiedCreateInfo, pAllocator, pImage);
+            scoped_lock l(pLogicalDevice->lock);
             pLogicalDevice->depthImages.push_back(*pImage);
             pLogicalDevice->depthFormats.push_back(pCreateInfo->format);
 
@@ -707,11 +880,10 @@ namespace vkBasalt
 
     VKAPI_ATTR VkResult VKAPI_CALL vkBasalt_BindImageMemory(VkDevice device, VkImage image, VkDeviceMemory memory, VkDeviceSize memoryOffset)
     {
-        scoped_lock l(globalLock);
+        LogicalDevice* pLogicalDevice = deviceMap.get(GetKey(device)).get();
 
-        LogicalDevice* pLogicalDevice = deviceMap[GetKey(device)].get();
-
-        VkResult result = pLogicalDevice->vkd.BindImageMemory(device, image, memory, memoryOffset);
+        VkResult    result = pLogicalDevice->vkd.BindImageMemory(device, image, memory, memoryOffset);
+        scoped_lock l(pLogicalDevice->lock);
         // TODO what if the application creates more than one image before binding memory?
         if (pLogicalDevice->depthImages.size() && image == pLogicalDevice->depthImages.back())
         {
@@ -731,13 +903,14 @@ namespace vkBasalt
                 return result;
             }
 
-            for (auto& it : swapchainMap)
+            for (auto& it : *swapchainMap.load())
             {
                 LogicalSwapchain* pLogicalSwapchain = it.second.get();
                 if (pLogicalSwapchain->pLogicalDevice == pLogicalDevice)
                 {
                     if (pLogicalSwapchain->commandBuffersEffect.size())
                     {
+                        scoped_lock queueLock(pLogicalDevice->queueLock);
                         pLogicalDevice->vkd.FreeCommandBuffers(pLogicalDevice->device,
                                                                pLogicalDevice->commandPool,
                                                                pLogicalSwapchain->commandBuffersEffect.size(),
@@ -746,8 +919,13 @@ namespace vkBasalt
                         pLogicalSwapchain->commandBuffersEffect = allocateCommandBuffer(pLogicalDevice, pLogicalSwapchain->imageCount);
                         Logger::debug("allocated CommandBuffers for swapchain " + convertToString(it.first));
 
-                        writeCommandBuffers(
-                            pLogicalDevice, pLogicalSwapchain->effects, image, depthImageView, depthFormat, pLogicalSwapchain->commandBuffersEffect);
+                        writeCommandBuffers(pLogicalDevice,
+                                            pLogicalSwapchain->effects,
+                                            image,
+                                            depthImageView,
+                                            depthFormat,
+                                            pLogicalSwapchain->commandBuffersEffect,
+                                            pLogicalSwapchain->profiler.get());
                         Logger::debug("wrote CommandBuffers");
                     }
                 }
@@ -758,9 +936,8 @@ namespace vkBasalt
 
     VKAPI_ATTR void VKAPI_CALL vkBasalt_DestroyImage(VkDevice device, VkImage image, const VkAllocationCallbacks* pAllocator)
     {
-        scoped_lock l(globalLock);
-
-        LogicalDevice* pLogicalDevice = deviceMap[GetKey(device)].get();
+        LogicalDevice* pLogicalDevice = deviceMap.get(GetKey(device)).get();
+        scoped_lock    l(pLogicalDevice->lock);
 
         for (uint32_t i = 0; i < pLogicalDevice->depthImages.size(); i++)
         {
@@ -778,13 +955,14 @@ namespace vkBasalt
                 VkImageView depthImageView = pLogicalDevice->depthImageViews.size() ? pLogicalDevice->depthImageViews[0] : VK_NULL_HANDLE;
                 VkImage     depthImage     = pLogicalDevice->depthImageViews.size() ? pLogicalDevice->depthImages[0] : VK_NULL_HANDLE;
                 VkFormat    depthFormat    = pLogicalDevice->depthImageViews.size() ? pLogicalDevice->depthFormats[0] : VK_FORMAT_UNDEFINED;
-                for (auto& it : swapchainMap)
+                for (auto& it : *swapchainMap.load())
                 {
                     LogicalSwapchain* pLogicalSwapchain = it.second.get();
                     if (pLogicalSwapchain->pLogicalDevice == pLogicalDevice)
                     {
                         if (pLogicalSwapchain->commandBuffersEffect.size())
                         {
+                            scoped_lock queueLock(pLogicalDevice->queueLock);
                             pLogicalDevice->vkd.FreeCommandBuffers(pLogicalDevice->device,
                                                                    pLogicalDevice->commandPool,
                                                                    pLogicalSwapchain->commandBuffersEffect.size(),
@@ -798,7 +976,8 @@ namespace vkBasalt
                                                 depthImage,
                                                 depthImageView,
                                                 depthFormat,
-                                                pLogicalSwapchain->commandBuffersEffect);
+                                                pLogicalSwapchain->commandBuffersEffect,
+                                                pLogicalSwapchain->profiler.get());
                             Logger::debug("wrote CommandBuffers");
                         }
                     }
@@ -865,8 +1044,7 @@ namespace vkBasalt
                 return VK_SUCCESS;
             }
 
-            scoped_lock l(globalLock);
-            return instanceDispatchMap[GetKey(physicalDevice)].EnumerateDeviceExtensionProperties(
+            return instanceDispatchMap.get(GetKey(physicalDevice)).EnumerateDeviceExtensionProperties(
                 physicalDevice, pLayerName, pPropertyCount, pProperties);
         }
 
@@ -915,6 +1093,10 @@ extern "C"
     GETPROCADDR(CreateSwapchainKHR);                                                                                                                 \
     GETPROCADDR(GetSwapchainImagesKHR);                                                                                                              \
     GETPROCADDR(QueuePresentKHR);                                                                                                                    \
+    GETPROCADDR(QueueSubmit);                                                                                                                        \
+    GETPROCADDR(QueueBindSparse);                                                                                                                    \
+    GETPROCADDR(QueueWaitIdle);                                                                                                                      \
+    GETPROCADDR(DeviceWaitIdle);                                                                                                                     \
     GETPROCADDR(DestroySwapchainKHR);                                                                                                                \
                                                                                                                                                      \
     if (vkBasalt::pConfig->getOption<std::string>("depthCapture", "off") == "on")                                                                    \
@@ -933,10 +1115,14 @@ extern "C"
 
         INTERCEPT_CALLS
 
-        {
-            vkBasalt::scoped_lock l(vkBasalt::globalLock);
-            return vkBasalt::deviceMap[vkBasalt::GetKey(device)]->vkd.GetDeviceProcAddr(device, pName);
-        }
+        vkBasalt::LogicalDevice* pLogicalDevice = vkBasalt::deviceMap.get(vkBasalt::GetKey(device)).get();
+        // Only intercepted if the device has them, the application has to get null otherwise.
+        if (!std::strcmp(pName, "vkQueueSubmit2") && pLogicalDevice->queueSubmit2)
+            return (PFN_vkVoidFunction) &vkBasalt::vkBasalt_QueueSubmit2;
+        if (!std::strcmp(pName, "vkQueueSubmit2KHR") && pLogicalDevice->queueSubmit2KHR)
+            return (PFN_vkVoidFunction) &vkBasalt::vkBasalt_QueueSubmit2KHR;
+
+        return pLogicalDevice->vkd.GetDeviceProcAddr(device, pName);
     }
 
     VK_LAYER_EXPORT PFN_vkVoidFunction VKAPI_CALL vkBasalt_GetInstanceProcAddr(VkInstance instance, const char* pName)
@@ -948,10 +1134,7 @@ extern "C"
 
         INTERCEPT_CALLS
 
-        {
-            vkBasalt::scoped_lock l(vkBasalt::globalLock);
-            return vkBasalt::instanceDispatchMap[vkBasalt::GetKey(instance)].GetInstanceProcAddr(instance, pName);
-        }
+        return vkBasalt::instanceDispatchMap.get(vkBasalt::GetKey(instance)).GetInstanceProcAddr(instance, pName);
     }
 
 } // extern "C"
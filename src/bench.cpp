@@ -0,0 +1,641 @@
+// vkbasalt-bench: runs an effect chain on frames loaded from PNG files, without a window or a swapchain.
+// Reports CPU time of recording every effect and GPU time of every effect and AIST layer.
+
+#include <dlfcn.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "vulkan_include.hpp"
+
+#include "logical_device.hpp"
+#include "command_buffer.hpp"
+#include "config.hpp"
+#include "effect.hpp"
+#include "effect_factory.hpp"
+#include "fake_swapchain.hpp"
+#include "image.hpp"
+#include "memory.hpp"
+#include "pipeline_cache.hpp"
+#include "profiler.hpp"
+#include "upload_batch.hpp"
+#include "util.hpp"
+
+#include "stb_image.h"
+#include "stb_image_resize.h"
+
+namespace vkBasalt
+{
+    Logger Logger::s_instance;
+} // namespace vkBasalt
+
+using namespace vkBasalt;
+
+namespace
+{
+    struct Options
+    {
+        uint32_t                                         frames      = 300;
+        uint32_t                                         recordRuns  = 10;
+        uint32_t                                         deviceIndex = 0;
+        VkExtent2D                                       extent      = {0, 0};
+        std::vector<std::string>                         effects;
+        std::vector<std::pair<std::string, std::string>> overrides;
+        std::vector<std::string>                         frameFiles;
+        std::string                                      csvFile;
+    };
+
+    void printUsage()
+    {
+        std::fprintf(stderr,
+                     "usage: vkbasalt-bench [options] [frame.png...]\n"
+                     "  --effects a:b:c    effect chain, defaults to the effects option of the config\n"
+                     "  --set key=value    overrides a config option, may be repeated\n"
+                     "  --size WxH         resolution, defaults to the size of the first frame or 1920x1080\n"
+                     "  --frames N         frames to submit, 300 by default\n"
+                     "  --record-runs N    times every command buffer is recorded for CPU timing, 10 by default\n"
+                     "  --device N         index of the physical device, 0 by default\n"
+                     "  --csv file         where GPU times go, see VKBASALT_PROFILE_FILE\n"
+                     "Without frames, 3 synthetic gradient frames are used.\n");
+    }
+
+    std::vector<std::string> split(const std::string& value, char separator)
+    {
+        std::vector<std::string> parts;
+        size_t                   start = 0;
+        while (true)
+        {
+            size_t end = value.find(separator, start);
+            parts.push_back(value.substr(start, end - start));
+            if (end == std::string::npos)
+            {
+                return parts;
+            }
+            start = end + 1;
+        }
+    }
+
+    // Unlike std::stoul, rejects signs, trailing garbage and values above 32 bit instead of throwing or truncating.
+    bool parseNumber(const std::string& value, uint32_t& number)
+    {
+        char*         end    = nullptr;
+        unsigned long parsed = std::strtoul(value.c_str(), &end, 10);
+        if (value[0] < '0' || value[0] > '9' || *end != '\0' || parsed > UINT32_MAX)
+        {
+            return false;
+        }
+        number = parsed;
+        return true;
+    }
+
+    bool parseOptions(int argc, char** argv, Options& options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            if (arg.rfind("--", 0) != 0)
+            {
+                options.frameFiles.push_back(arg);
+                continue;
+            }
+            if (i + 1 == argc)
+            {
+                return false;
+            }
+            std::string value = argv[++i];
+            if (arg == "--effects")
+            {
+                options.effects = split(value, ':');
+            }
+            else if (arg == "--set")
+            {
+                size_t equals = value.find('=');
+                if (equals == std::string::npos)
+                {
+                    return false;
+                }
+                options.overrides.emplace_back(value.substr(0, equals), value.substr(equals + 1));
+            }
+            else if (arg == "--size")
+            {
+                if (std::sscanf(value.c_str(), "%ux%u", &options.extent.width, &options.extent.height) != 2)
+                {
+                    return false;
+                }
+            }
+            else if (arg == "--frames")
+            {
+                if (!parseNumber(value, options.frames))
+                {
+                    return false;
+                }
+            }
+            else if (arg == "--record-runs")
+            {
+                if (!parseNumber(value, options.recordRuns))
+                {
+                    return false;
+                }
+            }
+            else if (arg == "--device")
+            {
+                if (!parseNumber(value, options.deviceIndex))
+                {
+                    return false;
+                }
+            }
+            else if (arg == "--csv")
+            {
+                options.csvFile = value;
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return options.frames > 0 && options.recordRuns > 0;
+    }
+
+    // BGRA pixels of every frame at the requested extent.
+    std::vector<std::vector<unsigned char>> loadFrames(Options& options)
+    {
+        std::vector<std::vector<unsigned char>> frames;
+        for (const auto& fileName : options.frameFiles)
+        {
+            int            width, height, channels;
+            unsigned char* pixels = stbi_load(fileName.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+            if (!pixels)
+            {
+                Logger::err("can't load " + fileName + ": " + stbi_failure_reason());
+                return {};
+            }
+            if (options.extent.width == 0)
+            {
+                options.extent = {uint32_t(width), uint32_t(height)};
+            }
+            std::vector<unsigned char> frame(options.extent.width * options.extent.height * 4);
+            if (uint32_t(width) == options.extent.width && uint32_t(height) == options.extent.height)
+            {
+                std::memcpy(frame.data(), pixels, frame.size());
+            }
+            else
+            {
+                stbir_resize_uint8(pixels, width, height, 0, frame.data(), options.extent.width, options.extent.height, 0, 4);
+            }
+            stbi_image_free(pixels);
+            for (size_t i = 0; i < frame.size(); i += 4)
+            {
+                std::swap(frame[i], frame[i + 2]);
+            }
+            frames.push_back(std::move(frame));
+        }
+
+        if (frames.empty())
+        {
+            if (options.extent.width == 0)
+            {
+                options.extent = {1920, 1080};
+            }
+            for (uint32_t f = 0; f < 3; f++)
+            {
+                std::vector<unsigned char> frame(options.extent.width * options.extent.height * 4);
+                for (uint32_t y = 0; y < options.extent.height; y++)
+                {
+                    for (uint32_t x = 0; x < options.extent.width; x++)
+                    {
+                        unsigned char* pixel = &frame[(y * options.extent.width + x) * 4];
+                        pixel[0]             = 255 * x / options.extent.width;
+                        pixel[1]             = 255 * y / options.extent.height;
+                        pixel[2]             = 85 * f;
+                        pixel[3]             = 255;
+                    }
+                }
+                frames.push_back(std::move(frame));
+            }
+        }
+        return frames;
+    }
+
+    struct Vulkan
+    {
+        void*                        loader   = nullptr;
+        VkInstance                   instance = VK_NULL_HANDLE;
+        VkLayerInstanceDispatchTable vki;
+        LogicalDevice                device;
+    };
+
+    bool createDevice(const Options& options, Vulkan& vulkan)
+    {
+        // Don't let an installed vkBasalt layer process the benchmark itself.
+        setenv("DISABLE_VKBASALT", "1", 1);
+        vulkan.loader = dlopen("libvulkan.so.1", RTLD_NOW | RTLD_LOCAL);
+        if (!vulkan.loader)
+        {
+            Logger::err("can't load libvulkan.so.1");
+            return false;
+        }
+        auto gipa           = (PFN_vkGetInstanceProcAddr) dlsym(vulkan.loader, "vkGetInstanceProcAddr");
+        auto createInstance = (PFN_vkCreateInstance) gipa(VK_NULL_HANDLE, "vkCreateInstance");
+
+        VkApplicationInfo appInfo;
+        appInfo.sType              = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+        appInfo.pNext              = nullptr;
+        appInfo.pApplicationName   = "vkbasalt-bench";
+        appInfo.applicationVersion = 0;
+        appInfo.pEngineName        = nullptr;
+        appInfo.engineVersion      = 0;
+        appInfo.apiVersion         = VK_API_VERSION_1_2;
+
+        VkInstanceCreateInfo instanceInfo = {};
+        instanceInfo.sType                = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+        instanceInfo.pApplicationInfo     = &appInfo;
+        VkResult result                   = createInstance(&instanceInfo, nullptr, &vulkan.instance);
+        if (result != VK_SUCCESS)
+        {
+            Logger::err("vkCreateInstance failed: " + std::to_string(result));
+            return false;
+        }
+        layer_init_instance_dispatch_table(vulkan.instance, &vulkan.vki, gipa);
+
+        uint32_t physicalDeviceCount = 0;
+        vulkan.vki.EnumeratePhysicalDevices(vulkan.instance, &physicalDeviceCount, nullptr);
+        std::vector<VkPhysicalDevice> physicalDevices(physicalDeviceCount);
+        vulkan.vki.EnumeratePhysicalDevices(vulkan.instance, &physicalDeviceCount, physicalDevices.data());
+        if (options.deviceIndex >= physicalDeviceCount)
+        {
+            Logger::err("no physical device " + std::to_string(options.deviceIndex) + ", found " + std::to_string(physicalDeviceCount));
+            return false;
+        }
+        VkPhysicalDevice physicalDevice = physicalDevices[options.deviceIndex];
+
+        VkPhysicalDeviceProperties properties;
+        vulkan.vki.GetPhysicalDeviceProperties(physicalDevice, &properties);
+        Logger::info(std::string("device: ") + properties.deviceName);
+
+        uint32_t familyCount = 0;
+        vulkan.vki.GetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> families(familyCount);
+        vulkan.vki.GetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+        uint32_t familyIndex = 0;
+        while (familyIndex < familyCount
+               && (families[familyIndex].queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))
+                      != (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))
+        {
+            familyIndex++;
+        }
+        if (familyIndex == familyCount)
+        {
+            Logger::err("no graphics and compute queue");
+            return false;
+        }
+
+        // Same features the layer enables in the application's device, where the device has them.
+        VkPhysicalDeviceUniformBufferStandardLayoutFeatures ubslFeatures = {};
+        ubslFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_UNIFORM_BUFFER_STANDARD_LAYOUT_FEATURES;
+        VkPhysicalDevice16BitStorageFeatures storage16BitFeatures = {};
+        storage16BitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_16BIT_STORAGE_FEATURES;
+        storage16BitFeatures.pNext = &ubslFeatures;
+        VkPhysicalDeviceFeatures2 features = {};
+        features.sType                     = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext                     = &storage16BitFeatures;
+        vulkan.vki.GetPhysicalDeviceFeatures2(physicalDevice, &features);
+
+        VkPhysicalDeviceFeatures enabledFeatures  = {};
+        enabledFeatures.shaderImageGatherExtended = features.features.shaderImageGatherExtended;
+        enabledFeatures.textureCompressionBC      = features.features.textureCompressionBC;
+        storage16BitFeatures                      = {
+            .sType                    = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_16BIT_STORAGE_FEATURES,
+            .pNext                    = &ubslFeatures,
+            .storageBuffer16BitAccess = storage16BitFeatures.storageBuffer16BitAccess,
+        };
+        ubslFeatures.pNext = nullptr;
+
+        uint32_t extensionCount = 0;
+        vulkan.vki.EnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+        std::vector<VkExtensionProperties> extensions(extensionCount);
+        vulkan.vki.EnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensions.data());
+        std::vector<const char*> enabledExtensions;
+        // The effects move images from and to the present layout.
+        for (const char* wanted : {"VK_KHR_swapchain", "VK_KHR_image_format_list", "VK_KHR_uniform_buffer_standard_layout", "VK_KHR_16bit_storage"})
+        {
+            for (const auto& extension : extensions)
+            {
+                if (std::strcmp(extension.extensionName, wanted) == 0)
+                {
+                    enabledExtensions.push_back(wanted);
+                }
+            }
+        }
+
+        float                   priority  = 1.0f;
+        VkDeviceQueueCreateInfo queueInfo = {};
+        queueInfo.sType                   = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+        queueInfo.queueFamilyIndex        = familyIndex;
+        queueInfo.queueCount              = 1;
+        queueInfo.pQueuePriorities        = &priority;
+
+        VkDeviceCreateInfo deviceInfo      = {};
+        deviceInfo.sType                   = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        deviceInfo.pNext                   = &storage16BitFeatures;
+        deviceInfo.queueCreateInfoCount    = 1;
+        deviceInfo.pQueueCreateInfos       = &queueInfo;
+        deviceInfo.enabledExtensionCount   = enabledExtensions.size();
+        deviceInfo.ppEnabledExtensionNames = enabledExtensions.data();
+        deviceInfo.pEnabledFeatures        = &enabledFeatures;
+
+        VkDevice device;
+        result = vulkan.vki.CreateDevice(physicalDevice, &deviceInfo, nullptr, &device);
+        if (result != VK_SUCCESS)
+        {
+            Logger::err("vkCreateDevice failed: " + std::to_string(result));
+            return false;
+        }
+
+        LogicalDevice& logicalDevice = vulkan.device;
+        auto           gdpa          = (PFN_vkGetDeviceProcAddr) gipa(vulkan.instance, "vkGetDeviceProcAddr");
+        layer_init_device_dispatch_table(device, &logicalDevice.vkd, gdpa);
+        logicalDevice.vki                   = vulkan.vki;
+        logicalDevice.device                = device;
+        logicalDevice.physicalDevice        = physicalDevice;
+        logicalDevice.instance              = vulkan.instance;
+        logicalDevice.queueFamilyIndex      = familyIndex;
+        logicalDevice.supportsMutableFormat        = false;
+        logicalDevice.supportsStorage16Bit         = storage16BitFeatures.storageBuffer16BitAccess;
+        logicalDevice.supportsTextureCompressionBC = enabledFeatures.textureCompressionBC;
+        logicalDevice.vkd.GetDeviceQueue(device, familyIndex, 0, &logicalDevice.queue);
+
+        VkCommandPoolCreateInfo commandPoolInfo = {};
+        commandPoolInfo.sType                   = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        // Command buffers get recorded several times for CPU timing.
+        commandPoolInfo.flags            = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        commandPoolInfo.queueFamilyIndex = familyIndex;
+        result = logicalDevice.vkd.CreateCommandPool(device, &commandPoolInfo, nullptr, &logicalDevice.commandPool);
+        ASSERT_VULKAN(result);
+        return result == VK_SUCCESS;
+    }
+
+    // The effects expect their images in the layout a presented image has.
+    // The first uploadedCount images hold frames from uploadToImage, the rest gets written by effects.
+    void moveToPresentLayout(LogicalDevice* pLogicalDevice, const std::vector<VkImage>& images, uint32_t uploadedCount)
+    {
+        VkCommandBuffer commandBuffer = allocateCommandBuffer(pLogicalDevice, 1)[0];
+
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType                    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags                    = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        pLogicalDevice->vkd.BeginCommandBuffer(commandBuffer, &beginInfo);
+
+        VkImageMemoryBarrier memoryBarrier            = {};
+        memoryBarrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        memoryBarrier.srcAccessMask                   = VK_ACCESS_SHADER_READ_BIT;
+        memoryBarrier.dstAccessMask                   = VK_ACCESS_MEMORY_READ_BIT;
+        memoryBarrier.newLayout                       = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        memoryBarrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+        memoryBarrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+        memoryBarrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+        memoryBarrier.subresourceRange.levelCount     = 1;
+        memoryBarrier.subresourceRange.layerCount     = 1;
+        for (size_t i = 0; i < images.size(); i++)
+        {
+            memoryBarrier.image     = images[i];
+            memoryBarrier.oldLayout = i < uploadedCount ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+            pLogicalDevice->vkd.CmdPipelineBarrier(
+                commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &memoryBarrier);
+        }
+        pLogicalDevice->vkd.EndCommandBuffer(commandBuffer);
+
+        VkSubmitInfo submitInfo       = {};
+        submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers    = &commandBuffer;
+        pLogicalDevice->vkd.QueueSubmit(pLogicalDevice->queue, 1, &submitInfo, VK_NULL_HANDLE);
+        pLogicalDevice->vkd.QueueWaitIdle(pLogicalDevice->queue);
+        pLogicalDevice->vkd.FreeCommandBuffers(pLogicalDevice->device, pLogicalDevice->commandPool, 1, &commandBuffer);
+    }
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage();
+        return 2;
+    }
+    std::vector<std::vector<unsigned char>> frames = loadFrames(options);
+    if (frames.empty())
+    {
+        return 1;
+    }
+
+    Vulkan vulkan;
+    if (!createDevice(options, vulkan))
+    {
+        return 1;
+    }
+    LogicalDevice* pLogicalDevice = &vulkan.device;
+
+    Config config;
+    for (const auto& [option, value] : options.overrides)
+    {
+        config.setOption(option, value);
+    }
+    if (options.effects.empty())
+    {
+        options.effects = config.getOption<std::vector<std::string>>("effects", {"cas"});
+    }
+
+    // Frames play the part of swapchain images, the effects take turns writing the two sets after them, like in the layer.
+    uint32_t                 imageCount    = frames.size();
+    VkSwapchainCreateInfoKHR swapchainInfo = {};
+    swapchainInfo.imageFormat              = VK_FORMAT_B8G8R8A8_UNORM;
+    swapchainInfo.imageExtent              = options.extent;
+    swapchainInfo.imageArrayLayers         = 1;
+    swapchainInfo.imageUsage               = VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    swapchainInfo.imageSharingMode         = VK_SHARING_MODE_EXCLUSIVE;
+    MemoryAllocation     imageMemory;
+    std::vector<VkImage> images =
+        createFakeSwapchainImages(pLogicalDevice, swapchainInfo, imageCount * fakeImageSetCount(options.effects.size(), false), imageMemory);
+    VkExtent3D extent = {options.extent.width, options.extent.height, 1};
+    for (uint32_t i = 0; i < imageCount; i++)
+    {
+        uploadToImage(pLogicalDevice, images[i], extent, swapchainInfo.imageFormat, frames[i].size(), frames[i].data());
+    }
+    moveToPresentLayout(pLogicalDevice, images, imageCount);
+
+    // Run twice to compare creating the pipelines with an empty and a warm pipeline cache.
+    pLogicalDevice->pipelineCache = createPipelineCache(pLogicalDevice);
+    auto effectsStart             = std::chrono::steady_clock::now();
+
+    std::vector<std::shared_ptr<Effect>> effects;
+    UploadBatch                          uploads(pLogicalDevice);
+    uploads.makeCurrent();
+    auto imageSet = [&](uint32_t set) {
+        return std::vector<VkImage>(images.begin() + imageCount * set, images.begin() + imageCount * (set + 1));
+    };
+    for (uint32_t i = 0; i < options.effects.size(); i++)
+    {
+        effects.push_back(createEffect(options.effects[i],
+                                       pLogicalDevice,
+                                       swapchainInfo.imageFormat,
+                                       options.extent,
+                                       imageSet(fakeImageInputSet(i)),
+                                       imageSet(fakeImageOutputSet(i)),
+                                       &config));
+    }
+
+    uploads.submit();
+    uploads.wait();
+    double effectsMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - effectsStart).count();
+    savePipelineCache(pLogicalDevice);
+    pLogicalDevice->memoryAllocator.logStatistics();
+
+    if (!options.csvFile.empty())
+    {
+        setenv("VKBASALT_PROFILE_FILE", options.csvFile.c_str(), 1);
+    }
+    std::unique_ptr<Profiler> profiler(Profiler::create(pLogicalDevice, imageCount));
+    for (auto& effect : effects)
+    {
+        effect->useDepthImage(VK_NULL_HANDLE);
+        effect->useProfiler(profiler.get());
+    }
+
+    // Same recording as writeCommandBuffers, with every effect timed on the CPU.
+    std::vector<VkCommandBuffer> commandBuffers = allocateCommandBuffer(pLogicalDevice, imageCount);
+    std::vector<double>          recordMilliseconds(effects.size());
+    VkCommandBufferBeginInfo     beginInfo = {};
+    beginInfo.sType                        = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags                        = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+    for (uint32_t run = 0; run < options.recordRuns; run++)
+    {
+        for (uint32_t i = 0; i < imageCount; i++)
+        {
+            pLogicalDevice->vkd.ResetCommandBuffer(commandBuffers[i], 0);
+            pLogicalDevice->vkd.BeginCommandBuffer(commandBuffers[i], &beginInfo);
+            if (profiler)
+            {
+                profiler->beginCommandBuffer(commandBuffers[i], i);
+            }
+            for (uint32_t j = 0; j < effects.size(); j++)
+            {
+                if (j)
+                {
+                    writeEffectBarrier(pLogicalDevice, commandBuffers[i]);
+                }
+                if (profiler)
+                {
+                    profiler->beginScope(commandBuffers[i], i, Profiler::scopeName(j, typeid(*effects[j])));
+                }
+                auto start = std::chrono::steady_clock::now();
+                effects[j]->applyEffect(i, commandBuffers[i]);
+                recordMilliseconds[j] += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                if (profiler)
+                {
+                    profiler->endScope(commandBuffers[i], i);
+                }
+            }
+            pLogicalDevice->vkd.EndCommandBuffer(commandBuffers[i]);
+        }
+    }
+
+    VkFenceCreateInfo fenceInfo = {};
+    fenceInfo.sType             = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    VkFence fence;
+    pLogicalDevice->vkd.CreateFence(pLogicalDevice->device, &fenceInfo, nullptr, &fence);
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < options.frames; frame++)
+    {
+        uint32_t index = frame % imageCount;
+        for (auto& effect : effects)
+        {
+            effect->updateEffect(index);
+        }
+        if (profiler)
+        {
+            profiler->collect(index);
+        }
+        VkSubmitInfo submitInfo       = {};
+        submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers    = &commandBuffers[index];
+        VkResult result               = pLogicalDevice->vkd.QueueSubmit(pLogicalDevice->queue, 1, &submitInfo, fence);
+        ASSERT_VULKAN(result);
+        pLogicalDevice->vkd.WaitForFences(pLogicalDevice->device, 1, &fence, VK_TRUE, UINT64_MAX);
+        pLogicalDevice->vkd.ResetFences(pLogicalDevice->device, 1, &fence);
+        if (profiler)
+        {
+            profiler->submitted(index);
+        }
+    }
+    double wallMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (profiler)
+    {
+        for (uint32_t i = 0; i < imageCount; i++)
+        {
+            profiler->collect(i);
+        }
+    }
+
+    std::printf("%ux%u, %zu frames, %u submissions, %.3f ms per submission including the wait\n",
+                options.extent.width,
+                options.extent.height,
+                frames.size(),
+                options.frames,
+                wallMilliseconds / options.frames);
+    std::printf("creating the effects took %.3f ms\n", effectsMilliseconds);
+    std::printf("%-48s %12s %12s %12s %12s\n", "scope", "record ms", "gpu min ms", "gpu avg ms", "gpu p99 ms");
+    std::map<std::string, double> recordByName;
+    for (uint32_t j = 0; j < effects.size(); j++)
+    {
+        recordByName[Profiler::scopeName(j, typeid(*effects[j]))] = recordMilliseconds[j] / (options.recordRuns * imageCount);
+    }
+    if (profiler)
+    {
+        for (const auto& summary : profiler->summarize())
+        {
+            auto record = recordByName.find(summary.name);
+            char recordColumn[32] = "";
+            if (record != recordByName.end())
+            {
+                std::snprintf(recordColumn, sizeof(recordColumn), "%12.4f", record->second);
+            }
+            std::printf("%-48s %12s %12.4f %12.4f %12.4f\n",
+                        summary.name.c_str(),
+                        recordColumn,
+                        summary.minMilliseconds,
+                        summary.avgMilliseconds,
+                        summary.p99Milliseconds);
+        }
+    }
+    else
+    {
+        for (const auto& [name, milliseconds] : recordByName)
+        {
+            std::printf("%-48s %12.4f\n", name.c_str(), milliseconds);
+        }
+    }
+
+    pLogicalDevice->vkd.DeviceWaitIdle(pLogicalDevice->device);
+    pLogicalDevice->vkd.DestroyFence(pLogicalDevice->device, fence, nullptr);
+    pLogicalDevice->vkd.FreeCommandBuffers(pLogicalDevice->device, pLogicalDevice->commandPool, commandBuffers.size(), commandBuffers.data());
+    profiler.reset();
+    effects.clear();
+    for (auto image : images)
+    {
+        pLogicalDevice->vkd.DestroyImage(pLogicalDevice->device, image, nullptr);
+    }
+    freeMemory(pLogicalDevice, imageMemory);
+    pLogicalDevice->memoryAllocator.destroy(pLogicalDevice);
+    pLogicalDevice->vkd.DestroyPipelineCache(pLogicalDevice->device, pLogicalDevice->pipelineCache, nullptr);
+    pLogicalDevice->vkd.DestroyCommandPool(pLogicalDevice->device, pLogicalDevice->commandPool, nullptr);
+    pLogicalDevice->vkd.DestroyDevice(pLogicalDevice->device, nullptr);
+    vulkan.vki.DestroyInstance(vulkan.instance, nullptr);
+    return 0;
+}
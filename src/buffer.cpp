@@ -1,39 +1,98 @@
 #include "buffer.hpp"
 #include "memory.hpp"
+#include "upload_batch.hpp"
+
+#include <cstring>
 
 namespace vkBasalt
 {
+    namespace
+    {
+        void createBuffer(LogicalDevice*        pLogicalDevice,
+                          VkDeviceSize          size,
+                          VkBufferUsageFlags    usage,
+                          VkMemoryPropertyFlags properties,
+                          MemoryPool            pool,
+                          VkBuffer&             buffer,
+                          MemoryAllocation&     bufferMemory,
+                          VkMemoryPropertyFlags preferredProperties)
+        {
+            VkBufferCreateInfo bufferInfo = {};
+
+            bufferInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            bufferInfo.size        = size;
+            bufferInfo.usage       = usage;
+            bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+            VkResult result = pLogicalDevice->vkd.CreateBuffer(pLogicalDevice->device, &bufferInfo, nullptr, &buffer);
+            ASSERT_VULKAN(result);
+
+            VkMemoryRequirements memRequirements;
+            pLogicalDevice->vkd.GetBufferMemoryRequirements(pLogicalDevice->device, buffer, &memRequirements);
+
+            bufferMemory = allocateMemory(pLogicalDevice, memRequirements, pool, true, properties, preferredProperties);
+
+            result = pLogicalDevice->vkd.BindBufferMemory(pLogicalDevice->device, buffer, bufferMemory.memory, bufferMemory.offset);
+            ASSERT_VULKAN(result);
+        }
+    } // namespace
+
     void createBuffer(LogicalDevice*        pLogicalDevice,
                       VkDeviceSize          size,
                       VkBufferUsageFlags    usage,
                       VkMemoryPropertyFlags properties,
                       VkBuffer&             buffer,
-                      VkDeviceMemory&       bufferMemory)
+                      MemoryAllocation&     bufferMemory,
+                      VkMemoryPropertyFlags preferredProperties)
     {
-        VkBufferCreateInfo bufferInfo = {};
-
-        bufferInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-        bufferInfo.size        = size;
-        bufferInfo.usage       = usage;
-        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-        VkResult result = pLogicalDevice->vkd.CreateBuffer(pLogicalDevice->device, &bufferInfo, nullptr, &buffer);
-        ASSERT_VULKAN(result);
-
-        VkMemoryRequirements memRequirements;
-        pLogicalDevice->vkd.GetBufferMemoryRequirements(pLogicalDevice->device, buffer, &memRequirements);
+        MemoryPool pool = (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) ? MemoryPool::HostVisible : MemoryPool::DeviceLocal;
+        createBuffer(pLogicalDevice, size, usage, properties, pool, buffer, bufferMemory, preferredProperties);
+    }
 
-        VkMemoryAllocateInfo allocInfo = {};
+    void createStagingBuffer(LogicalDevice* pLogicalDevice, VkDeviceSize size, VkBuffer& buffer, MemoryAllocation& bufferMemory)
+    {
+        createBuffer(pLogicalDevice,
+                     size,
+                     VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                     MemoryPool::Staging,
+                     buffer,
+                     bufferMemory,
+                     0);
+    }
 
-        allocInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize  = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryTypeIndex(pLogicalDevice, memRequirements.memoryTypeBits, properties);
+    void uploadToBuffer(LogicalDevice* pLogicalDevice, VkBuffer buffer, VkDeviceSize size, const void* writeData)
+    {
+        recordUpload(pLogicalDevice, [&](UploadBatch& batch) {
+            VkBuffer     stagingBuffer;
+            VkDeviceSize stagingOffset;
+            std::memcpy(batch.stage(size, stagingBuffer, stagingOffset), writeData, size);
 
-        result = pLogicalDevice->vkd.AllocateMemory(pLogicalDevice->device, &allocInfo, nullptr, &bufferMemory);
-        ASSERT_VULKAN(result);
+            VkBufferCopy region = {};
+            region.srcOffset    = stagingOffset;
+            region.size         = size;
+            pLogicalDevice->vkd.CmdCopyBuffer(batch.commandBuffer(), stagingBuffer, buffer, 1, &region);
 
-        result = pLogicalDevice->vkd.BindBufferMemory(pLogicalDevice->device, buffer, bufferMemory, 0);
-        ASSERT_VULKAN(result);
+            VkBufferMemoryBarrier memoryBarrier = {};
+            memoryBarrier.sType                 = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            memoryBarrier.srcAccessMask         = VK_ACCESS_TRANSFER_WRITE_BIT;
+            memoryBarrier.dstAccessMask         = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT;
+            memoryBarrier.srcQueueFamilyIndex   = VK_QUEUE_FAMILY_IGNORED;
+            memoryBarrier.dstQueueFamilyIndex   = VK_QUEUE_FAMILY_IGNORED;
+            memoryBarrier.buffer                = buffer;
+            memoryBarrier.offset                = 0;
+            memoryBarrier.size                  = size;
+            pLogicalDevice->vkd.CmdPipelineBarrier(batch.commandBuffer(),
+                                                   VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                                   VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                                                   0,
+                                                   0,
+                                                   nullptr,
+                                                   1,
+                                                   &memoryBarrier,
+                                                   0,
+                                                   nullptr);
+        });
     }
 
 } // namespace vkBasalt
@@ -18,7 +18,14 @@ namespace vkBasalt
                       VkBufferUsageFlags    usage,
                       VkMemoryPropertyFlags properties,
                       VkBuffer&             buffer,
-                      VkDeviceMemory&       bufferMemory);
-}
+                      MemoryAllocation&     bufferMemory,
+                      VkMemoryPropertyFlags preferredProperties = 0);
+
+    // Host visible and coherent transfer source from the staging pool, bufferMemory.mapped points to its memory.
+    void createStagingBuffer(LogicalDevice* pLogicalDevice, VkDeviceSize size, VkBuffer& buffer, MemoryAllocation& bufferMemory);
+
+    // Records into the UploadBatch of the calling thread if it has one, like uploadToImage.
+    void uploadToBuffer(LogicalDevice* pLogicalDevice, VkBuffer buffer, VkDeviceSize size, const void* writeData);
+} // namespace vkBasalt
 
 #endif // BUFFER_HPP_INCLUDED
@@ -26,12 +26,30 @@ namespace vkBasalt
 
         return commandBuffers;
     }
+    void writeEffectBarrier(LogicalDevice* pLogicalDevice, VkCommandBuffer commandBuffer)
+    {
+        // Only execution has to be ordered, the later writes don't depend on anything the reads made visible.
+        pLogicalDevice->vkd.CmdPipelineBarrier(commandBuffer,
+                                               VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+                                                   | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                               VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+                                                   | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                               0,
+                                               0,
+                                               nullptr,
+                                               0,
+                                               nullptr,
+                                               0,
+                                               nullptr);
+    }
+
     void writeCommandBuffers(LogicalDevice*                                 pLogicalDevice,
                              std::vector<std::shared_ptr<vkBasalt::Effect>> effects,
                              VkImage                                        depthImage,
                              VkImageView                                    depthImageView,
                              VkFormat                                       depthFormat,
-                             std::vector<VkCommandBuffer>                   commandBuffers)
+                             std::vector<VkCommandBuffer>                   commandBuffers,
+                             Profiler*                                      pProfiler)
     {
         VkCommandBufferBeginInfo beginInfo = {};
 
@@ -43,6 +61,7 @@ namespace vkBasalt
         for (auto& effect : effects)
         {
             effect->useDepthImage(depthImageView);
+            effect->useProfiler(pProfiler);
         }
 
         for (uint32_t i = 0; i < commandBuffers.size(); i++)
@@ -51,6 +70,11 @@ namespace vkBasalt
             VkResult result = pLogicalDevice->vkd.BeginCommandBuffer(commandBuffers[i], &beginInfo);
             ASSERT_VULKAN(result);
 
+            if (pProfiler)
+            {
+                pProfiler->beginCommandBuffer(commandBuffers[i], i);
+            }
+
             VkImageMemoryBarrier memoryBarrier;
             memoryBarrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
             memoryBarrier.pNext               = nullptr;
@@ -85,7 +109,19 @@ namespace vkBasalt
             for (uint32_t j = 0; j < effects.size(); j++)
             {
                 Logger::debug("before applying effect " + convertToString(effects[j]));
+                if (j)
+                {
+                    writeEffectBarrier(pLogicalDevice, commandBuffers[i]);
+                }
+                if (pProfiler)
+                {
+                    pProfiler->beginScope(commandBuffers[i], i, Profiler::scopeName(j, typeid(*effects[j])));
+                }
                 effects[j]->applyEffect(i, commandBuffers[i]);
+                if (pProfiler)
+                {
+                    pProfiler->endScope(commandBuffers[i], i);
+                }
             }
 
             memoryBarrier.oldLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
@@ -15,6 +15,7 @@
 namespace vkBasalt
 {
 
+    // Both need pLogicalDevice->queueLock, since they use the command pool.
     std::vector<VkCommandBuffer> allocateCommandBuffer(LogicalDevice* pLogicalDevice, uint32_t count);
 
     void writeCommandBuffers(LogicalDevice*                                 pLogicalDevice,
@@ -22,7 +23,12 @@ namespace vkBasalt
                              VkImage                                        depthImage,
                              VkImageView                                    depthImageView,
                              VkFormat                                       depthFormat,
-                             std::vector<VkCommandBuffer>                   commandBuffers);
+                             std::vector<VkCommandBuffer>                   commandBuffers,
+                             Profiler*                                      pProfiler = nullptr);
+
+    // Goes between two effects. The effect chain only has two sets of intermediate images, so an effect writes to the
+    // images that the effect before it read from, this makes it wait for those reads.
+    void writeEffectBarrier(LogicalDevice* pLogicalDevice, VkCommandBuffer commandBuffer);
 
     std::vector<VkSemaphore> createSemaphores(LogicalDevice* pLogicalDevice, uint32_t count);
 } // namespace vkBasalt
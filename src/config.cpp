@@ -49,6 +49,11 @@ namespace vkBasalt
         this->options = other.options;
     }
 
+    void Config::setOption(const std::string& option, const std::string& value)
+    {
+        options[option] = value;
+    }
+
     void Config::readConfigFile(std::ifstream& stream)
     {
         std::string line;
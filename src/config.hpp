@@ -18,6 +18,9 @@ namespace vkBasalt
         Config();
         Config(const Config& other);
 
+        // Overrides the value from the config file, as if it was its last line.
+        void setOption(const std::string& option, const std::string& value);
+
         template<typename T>
         T getOption(const std::string& option, const T& defaultValue = {})
         {
@@ -31,7 +31,7 @@ namespace vkBasalt
 
         VkDescriptorSetLayoutBinding descriptorSetLayoutBinding;
         descriptorSetLayoutBinding.binding            = 0;
-        descriptorSetLayoutBinding.descriptorType     = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        descriptorSetLayoutBinding.descriptorType     = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
         descriptorSetLayoutBinding.descriptorCount    = 1;
         descriptorSetLayoutBinding.stageFlags         = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_VERTEX_BIT;
         descriptorSetLayoutBinding.pImmutableSamplers = nullptr;
@@ -53,7 +53,8 @@ namespace vkBasalt
     VkDescriptorSet writeBufferDescriptorSet(LogicalDevice*        pLogicalDevice,
                                              VkDescriptorPool      descriptorPool,
                                              VkDescriptorSetLayout descriptorSetLayout,
-                                             VkBuffer              buffer)
+                                             VkBuffer              buffer,
+                                             VkDeviceSize          range)
     {
         VkDescriptorSet descriptorSet;
 
@@ -70,7 +71,7 @@ namespace vkBasalt
         VkDescriptorBufferInfo bufferInfo;
         bufferInfo.buffer = buffer;
         bufferInfo.offset = 0;
-        bufferInfo.range  = VK_WHOLE_SIZE;
+        bufferInfo.range  = range;
 
         VkWriteDescriptorSet writeDescriptorSet = {};
 
@@ -80,7 +81,7 @@ namespace vkBasalt
         writeDescriptorSet.dstBinding       = 0;
         writeDescriptorSet.dstArrayElement  = 0;
         writeDescriptorSet.descriptorCount  = 1;
-        writeDescriptorSet.descriptorType   = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        writeDescriptorSet.descriptorType   = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
         writeDescriptorSet.pImageInfo       = nullptr;
         writeDescriptorSet.pBufferInfo      = &bufferInfo;
         writeDescriptorSet.pTexelBufferView = nullptr;
@@ -140,6 +141,15 @@ namespace vkBasalt
         VkResult result = pLogicalDevice->vkd.AllocateDescriptorSets(pLogicalDevice->device, &descriptorSetAllocateInfo, descriptorSets.data());
         ASSERT_VULKAN(result);
 
+        writeImageSamplerDescriptorSets(pLogicalDevice, descriptorSets, samplers, imageViewsVectors);
+        return descriptorSets;
+    }
+
+    void writeImageSamplerDescriptorSets(LogicalDevice*                               pLogicalDevice,
+                                         const std::vector<VkDescriptorSet>&          descriptorSets,
+                                         const std::vector<VkSampler>&                samplers,
+                                         const std::vector<std::vector<VkImageView>>& imageViewsVectors)
+    {
         VkDescriptorImageInfo imageInfo;
         imageInfo.sampler     = VK_NULL_HANDLE;
         imageInfo.imageView   = VK_NULL_HANDLE;
@@ -175,6 +185,5 @@ namespace vkBasalt
             Logger::debug("before writing descriptor Sets");
             pLogicalDevice->vkd.UpdateDescriptorSets(pLogicalDevice->device, writeDescriptorSets.size(), writeDescriptorSets.data(), 0, nullptr);
         }
-        return descriptorSets;
     }
 } // namespace vkBasalt
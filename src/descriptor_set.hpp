@@ -15,12 +15,14 @@ namespace vkBasalt
 {
     VkDescriptorPool createDescriptorPool(LogicalDevice* pLogicalDevice, const std::vector<VkDescriptorPoolSize>& poolSizes);
 
+    // A dynamic uniform buffer, the offset into the buffer gets chosen when binding the set.
     VkDescriptorSetLayout createUniformBufferDescriptorSetLayout(LogicalDevice* pLogicalDevice);
 
     VkDescriptorSet writeBufferDescriptorSet(LogicalDevice*        pLogicalDevice,
                                              VkDescriptorPool      descriptorPool,
                                              VkDescriptorSetLayout descriptorSetLayout,
-                                             VkBuffer              buffer);
+                                             VkBuffer              buffer,
+                                             VkDeviceSize          range);
 
     VkDescriptorSetLayout createImageSamplerDescriptorSetLayout(LogicalDevice* pLogicalDevice, uint32_t count);
 
@@ -29,6 +31,12 @@ namespace vkBasalt
                                                                             VkDescriptorSetLayout                 descriptorSetLayout,
                                                                             std::vector<VkSampler>                samplers,
                                                                             std::vector<std::vector<VkImageView>> imageViewsVectors);
+
+    // Overwrites sets from allocateAndWriteImageSamplerDescriptorSets, they must not be in use by the GPU.
+    void writeImageSamplerDescriptorSets(LogicalDevice*                               pLogicalDevice,
+                                         const std::vector<VkDescriptorSet>&          descriptorSets,
+                                         const std::vector<VkSampler>&                samplers,
+                                         const std::vector<std::vector<VkImageView>>& imageViewsVectors);
 } // namespace vkBasalt
 
 #endif // DESCRIPTOR_SET_HPP_INCLUDED
@@ -0,0 +1,61 @@
+#ifndef DISPATCH_MAP_HPP_INCLUDED
+#define DISPATCH_MAP_HPP_INCLUDED
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace vkBasalt
+{
+    // Map for the layer book-keeping, read by every hooked call but only written when instances, devices or swapchains
+    // get created or destroyed. Readers take a reference to an immutable snapshot and never wait for a writer's copy,
+    // writers copy the map, change the copy and publish it. Old snapshots go away with their last reader.
+    // std::atomic<std::shared_ptr> isn't lock-free in libstdc++, loads and stores briefly take an internal lock.
+    template<typename Key, typename Value>
+    class DispatchMap
+    {
+    public:
+        using Map = std::unordered_map<Key, Value>;
+
+        DispatchMap() : snapshot(std::make_shared<const Map>())
+        {
+        }
+
+        // Returns a default constructed value if there is no entry for the key.
+        Value get(const Key& key) const
+        {
+            std::shared_ptr<const Map> map   = load();
+            auto                       entry = map->find(key);
+            return entry == map->end() ? Value() : entry->second;
+        }
+
+        // All entries at the time of the call.
+        std::shared_ptr<const Map> load() const
+        {
+            return snapshot.load(std::memory_order_acquire);
+        }
+
+        void set(const Key& key, Value value)
+        {
+            std::lock_guard<std::mutex> lock(writeLock);
+            std::shared_ptr<Map>        map = std::make_shared<Map>(*load());
+            (*map)[key]                     = std::move(value);
+            snapshot.store(std::shared_ptr<const Map>(std::move(map)), std::memory_order_release);
+        }
+
+        void erase(const Key& key)
+        {
+            std::lock_guard<std::mutex> lock(writeLock);
+            std::shared_ptr<Map>        map = std::make_shared<Map>(*load());
+            map->erase(key);
+            snapshot.store(std::shared_ptr<const Map>(std::move(map)), std::memory_order_release);
+        }
+
+    private:
+        std::atomic<std::shared_ptr<const Map>> snapshot;
+        // Only serializes writers among each other.
+        std::mutex writeLock;
+    };
+} // namespace vkBasalt
+
+#endif // DISPATCH_MAP_HPP_INCLUDED
@@ -0,0 +1,128 @@
+// Contention benchmark of the layer book-keeping: threads look up a device and then do the work of a hooked call,
+// once with a single global mutex held around both, like the layer used to, and once with DispatchMap.
+// A writer thread recreates a swapchain entry every millisecond meanwhile.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "dispatch_map.hpp"
+
+namespace
+{
+    struct Device
+    {
+        uint32_t id = 0;
+    };
+
+    // Stands in for the driver call that the layer forwards to, e.g. vkCreateImage.
+    void driverCall(std::chrono::nanoseconds duration)
+    {
+        auto end = std::chrono::steady_clock::now() + duration;
+        while (std::chrono::steady_clock::now() < end)
+        {
+        }
+    }
+
+    template<typename Lookup, typename Recreate>
+    double run(uint32_t threadCount, std::chrono::nanoseconds callDuration, Lookup lookup, Recreate recreate)
+    {
+        std::atomic<bool>     stop  = false;
+        std::atomic<uint64_t> total = 0;
+
+        std::vector<std::thread> threads;
+        for (uint32_t i = 0; i < threadCount; i++)
+        {
+            threads.emplace_back([&, i]() {
+                uint64_t calls = 0;
+                while (!stop.load(std::memory_order_relaxed))
+                {
+                    lookup(reinterpret_cast<void*>(uintptr_t(i % 2 + 1)), callDuration);
+                    calls++;
+                }
+                total += calls;
+            });
+        }
+        std::thread writer([&]() {
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                recreate();
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+
+        auto duration = std::chrono::milliseconds(500);
+        std::this_thread::sleep_for(duration);
+        stop = true;
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+        writer.join();
+        return total / std::chrono::duration<double>(duration).count();
+    }
+} // namespace
+
+int main(int argc, char** argv)
+{
+    uint32_t maxThreads   = argc > 1 ? std::atoi(argv[1]) : std::thread::hardware_concurrency();
+    auto     callDuration = std::chrono::nanoseconds(argc > 2 ? std::atoi(argv[2]) : 2000);
+
+    std::printf("simulated driver call: %lld ns\n", (long long) callDuration.count());
+    std::printf("%8s %20s %20s\n", "threads", "global lock calls/s", "DispatchMap calls/s");
+    for (uint32_t threadCount = 1; threadCount <= maxThreads; threadCount *= 2)
+    {
+        std::unordered_map<void*, std::shared_ptr<Device>> lockedDevices;
+        std::unordered_map<void*, std::shared_ptr<Device>> lockedSwapchains;
+        std::mutex                                         globalLock;
+        lockedDevices[(void*) 1] = std::make_shared<Device>();
+        lockedDevices[(void*) 2] = std::make_shared<Device>();
+
+        double locked = run(
+            threadCount,
+            callDuration,
+            [&](void* key, std::chrono::nanoseconds duration) {
+                std::lock_guard<std::mutex> l(globalLock);
+                if (!lockedDevices[key])
+                {
+                    std::abort();
+                }
+                driverCall(duration);
+            },
+            [&]() {
+                std::lock_guard<std::mutex> l(globalLock);
+                lockedSwapchains.erase((void*) 3);
+                lockedSwapchains[(void*) 3] = std::make_shared<Device>();
+            });
+
+        vkBasalt::DispatchMap<void*, std::shared_ptr<Device>> devices;
+        vkBasalt::DispatchMap<void*, std::shared_ptr<Device>> swapchains;
+        devices.set((void*) 1, std::make_shared<Device>());
+        devices.set((void*) 2, std::make_shared<Device>());
+
+        double dispatchMap = run(
+            threadCount,
+            callDuration,
+            [&](void* key, std::chrono::nanoseconds duration) {
+                if (!devices.get(key))
+                {
+                    std::abort();
+                }
+                driverCall(duration);
+            },
+            [&]() {
+                swapchains.erase((void*) 3);
+                swapchains.set((void*) 3, std::make_shared<Device>());
+            });
+
+        std::printf("%8u %20.0f %20.0f\n", threadCount, locked, dispatchMap);
+    }
+    return 0;
+}
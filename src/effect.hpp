@@ -9,14 +9,22 @@
 
 #include "vulkan_include.hpp"
 
+#include "profiler.hpp"
+
 namespace vkBasalt
 {
     class Effect
     {
     public:
         void virtual applyEffect(uint32_t imageIndex, VkCommandBuffer commandBuffer) = 0;
-        void virtual updateEffect(){};
+        // Called before the command buffer of imageIndex gets submitted again.
+        void virtual updateEffect(uint32_t imageIndex){};
         void virtual useDepthImage(VkImageView depthImageView){};
+        // Effects with several passes can time them separately, pProfiler is nullptr when not profiling.
+        void virtual useProfiler(Profiler* pProfiler){};
+        // Points the effect at the images of a new swapchain with the same extent, format and image count, everything that
+        // doesn't depend on the images is kept. Returns false if the effect has to be created again instead.
+        bool virtual rebindImages(const std::vector<VkImage>& inputImages, const std::vector<VkImage>& outputImages) { return false; };
         virtual ~Effect(){};
 
     private:
@@ -1,5 +1,7 @@
 #include <cmath>
+#include <algorithm>
 #include <numeric>
+#include <stdexcept>
 
 #include "effect_aist.hpp"
 
@@ -9,10 +11,7 @@
 #include "descriptor_set.hpp"
 #include "util.hpp"
 
-#include "aist/fromimage_layer.hpp"
-#include "aist/in_2d_layer.hpp"
-#include "aist/up_conv_32_3_layer.hpp"
-#include "aist/to_image_layer.hpp"
+#include "aist/graph_builder.hpp"
 #include "memory.hpp"
 
 vkBasalt::AistEffect::AistEffect(
@@ -31,6 +30,29 @@ vkBasalt::AistEffect::AistEffect(
         pConfig(pConfig) {
     Logger::debug("in creating AistEffect");
 
+    choosePrecision();
+    // aistWeigthsFile is the name the option had before models got a header.
+    auto modelFileName = pConfig->getOption<std::string>(
+            "aistModelFile",
+            pConfig->getOption<std::string>("aistWeigthsFile")
+    );
+    //Thrown before anything is allocated, the factory passes the images through instead.
+    if (!model.load(modelFileName)) {
+        throw std::runtime_error("can't load AIST model " + modelFileName);
+    }
+    aist::GraphOptions graphOptions{
+            .precision = precision,
+            .tiledFromImage = pConfig->getOption<std::string>("aistFromImageKernel", "tiled") != "direct",
+            // The convolution leaves partial statistics for the following In2D, so it doesn't re-read the tensor for them.
+            .fuseStatistics = pConfig->getOption<bool>("aistFuseStatistics", true),
+    };
+    layers = aist::buildGraph(model, graphOptions, pLogicalDevice, imageExtent, inputImages.size());
+    if (layers.empty()) {
+        throw std::runtime_error("can't build a graph from AIST model " + modelFileName);
+    }
+    Logger::debug("AIST: built " + std::to_string(layers.size()) + " layers");
+
+    planTensors();
     allocateBuffers();
     Logger::debug("allocated buffers");
 
@@ -41,13 +63,6 @@ vkBasalt::AistEffect::AistEffect(
     outputImageViews = createImageViews(pLogicalDevice, format, outputImages);
     Logger::debug("created output ImageViews");
 
-    uint32_t chainCount = inputImages.size();
-
-    layers.push_back(std::unique_ptr<aist::Layer>(new aist::FromImageLayer(pLogicalDevice, imageExtent, chainCount)));
-    layers.push_back(std::unique_ptr<aist::Layer>(new aist::In2D(pLogicalDevice, imageExtent, chainCount, 2, 32)));
-    layers.push_back(std::unique_ptr<aist::Layer>(new aist::UpConv32t3(pLogicalDevice, imageExtent, chainCount)));
-    layers.push_back(std::unique_ptr<aist::Layer>(new aist::ToImageLayer(pLogicalDevice, imageExtent, chainCount)));
-
     createLayoutAndDescriptorSets();
 
     for (const auto &layer : layers) {
@@ -55,143 +70,91 @@ vkBasalt::AistEffect::AistEffect(
     }
 }
 
-void vkBasalt::AistEffect::allocateBuffers() {
-    auto weightsFileName = pConfig->getOption<std::string>("aistWeigthsFile");
-    std::ifstream file(weightsFileName, std::ios::in|std::ios::binary|std::ios::ate);
-    if (!file.is_open()) {
-        Logger::err("Can't open aistWeigthsFile!");
+void vkBasalt::AistEffect::choosePrecision() {
+    auto precisionName = pConfig->getOption<std::string>("aistTensorPrecision", "fp32");
+    precision = aist::TensorPrecision::fp32;
+    if (precisionName == "fp16") {
+        if (pLogicalDevice->supportsStorage16Bit) {
+            precision = aist::TensorPrecision::fp16;
+        } else {
+            Logger::warn("AIST: device lacks storageBuffer16BitAccess, falling back to fp32 tensors.");
+        }
+    } else if (precisionName != "fp32") {
+        Logger::warn("AIST: unknown aistTensorPrecision " + precisionName + ", using fp32.");
     }
-    auto fileSize = file.tellg();
-    // Should be:
-    // ((3 × 9 + 3 × 32) + (32 × 9 + 32 × 64)) × 2 + (64 × 9 + 64 × 64) × 2 × 15
-    // 4 - 32-bit float.
-    VkDeviceSize weightsSize = fileSize;
-    char* weightsHostBuf = new char [fileSize];
-    file.seekg(0, std::ios::beg);
-    file.read(weightsHostBuf, fileSize);
-    file.close();
-    Logger::debug("Loaded aistWeigthsFile");
+    Logger::info("AIST: tensor precision " + std::string(precision == aist::TensorPrecision::fp16 ? "fp16" : "fp32"));
+}
+
+void vkBasalt::AistEffect::planTensors() {
+    aist::TensorId tensor = 0;
+    for (const auto &layer : layers) {
+        tensorPlanner.beginLayer();
+        tensor = layer->planTensors(&tensorPlanner, tensor);
+    }
+    tensorPlanner.plan();
+    // Previously every swapchain image had its own buffer with every tensor in a separate region.
+    VkDeviceSize unaliasedSize = tensorPlanner.unaliasedSize() * inputImages.size();
+    Logger::info(
+            "AIST: intermediate tensors take " + std::to_string(tensorPlanner.totalSize()) + " bytes, saved "
+            + std::to_string(unaliasedSize - tensorPlanner.totalSize()) + " of " + std::to_string(unaliasedSize)
+    );
+}
+
+void vkBasalt::AistEffect::allocateBuffers() {
+    // Layers bind 256-byte aligned ranges of weights, the last one may reach past the data.
+    VkDeviceSize weightsSize = aist::Layer::alignTo256Bytes(std::max<VkDeviceSize>(model.data().size(), 1));
     VkBufferCreateInfo bufferInfo{
             .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
             .size = weightsSize,
-            .usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            // Grouped convolutions bind their weights as storage buffers, they may exceed the uniform range.
+            .usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
             .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
     };
     VkResult result = pLogicalDevice->vkd.CreateBuffer(pLogicalDevice->device, &bufferInfo, nullptr, &weights);
     ASSERT_VULKAN(result)
-    // (width / 2) × (height / 2) × 32 + (width / 4) × (height / 4) × 64
-    //        spatial reduction|    |channels     |more SR    channels|
-    // w x h x 12 of 32-bit floats.
-    VkDeviceSize intermediateSize = aist::Layer::alignTo256Bytes(imageExtent.width * imageExtent.height * 12 * 4);
+    VkDeviceSize intermediateSize = tensorPlanner.totalSize();
     bufferInfo.size = intermediateSize;
     bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
-    intermediates.resize(inputImages.size());
-    for (auto & intermediate : intermediates)
-    {
-        result = pLogicalDevice->vkd.CreateBuffer(pLogicalDevice->device, &bufferInfo, nullptr, &intermediate);
-        ASSERT_VULKAN(result)
-    }
+    result = pLogicalDevice->vkd.CreateBuffer(pLogicalDevice->device, &bufferInfo, nullptr, &intermediate);
+    ASSERT_VULKAN(result)
     VkMemoryRequirements weightsMemReqs;
     pLogicalDevice->vkd.GetBufferMemoryRequirements(pLogicalDevice->device, weights, &weightsMemReqs);
     VkMemoryRequirements intermediateMemReqs;
-    pLogicalDevice->vkd.GetBufferMemoryRequirements(pLogicalDevice->device, intermediates[0], &intermediateMemReqs);
+    pLogicalDevice->vkd.GetBufferMemoryRequirements(pLogicalDevice->device, intermediate, &intermediateMemReqs);
     Logger::debug("AIST: created buffer handles and got mem reqs.");
 
     const VkDeviceSize alignment = std::lcm(weightsMemReqs.alignment, intermediateMemReqs.alignment);
-    VkDeviceSize memOffset = intermediateSize;
-    VkDeviceSize overAlignment = memOffset % alignment;
-    if (overAlignment > 0) memOffset += alignment - overAlignment;
-    memOffset *= intermediates.size();
+    VkDeviceSize memOffset = intermediateMemReqs.size;
     memOffset += weightsSize;
-    overAlignment = weightsSize % alignment;
+    VkDeviceSize overAlignment = weightsSize % alignment;
     if (overAlignment > 0) memOffset += alignment - overAlignment;
 
-    VkMemoryAllocateInfo allocInfo = {
-        .sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .allocationSize  = memOffset,
-        .memoryTypeIndex = findMemoryTypeIndex(
-                pLogicalDevice,
-                weightsMemReqs.memoryTypeBits | intermediateMemReqs.memoryTypeBits,
-                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-        ),
+    // Both buffers have to fit the one memory type.
+    VkMemoryRequirements memReqs{
+        .size           = memOffset,
+        .alignment      = alignment,
+        .memoryTypeBits = weightsMemReqs.memoryTypeBits & intermediateMemReqs.memoryTypeBits,
     };
-    result = pLogicalDevice->vkd.AllocateMemory(pLogicalDevice->device, &allocInfo, nullptr, &bufferMemory);
-    ASSERT_VULKAN(result)
+    bufferMemory = allocateMemory(pLogicalDevice, memReqs, MemoryPool::DeviceLocal, true, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-    memOffset = 0;
-    result = pLogicalDevice->vkd.BindBufferMemory(pLogicalDevice->device, weights, bufferMemory, memOffset);
+    memOffset = bufferMemory.offset;
+    result = pLogicalDevice->vkd.BindBufferMemory(pLogicalDevice->device, weights, bufferMemory.memory, memOffset);
     ASSERT_VULKAN(result)
-    memOffset = weightsSize;
+    memOffset += weightsSize;
     overAlignment = weightsSize % alignment;
     if (overAlignment > 0) memOffset += alignment - overAlignment;
-    overAlignment = intermediateSize % alignment;
-    if (overAlignment > 0) overAlignment = alignment - overAlignment;
-    for (const auto &intermediate : intermediates) {
-        result = pLogicalDevice->vkd.BindBufferMemory(pLogicalDevice->device, intermediate, bufferMemory, memOffset);
-        ASSERT_VULKAN(result)
-        memOffset += intermediateSize + overAlignment;
-    }
-    Logger::debug("AIST: bound mem to buffers.");
-
-    VkBuffer       stagingBuffer;
-    VkDeviceMemory stagingMemory;
-    createBuffer(pLogicalDevice,
-                 weightsSize,
-                 VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                 stagingBuffer,
-                 stagingMemory);
-    void* weightsCoherentBuf;
-    result = pLogicalDevice->vkd.MapMemory(pLogicalDevice->device, stagingMemory, 0, weightsSize, 0, &weightsCoherentBuf);
+    result = pLogicalDevice->vkd.BindBufferMemory(pLogicalDevice->device, intermediate, bufferMemory.memory, memOffset);
     ASSERT_VULKAN(result)
-    std::memcpy(weightsCoherentBuf, weightsHostBuf, weightsSize);
-    pLogicalDevice->vkd.UnmapMemory(pLogicalDevice->device, stagingMemory);
-    Logger::debug("AIST: staged weights.");
-
-    VkCommandBufferAllocateInfo cbAllocInfo{
-            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-            .pNext = nullptr,
-            .commandPool = pLogicalDevice->commandPool,
-            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-            .commandBufferCount = 1,
-    };
-    VkCommandBuffer commandBuffer;
-    pLogicalDevice->vkd.AllocateCommandBuffers(pLogicalDevice->device, &cbAllocInfo, &commandBuffer);
-    // initialize dispatch table for commandBuffer since it is a dispatchable object
-    initializeDispatchTable(commandBuffer, pLogicalDevice->device);
-
-    VkCommandBufferBeginInfo beginInfo{
-            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-            .pNext = nullptr,
-            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-            .pInheritanceInfo = nullptr,
-    };
-    pLogicalDevice->vkd.BeginCommandBuffer(commandBuffer, &beginInfo);
-
-    VkBufferCopy region{
-        .srcOffset = 0,
-        .dstOffset = 0,
-        .size = weightsSize,
-    };
-    pLogicalDevice->vkd.CmdCopyBuffer(commandBuffer, stagingBuffer, weights, 1, &region);
+    Logger::debug("AIST: bound mem to buffers.");
 
-    pLogicalDevice->vkd.EndCommandBuffer(commandBuffer);
-    VkSubmitInfo submitInfo{
-            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-            .commandBufferCount = 1,
-            .pCommandBuffers = &commandBuffer,
-    };
-    Logger::debug("AIST: transferring weights.");
-    pLogicalDevice->vkd.QueueSubmit(pLogicalDevice->queue, 1, &submitInfo, VK_NULL_HANDLE);
-    pLogicalDevice->vkd.QueueWaitIdle(pLogicalDevice->queue);
-
-    pLogicalDevice->vkd.FreeCommandBuffers(pLogicalDevice->device, pLogicalDevice->commandPool, 1, &commandBuffer);
-    pLogicalDevice->vkd.FreeMemory(pLogicalDevice->device, stagingMemory, nullptr);
-    pLogicalDevice->vkd.DestroyBuffer(pLogicalDevice->device, stagingBuffer, nullptr);
-    Logger::debug("AIST: transferred weights.");
+    if (!model.data().empty()) {
+        uploadToBuffer(pLogicalDevice, weights, model.data().size(), model.data().data());
+    }
+    Logger::debug("AIST: recorded weights upload.");
 }
 
 void vkBasalt::AistEffect::relayoutOutputImages() {
+    std::lock_guard<std::mutex> lock(pLogicalDevice->queueLock);
     auto layoutCommandBuffer = allocateCommandBuffer(pLogicalDevice, 1)[0];
     VkCommandBufferBeginInfo beginInfo;
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -267,7 +230,6 @@ void vkBasalt::AistEffect::createLayoutAndDescriptorSets() {
         layer->createLayout(&counters);
     }
 
-    uint32_t chainCount = inputImages.size();
     descriptorPool = createDescriptorPool(pLogicalDevice, std::vector<VkDescriptorPoolSize>(
             {
                     {.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = counters.images},
@@ -282,6 +244,11 @@ void vkBasalt::AistEffect::createLayoutAndDescriptorSets() {
     }
     Logger::debug("after allocating descriptor Sets");
 
+    writeDescriptorSets();
+}
+
+void vkBasalt::AistEffect::writeDescriptorSets() {
+    uint32_t chainCount = inputImages.size();
     // In & Out
     std::vector<VkDescriptorImageInfo> imageInfos(2, {
             .sampler = VK_NULL_HANDLE,
@@ -325,61 +292,68 @@ void vkBasalt::AistEffect::createLayoutAndDescriptorSets() {
             .outImage = &(writeDescriptorSets[1]),
             .intermediate = &intermediateWrite,
             .weights = &weightsWrite,
+            .tensors = &tensorPlanner,
     };
+    intermediateInfo.buffer = intermediate;
     for (uint32_t chainIdx = 0; chainIdx < chainCount; chainIdx++) {
         imageInfos[0].imageView = inputImageViews[chainIdx];
         imageInfos[1].imageView = outputImageViews[chainIdx];
-        intermediateInfo.buffer = intermediates[chainIdx];
-        weightsInfo.offset = 0;
-        weightsInfo.range = 0;
-        for (const auto &layer : layers) {
-            layer->writeSets(holder, chainIdx);
-            weightsInfo.offset += weightsInfo.range;
+        for (uint32_t layerIdx = 0; layerIdx < layers.size(); layerIdx++) {
+            weightsInfo.offset = model.weightsOffset(layerIdx);
             weightsInfo.range = 0;
+            layers[layerIdx]->writeSets(holder, chainIdx);
             Logger::debug("Wrote DS in chain " + std::to_string(chainIdx));
         }
     }
     Logger::debug("after writing descriptor Sets");
 }
 
+bool vkBasalt::AistEffect::rebindImages(const std::vector<VkImage> &inputImages, const std::vector<VkImage> &outputImages) {
+    // Weights, tensors and pipelines only depend on the extent, the image descriptors get written again.
+    for (unsigned int i = 0; i < inputImageViews.size(); i++) {
+        pLogicalDevice->vkd.DestroyImageView(pLogicalDevice->device, inputImageViews[i], nullptr);
+        pLogicalDevice->vkd.DestroyImageView(pLogicalDevice->device, outputImageViews[i], nullptr);
+    }
+    this->inputImages = inputImages;
+    this->outputImages = outputImages;
+    inputImageViews = createImageViews(pLogicalDevice, format, inputImages);
+    outputImageViews = createImageViews(pLogicalDevice, format, outputImages);
+    writeDescriptorSets();
+    return true;
+}
+
 void vkBasalt::AistEffect::applyEffect(uint32_t imageIndex, VkCommandBuffer commandBuffer) {
     Logger::debug("applying AistEffect to cb " + convertToString(commandBuffer));
-    // After shader has run, modify layout of output image again to support present|transfer.
-    VkImageMemoryBarrier outputAfterShaderBarrier;
-    outputAfterShaderBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    outputAfterShaderBarrier.pNext = nullptr;
-    outputAfterShaderBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-    outputAfterShaderBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-    outputAfterShaderBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
-    outputAfterShaderBarrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-    outputAfterShaderBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    outputAfterShaderBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    outputAfterShaderBarrier.image = outputImages[imageIndex];
-    outputAfterShaderBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    outputAfterShaderBarrier.subresourceRange.baseMipLevel = 0;
-    outputAfterShaderBarrier.subresourceRange.levelCount = 1;
-    outputAfterShaderBarrier.subresourceRange.baseArrayLayer = 0;
-    outputAfterShaderBarrier.subresourceRange.layerCount = 1;
-
-    std::vector<VkImageMemoryBarrier> beforeShaderBarriers(2, outputAfterShaderBarrier);
-
-    // Need to wait for previous effect and also convert layout…
-    beforeShaderBarriers[0].srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
-    beforeShaderBarriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-    beforeShaderBarriers[0].oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-    beforeShaderBarriers[0].newLayout = VK_IMAGE_LAYOUT_GENERAL;
-    beforeShaderBarriers[1].image = inputImages[imageIndex];
-
-    // …and convert layout of output image because it was not modified after previous execution of this (same!) buffer.
-    //TODO: Convert just before the last layer.
-    beforeShaderBarriers[1].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-    beforeShaderBarriers[1].dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-    beforeShaderBarriers[1].oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-    beforeShaderBarriers[1].newLayout = VK_IMAGE_LAYOUT_GENERAL;
-
+    //Between effects both images are in PRESENT_SRC_KHR, the shaders access them as storage images in GENERAL.
+    VkImageMemoryBarrier inputBarrier;
+    inputBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    inputBarrier.pNext = nullptr;
+    inputBarrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+    inputBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    inputBarrier.oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    inputBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    inputBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    inputBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    inputBarrier.image = inputImages[imageIndex];
+    inputBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    inputBarrier.subresourceRange.baseMipLevel = 0;
+    inputBarrier.subresourceRange.levelCount = 1;
+    inputBarrier.subresourceRange.baseArrayLayer = 0;
+    inputBarrier.subresourceRange.layerCount = 1;
+
+    VkImageMemoryBarrier outputBarrier = inputBarrier;
+    outputBarrier.srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+    outputBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    outputBarrier.image = outputImages[imageIndex];
+
+    std::vector<VkImageMemoryBarrier> beforeShaderBarriers = {inputBarrier, outputBarrier};
+
+    //The stages of writeEffectBarrier, so the previous effect is done with both images.
+    const VkPipelineStageFlags effectStages =
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
     pLogicalDevice->vkd.CmdPipelineBarrier(
             commandBuffer,
-            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            effectStages,
             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
             0,
             0, nullptr,
@@ -395,49 +369,65 @@ void vkBasalt::AistEffect::applyEffect(uint32_t imageIndex, VkCommandBuffer comm
             .dstAccessMask = VK_ACCESS_MEMORY_WRITE_BIT | VK_ACCESS_MEMORY_READ_BIT,
             .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
             .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-            .buffer = intermediates[imageIndex],
+            .buffer = intermediate,
             .offset = 0,
             .size = VK_WHOLE_SIZE,
     };
-    bool addBufferBarrier = false;
+    //Every layer reads what the one before wrote, the first one overwrites tensors the previous frame might still read.
+    uint32_t layerIdx = 0;
     for (const auto &layer : layers) {
-        if (addBufferBarrier) {
-            pLogicalDevice->vkd.CmdPipelineBarrier(
-                    commandBuffer,
-                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-                    0,
-                    0, nullptr,
-                    1, &memoryBarrier,
-                    0, nullptr
-            );
+        pLogicalDevice->vkd.CmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                0,
+                0, nullptr,
+                1, &memoryBarrier,
+                0, nullptr
+        );
+        if (pProfiler) {
+            pProfiler->beginScope(commandBuffer, imageIndex, "aist " + Profiler::scopeName(layerIdx, typeid(*layer)));
         }
         layer->appendCommands(commandBuffer, imageIndex, &memoryBarrier);
-        addBufferBarrier = true;
+        if (pProfiler) {
+            pProfiler->endScope(commandBuffer, imageIndex);
+        }
+        layerIdx++;
+    }
+
+    //Both images go back to PRESENT_SRC_KHR, where the next effect or the presentation expects them.
+    std::vector<VkImageMemoryBarrier> afterShaderBarriers = {inputBarrier, outputBarrier};
+    for (auto &barrier : afterShaderBarriers) {
+        std::swap(barrier.oldLayout, barrier.newLayout);
+        barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
     }
+    afterShaderBarriers[0].srcAccessMask = 0;
+    afterShaderBarriers[1].srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
 
     pLogicalDevice->vkd.CmdPipelineBarrier(
             commandBuffer,
             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+            effectStages,
             0,
             0, nullptr,
             0, nullptr,
-            1, &outputAfterShaderBarrier
+            afterShaderBarriers.size(), afterShaderBarriers.data()
     );
 
     Logger::debug("after the output pipeline barrier");
 }
 
+void vkBasalt::AistEffect::useProfiler(Profiler *pProfiler) {
+    this->pProfiler = pProfiler;
+}
+
 vkBasalt::AistEffect::~AistEffect() {
     Logger::debug("destroying AistEffect " + convertToString(this));
     layers.clear();
     pLogicalDevice->vkd.DestroyDescriptorPool(pLogicalDevice->device, descriptorPool, nullptr);
     pLogicalDevice->vkd.DestroyBuffer(pLogicalDevice->device, weights, nullptr);
-    for (const auto &buffer : intermediates) {
-        pLogicalDevice->vkd.DestroyBuffer(pLogicalDevice->device, buffer, nullptr);
-    }
-    pLogicalDevice->vkd.FreeMemory(pLogicalDevice->device, bufferMemory, nullptr);
+    pLogicalDevice->vkd.DestroyBuffer(pLogicalDevice->device, intermediate, nullptr);
+    freeMemory(pLogicalDevice, bufferMemory);
 
     for (unsigned int i = 0; i < inputImageViews.size(); i++) {
         pLogicalDevice->vkd.DestroyImageView(pLogicalDevice->device, inputImageViews[i], nullptr);
@@ -13,6 +13,7 @@
 #include "config.hpp"
 #include "effect.hpp"
 #include "aist/nn_layer.h"
+#include "aist/model.hpp"
 
 namespace vkBasalt
 {
@@ -26,6 +27,8 @@ namespace vkBasalt
                    std::vector<VkImage> outputImages,
                    Config*              pConfig);
         virtual void applyEffect(uint32_t imageIndex, VkCommandBuffer commandBuffer) override;
+        virtual void useProfiler(Profiler* pProfiler) override;
+        virtual bool rebindImages(const std::vector<VkImage>& inputImages, const std::vector<VkImage>& outputImages) override;
         virtual ~AistEffect();
 
     private:
@@ -35,18 +38,27 @@ namespace vkBasalt
         std::vector<VkImage>         inputImages;
         std::vector<VkImage>         outputImages;
         Config*                      pConfig;
+        aist::TensorPrecision        precision;
+        aist::Model                  model;
 
         std::vector<VkImageView>     inputImageViews;
         std::vector<VkImageView>     outputImageViews;
-        VkDeviceMemory               bufferMemory;
+        MemoryAllocation             bufferMemory;
         VkBuffer                     weights;
-        std::vector<VkBuffer>        intermediates;
+        // Shared by all chain indices, frames run the network one after another on the same queue.
+        VkBuffer                     intermediate;
+        aist::TensorPlanner          tensorPlanner;
         std::vector<std::unique_ptr<aist::Layer>> layers;
         VkDescriptorPool             descriptorPool;
+        // Times every layer when set.
+        Profiler*                    pProfiler = nullptr;
 
+        void choosePrecision();
+        void planTensors();
         void allocateBuffers();
         void relayoutOutputImages();
         void createLayoutAndDescriptorSets();
+        void writeDescriptorSets();
     };
 
 } // namespace vkBasalt
\ No newline at end of file
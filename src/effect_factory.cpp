@@ -0,0 +1,75 @@
+#include "effect_factory.hpp"
+
+#include <stdexcept>
+
+#include "format.hpp"
+
+#include "effect_aist.hpp"
+#include "effect_fxaa.hpp"
+#include "effect_cas.hpp"
+#include "effect_dls.hpp"
+#include "effect_smaa.hpp"
+#include "effect_deband.hpp"
+#include "effect_lut.hpp"
+#include "effect_reshade.hpp"
+#include "effect_transfer.hpp"
+
+namespace vkBasalt
+{
+    std::shared_ptr<Effect> createEffect(const std::string&   name,
+                                         LogicalDevice*       pLogicalDevice,
+                                         VkFormat             format,
+                                         VkExtent2D           imageExtent,
+                                         std::vector<VkImage> inputImages,
+                                         std::vector<VkImage> outputImages,
+                                         Config*              pConfig)
+    {
+        VkFormat unormFormat = convertToUNORM(format);
+        VkFormat srgbFormat  = convertToSRGB(format);
+
+        std::shared_ptr<Effect> effect;
+        if (name == "fxaa")
+        {
+            effect = std::make_shared<FxaaEffect>(pLogicalDevice, srgbFormat, imageExtent, inputImages, outputImages, pConfig);
+        }
+        else if (name == "cas")
+        {
+            effect = std::make_shared<CasEffect>(pLogicalDevice, unormFormat, imageExtent, inputImages, outputImages, pConfig);
+        }
+        else if (name == "deband")
+        {
+            effect = std::make_shared<DebandEffect>(pLogicalDevice, unormFormat, imageExtent, inputImages, outputImages, pConfig);
+        }
+        else if (name == "smaa")
+        {
+            effect = std::make_shared<SmaaEffect>(pLogicalDevice, unormFormat, imageExtent, inputImages, outputImages, pConfig);
+        }
+        else if (name == "lut")
+        {
+            effect = std::make_shared<LutEffect>(pLogicalDevice, unormFormat, imageExtent, inputImages, outputImages, pConfig);
+        }
+        else if (name == "dls")
+        {
+            effect = std::make_shared<DlsEffect>(pLogicalDevice, unormFormat, imageExtent, inputImages, outputImages, pConfig);
+        }
+        else if (name == "aist")
+        {
+            try
+            {
+                effect = std::make_shared<AistEffect>(pLogicalDevice, unormFormat, imageExtent, inputImages, outputImages, pConfig);
+            }
+            catch (const std::runtime_error& e)
+            {
+                // A missing or broken model file, keeps the chain of effects intact by copying the images unchanged.
+                Logger::err("can't create effect " + name + ": " + e.what());
+                effect = std::make_shared<TransferEffect>(pLogicalDevice, format, imageExtent, inputImages, outputImages, pConfig);
+            }
+        }
+        else
+        {
+            effect = std::make_shared<ReshadeEffect>(pLogicalDevice, format, imageExtent, inputImages, outputImages, pConfig, name);
+        }
+        Logger::debug("created effect " + name);
+        return effect;
+    }
+} // namespace vkBasalt
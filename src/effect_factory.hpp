@@ -0,0 +1,26 @@
+#ifndef EFFECT_FACTORY_HPP_INCLUDED
+#define EFFECT_FACTORY_HPP_INCLUDED
+#include <vector>
+#include <string>
+#include <memory>
+
+#include "vulkan_include.hpp"
+
+#include "logical_device.hpp"
+#include "config.hpp"
+#include "effect.hpp"
+
+namespace vkBasalt
+{
+    // Creates the effect named in the "effects" option, names that aren't built-in effects are ReShade effects.
+    // format is the swapchain format, effects pick the UNORM or SRGB view of it themselves.
+    std::shared_ptr<Effect> createEffect(const std::string&   name,
+                                         LogicalDevice*       pLogicalDevice,
+                                         VkFormat             format,
+                                         VkExtent2D           imageExtent,
+                                         std::vector<VkImage> inputImages,
+                                         std::vector<VkImage> outputImages,
+                                         Config*              pConfig);
+} // namespace vkBasalt
+
+#endif // EFFECT_FACTORY_HPP_INCLUDED
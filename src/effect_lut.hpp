@@ -29,7 +29,7 @@ namespace vkBasalt
 
     private:
         VkImage               lutImage;
-        VkDeviceMemory        lutMemory;
+        MemoryAllocation      lutMemory;
         VkImageView           lutImageView;
         VkDescriptorSetLayout lutDescriptorSetLayout;
         VkDescriptorPool      lutDescriptorPool;
@@ -18,13 +18,12 @@
 #include "shader.hpp"
 #include "sampler.hpp"
 #include "image.hpp"
+#include "memory.hpp"
 #include "format.hpp"
 
 #include "util.hpp"
-
-#include "stb_image.h"
-#include "stb_image_dds.h"
-#include "stb_image_resize.h"
+#include "reshade_module_cache.hpp"
+#include "texture_loader.hpp"
 
 namespace vkBasalt
 {
@@ -63,17 +62,27 @@ namespace vkBasalt
         bufferSize = module.total_uniform_size;
         if (bufferSize)
         {
+            VkPhysicalDeviceProperties properties;
+            pLogicalDevice->vki.GetPhysicalDeviceProperties(pLogicalDevice->physicalDevice, &properties);
+            VkDeviceSize alignment = properties.limits.minUniformBufferOffsetAlignment;
+            uniformSliceSize       = (bufferSize + alignment - 1) / alignment * alignment;
+
+            // Device local if the GPU has host visible VRAM, the shaders then read it without going over the bus.
             createBuffer(pLogicalDevice,
-                         bufferSize,
+                         uniformSliceSize * inputImages.size(),
                          VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                         stagingBuffer,
-                         stagingBufferMemory);
+                         uniformBuffer,
+                         uniformBufferMemory,
+                         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+            uniformData = uniformBufferMemory.mapped;
+            std::memset(uniformData, 0, uniformSliceSize * inputImages.size());
         }
 
         stencilFormat = getStencilFormat(pLogicalDevice);
         Logger::debug("Stencil Format: " + std::to_string(stencilFormat));
-        textureMemory.push_back(VK_NULL_HANDLE);
+        textureMemory.push_back({});
         stencilImage = createImages(pLogicalDevice,
                                     1,
                                     {imageExtent.width, imageExtent.height, 1},
@@ -87,6 +96,22 @@ namespace vkBasalt
 
         std::vector<std::vector<VkImageView>> imageViewVector;
 
+        // Texture files get decoded on worker threads, while the images and views of all textures are created.
+        std::vector<std::shared_future<DecodedTexture>> sourceTextures(module.textures.size());
+        for (size_t i = 0; i < module.textures.size(); i++)
+        {
+            const auto source = std::find_if(
+                module.textures[i].annotations.begin(), module.textures[i].annotations.end(), [](const auto& a) { return a.name == "source"; });
+            if (module.textures[i].semantic != "COLOR" && module.textures[i].semantic != "DEPTH" && source != module.textures[i].annotations.end())
+            {
+                sourceTextures[i] = loadTexture(pConfig->getOption<std::string>("reshadeTexturePath") + "/" + source->value.string_data,
+                                                {module.textures[i].width, module.textures[i].height, 1},
+                                                convertToUNORM(convertReshadeFormat(module.textures[i].format)),
+                                                module.textures[i].levels,
+                                                pLogicalDevice->supportsTextureCompressionBC);
+            }
+        }
+
         for (size_t i = 0; i < module.textures.size(); i++)
         {
             textureMipLevels[module.textures[i].unique_name] = module.textures[i].levels;
@@ -118,11 +143,9 @@ namespace vkBasalt
             VkExtent3D textureExtent = {module.textures[i].width, module.textures[i].height, 1};
             // TODO handle mip map levels correctly
             // TODO handle pooled textures better
-            if (const auto source = std::find_if(
-                    module.textures[i].annotations.begin(), module.textures[i].annotations.end(), [](const auto& a) { return a.name == "source"; });
-                source == module.textures[i].annotations.end())
+            if (!sourceTextures[i].valid())
             {
-                textureMemory.push_back(VK_NULL_HANDLE);
+                textureMemory.push_back({});
                 std::vector<VkImage> images = createImages(pLogicalDevice,
                                                            1,
                                                            textureExtent,
@@ -179,12 +202,17 @@ namespace vkBasalt
             }
             else
             {
-                textureMemory.push_back(VK_NULL_HANDLE);
+                // Block compressed textures need an image in their own format, so this one waits for the decoding.
+                DecodedTexture texture       = sourceTextures[i].get();
+                VkFormat       textureFormat = texture.pixels && getBlockSize(texture.format) ? texture.format
+                                                                                               : convertReshadeFormat(module.textures[i].format);
+
+                textureMemory.push_back({});
                 std::vector<VkImage> images =
                     createImages(pLogicalDevice,
                                  1,
                                  textureExtent,
-                                 convertReshadeFormat(module.textures[i].format), // TODO search for format and save it
+                                 textureFormat,
                                  VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                                  textureMemory.back(),
@@ -193,7 +221,7 @@ namespace vkBasalt
                 textureImages[module.textures[i].unique_name] = images;
 
                 std::vector<VkImageView> imageViews = createImageViews(pLogicalDevice,
-                                                                       convertToUNORM(convertReshadeFormat(module.textures[i].format)),
+                                                                       convertToUNORM(textureFormat),
                                                                        images,
                                                                        VK_IMAGE_VIEW_TYPE_2D,
                                                                        VK_IMAGE_ASPECT_COLOR_BIT,
@@ -202,7 +230,7 @@ namespace vkBasalt
                 std::vector<VkImageView> imageViewsUNORM = std::vector<VkImageView>(inputImages.size(), imageViews[0]);
 
                 imageViews = createImageViews(pLogicalDevice,
-                                              convertToSRGB(convertReshadeFormat(module.textures[i].format)),
+                                              convertToSRGB(textureFormat),
                                               images,
                                               VK_IMAGE_VIEW_TYPE_2D,
                                               VK_IMAGE_ASPECT_COLOR_BIT,
@@ -216,74 +244,34 @@ namespace vkBasalt
                 renderImageViewsUNORM[module.textures[i].unique_name] = imageViewsUNORM;
                 renderImageViewsSRGB[module.textures[i].unique_name]  = imageViewsSRGB;
 
-                textureFormatsUNORM[module.textures[i].unique_name] = convertToUNORM(convertReshadeFormat(module.textures[i].format));
-                textureFormatsSRGB[module.textures[i].unique_name]  = convertToSRGB(convertReshadeFormat(module.textures[i].format));
-
-                int desiredChannels;
-                switch (textureFormatsUNORM[module.textures[i].unique_name])
-                {
-                    case VK_FORMAT_R8_UNORM: desiredChannels = STBI_grey; break;
-                    case VK_FORMAT_R8G8_UNORM:
-                        desiredChannels = STBI_rgb_alpha; // TODO why doesn't STBI_grey_alpha work?
-                        break;
-                    case VK_FORMAT_R8G8B8A8_UNORM: desiredChannels = STBI_rgb_alpha; break;
-                    case VK_FORMAT_R8G8B8A8_SRGB: desiredChannels = STBI_rgb_alpha; break;
-                    default:
-                        Logger::err("unsupported texture upload format" + std::to_string(textureFormatsUNORM[module.textures[i].unique_name]));
-                        desiredChannels = 4;
-                        break;
-                }
-
-                std::string          filePath = pConfig->getOption<std::string>("reshadeTexturePath") + "/" + source->value.string_data;
-                stbi_uc*             pixels;
-                std::vector<stbi_uc> resizedPixels;
-                uint32_t             size;
-                int                  width;
-                int                  height;
-
-                size = textureExtent.width * textureExtent.height * desiredChannels;
-
-                FILE* const file = fopen(filePath.c_str(), "rb");
-
-                if (file == nullptr)
-                {
-                    Logger::err("couldn't open texture: " + filePath);
-                }
-                if (stbi_dds_test_file(file))
-                {
-                    int channels;
-                    pixels = stbi_dds_load_from_file(file, &width, &height, &channels, desiredChannels);
-                }
-                else
-                {
-                    int channels;
-                    pixels = stbi_load_from_file(file, &width, &height, &channels, desiredChannels);
-                }
+                textureFormatsUNORM[module.textures[i].unique_name] = convertToUNORM(textureFormat);
+                textureFormatsSRGB[module.textures[i].unique_name]  = convertToSRGB(textureFormat);
 
-                // change RGBA to RG
-                if (textureFormatsUNORM[module.textures[i].unique_name] == VK_FORMAT_R8G8_UNORM)
+                if (!texture.pixels)
                 {
-                    uint32_t pos = 0;
-                    for (uint32_t j = 0; j < size; j += 4)
-                    {
-                        pixels[pos] = pixels[j];
-                        pos++;
-                        pixels[pos] = pixels[j + 1];
-                        pos++;
-                    }
-                    size /= 2;
-                    desiredChannels /= 2;
+                    changeImageLayout(pLogicalDevice, images, module.textures[i].levels);
+                    continue;
                 }
-
-                if (static_cast<uint32_t>(width) != textureExtent.width || static_cast<uint32_t>(height) != textureExtent.height)
+                if (texture.extent.width != textureExtent.width || texture.extent.height != textureExtent.height)
                 {
-                    resizedPixels.resize(size);
-                    stbir_resize_uint8(pixels, width, height, 0, resizedPixels.data(), textureExtent.width, textureExtent.height, 0, desiredChannels);
+                    uploadToImageResized(pLogicalDevice,
+                                         images[0],
+                                         textureExtent,
+                                         textureFormat,
+                                         texture.extent,
+                                         texture.size,
+                                         texture.pixels.get(),
+                                         module.textures[i].levels);
+                    continue;
                 }
-
-                uploadToImage(
-                    pLogicalDevice, images[0], textureExtent, size, resizedPixels.size() ? resizedPixels.data() : pixels, module.textures[i].levels);
-                stbi_image_free(pixels);
+                uploadToImage(pLogicalDevice,
+                              images[0],
+                              textureExtent,
+                              textureFormat,
+                              texture.size,
+                              texture.pixels.get(),
+                              module.textures[i].levels,
+                              texture.levels);
             }
         }
 
@@ -307,7 +295,7 @@ namespace vkBasalt
         imagePoolSize.descriptorCount = inputImages.size() * module.samplers.size() * 3;
 
         VkDescriptorPoolSize bufferPoolSize;
-        bufferPoolSize.type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        bufferPoolSize.type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
         bufferPoolSize.descriptorCount = 3;
 
         std::vector<VkDescriptorPoolSize> poolSizes = {imagePoolSize, bufferPoolSize};
@@ -324,11 +312,12 @@ namespace vkBasalt
         Logger::debug("output writes: " + std::to_string(outputWrites));
         if (bufferSize)
         {
-            bufferDescriptorSet = writeBufferDescriptorSet(pLogicalDevice, descriptorPool, uniformDescriptorSetLayout, stagingBuffer);
+            bufferDescriptorSet = writeBufferDescriptorSet(pLogicalDevice, descriptorPool, uniformDescriptorSetLayout, uniformBuffer, bufferSize);
         }
 
         inputDescriptorSets =
             allocateAndWriteImageSamplerDescriptorSets(pLogicalDevice, descriptorPool, imageSamplerDescriptorSetLayout, samplers, imageViewVector);
+        inputDescriptorImageViews = imageViewVector;
 
         // count the back buffer writes
         for (auto& pass : module.techniques[0].passes)
@@ -342,7 +331,7 @@ namespace vkBasalt
         // if there is only one outputWrite, we can directly write to outputImages
         if (outputWrites > 1)
         {
-            textureMemory.push_back(VK_NULL_HANDLE);
+            textureMemory.push_back({});
             backBufferImages = createImages(pLogicalDevice,
                                             inputImages.size(),
                                             {imageExtent.width, imageExtent.height, 1},
@@ -359,6 +348,7 @@ namespace vkBasalt
 
             backBufferDescriptorSets = allocateAndWriteImageSamplerDescriptorSets(
                 pLogicalDevice, descriptorPool, imageSamplerDescriptorSetLayout, samplers, imageViewVector);
+            backBufferDescriptorImageViews = imageViewVector;
         }
         if (outputWrites > 2)
         {
@@ -366,6 +356,7 @@ namespace vkBasalt
             std::replace(imageViewVector.begin(), imageViewVector.end(), backBufferImageViewsUNORM, outputImageViewsUNORM);
             outputDescriptorSets = allocateAndWriteImageSamplerDescriptorSets(
                 pLogicalDevice, descriptorPool, imageSamplerDescriptorSetLayout, samplers, imageViewVector);
+            outputDescriptorImageViews = imageViewVector;
         }
 
         Logger::debug("after writing ImageSamplerDescriptorSets");
@@ -542,19 +533,19 @@ namespace vkBasalt
             {
                 std::vector<VkImageView> backBufferImageViews = pass.srgb_write_enable ? backBufferImageViewsSRGB : backBufferImageViewsUNORM;
                 std::vector<VkImageView> outputImageViews     = pass.srgb_write_enable ? outputImageViewsSRGB : outputImageViewsUNORM;
-                framebuffers.push_back(createFramebuffers(
-                    pLogicalDevice,
-                    renderPass,
-                    imageExtent,
-                    {outputToBackBuffer ? backBufferImageViews : outputImageViews, std::vector<VkImageView>(inputImages.size(), stencilImageView)}));
+                framebufferImageViews.push_back(
+                    {outputToBackBuffer ? backBufferImageViews : outputImageViews, std::vector<VkImageView>(inputImages.size(), stencilImageView)});
+                framebufferExtents.push_back(imageExtent);
                 outputToBackBuffer = !outputToBackBuffer;
                 switchSamplers.push_back(true);
             }
             else
             {
-                framebuffers.push_back(createFramebuffers(pLogicalDevice, renderPass, scissor.extent, attachmentImageViews));
+                framebufferImageViews.push_back(attachmentImageViews);
+                framebufferExtents.push_back(scissor.extent);
                 switchSamplers.push_back(false);
             }
+            framebuffers.push_back(createFramebuffers(pLogicalDevice, renderPass, framebufferExtents.back(), framebufferImageViews.back()));
 
             // pipeline
 
@@ -760,7 +751,7 @@ namespace vkBasalt
             pipelineCreateInfo.basePipelineIndex   = -1;
 
             VkPipeline pipeline;
-            result = pLogicalDevice->vkd.CreateGraphicsPipelines(pLogicalDevice->device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &pipeline);
+            result = pLogicalDevice->vkd.CreateGraphicsPipelines(pLogicalDevice->device, pLogicalDevice->pipelineCache, 1, &pipelineCreateInfo, nullptr, &pipeline);
             ASSERT_VULKAN(result);
 
             graphicsPipelines.push_back(pipeline);
@@ -771,18 +762,12 @@ namespace vkBasalt
         Logger::debug("finished creating Reshade effect");
     }
 
-    void ReshadeEffect::updateEffect()
+    void ReshadeEffect::updateEffect(uint32_t imageIndex)
     {
-        if (bufferSize)
+        // The last submission that read this slice is done, the image got presented and acquired again since.
+        for (auto& uniform : uniforms)
         {
-            void*    data;
-            VkResult result = pLogicalDevice->vkd.MapMemory(pLogicalDevice->device, stagingBufferMemory, 0, bufferSize, 0, &data);
-            ASSERT_VULKAN(result);
-            for (auto& uniform : uniforms)
-            {
-                uniform->update(data);
-            }
-            pLogicalDevice->vkd.UnmapMemory(pLogicalDevice->device, stagingBufferMemory);
+            uniform->update(uniformData + uniformSliceSize * imageIndex);
         }
     }
 
@@ -844,6 +829,88 @@ namespace vkBasalt
             }
         }
     }
+    bool ReshadeEffect::rebindImages(const std::vector<VkImage>& inputImages, const std::vector<VkImage>& outputImages)
+    {
+        // Module, textures, render targets, the back buffer and pipelines stay. The views of the old images get replaced
+        // wherever they are used, then descriptor sets and framebuffers are written again.
+        std::vector<VkImageView> oldImageViews;
+        for (auto imageViews : {&inputImageViewsSRGB, &inputImageViewsUNORM, &outputImageViewsSRGB, &outputImageViewsUNORM})
+        {
+            oldImageViews.insert(oldImageViews.end(), imageViews->begin(), imageViews->end());
+        }
+
+        this->inputImages     = inputImages;
+        this->outputImages    = outputImages;
+        inputImageViewsSRGB   = createImageViews(pLogicalDevice, inputOutputFormatSRGB, inputImages);
+        inputImageViewsUNORM  = createImageViews(pLogicalDevice, inputOutputFormatUNORM, inputImages);
+        outputImageViewsSRGB  = createImageViews(pLogicalDevice, inputOutputFormatSRGB, outputImages);
+        outputImageViewsUNORM = createImageViews(pLogicalDevice, inputOutputFormatUNORM, outputImages);
+
+        std::unordered_map<VkImageView, VkImageView> replacements;
+        uint32_t                                     replacementIndex = 0;
+        for (auto imageViews : {&inputImageViewsSRGB, &inputImageViewsUNORM, &outputImageViewsSRGB, &outputImageViewsUNORM})
+        {
+            for (auto imageView : *imageViews)
+            {
+                replacements[oldImageViews[replacementIndex++]] = imageView;
+            }
+        }
+        auto replace = [&replacements](std::vector<VkImageView>& imageViews) {
+            for (auto& imageView : imageViews)
+            {
+                if (auto replacement = replacements.find(imageView); replacement != replacements.end())
+                {
+                    imageView = replacement->second;
+                }
+            }
+        };
+
+        for (auto imageViewMap : {&textureImageViewsSRGB, &textureImageViewsUNORM, &renderImageViewsSRGB, &renderImageViewsUNORM})
+        {
+            for (auto& it : *imageViewMap)
+            {
+                replace(it.second);
+            }
+        }
+        for (auto descriptorImageViews : {&inputDescriptorImageViews, &backBufferDescriptorImageViews, &outputDescriptorImageViews})
+        {
+            for (auto& imageViews : *descriptorImageViews)
+            {
+                replace(imageViews);
+            }
+        }
+
+        // The depth image gets written again by useDepthImage when the command buffers get recorded.
+        writeImageSamplerDescriptorSets(pLogicalDevice, inputDescriptorSets, samplers, inputDescriptorImageViews);
+        if (backBufferDescriptorSets.size())
+        {
+            writeImageSamplerDescriptorSets(pLogicalDevice, backBufferDescriptorSets, samplers, backBufferDescriptorImageViews);
+        }
+        if (outputDescriptorSets.size())
+        {
+            writeImageSamplerDescriptorSets(pLogicalDevice, outputDescriptorSets, samplers, outputDescriptorImageViews);
+        }
+
+        for (uint32_t i = 0; i < framebuffers.size(); i++)
+        {
+            for (auto& framebuffer : framebuffers[i])
+            {
+                pLogicalDevice->vkd.DestroyFramebuffer(pLogicalDevice->device, framebuffer, nullptr);
+            }
+            for (auto& imageViews : framebufferImageViews[i])
+            {
+                replace(imageViews);
+            }
+            framebuffers[i] = createFramebuffers(pLogicalDevice, renderPasses[i], framebufferExtents[i], framebufferImageViews[i]);
+        }
+
+        for (auto imageView : oldImageViews)
+        {
+            pLogicalDevice->vkd.DestroyImageView(pLogicalDevice->device, imageView, nullptr);
+        }
+        return true;
+    }
+
     void ReshadeEffect::applyEffect(uint32_t imageIndex, VkCommandBuffer commandBuffer)
     {
         Logger::debug("applying ReshadeEffect to command buffer" + convertToString(commandBuffer));
@@ -932,8 +999,9 @@ namespace vkBasalt
 
         if (bufferSize)
         {
+            uint32_t dynamicOffset = uniformSliceSize * imageIndex;
             pLogicalDevice->vkd.CmdBindDescriptorSets(
-                commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &bufferDescriptorSet, 0, nullptr);
+                commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &bufferDescriptorSet, 1, &dynamicOffset);
             Logger::debug("after binding uniform buffer");
         }
 
@@ -1010,8 +1078,8 @@ namespace vkBasalt
 
         if (bufferSize)
         {
-            pLogicalDevice->vkd.FreeMemory(pLogicalDevice->device, stagingBufferMemory, nullptr);
-            pLogicalDevice->vkd.DestroyBuffer(pLogicalDevice->device, stagingBuffer, nullptr);
+            pLogicalDevice->vkd.DestroyBuffer(pLogicalDevice->device, uniformBuffer, nullptr);
+            freeMemory(pLogicalDevice, uniformBufferMemory);
         }
 
         pLogicalDevice->vkd.DestroyPipelineLayout(pLogicalDevice->device, pipelineLayout, nullptr);
@@ -1112,51 +1180,75 @@ namespace vkBasalt
 
         for (auto& memory : textureMemory)
         {
-            pLogicalDevice->vkd.FreeMemory(pLogicalDevice->device, memory, nullptr);
+            freeMemory(pLogicalDevice, memory);
         }
     }
 
     void ReshadeEffect::createReshadeModule()
     {
-        std::string tempFile  = "/tmp/vkBasalt.spv";
-        std::string tempFile2 = "/tmp/vkBasalt.spv";
-
-        reshadefx::preprocessor preprocessor;
-        preprocessor.add_macro_definition("__RESHADE__", std::to_string(INT_MAX));
-        preprocessor.add_macro_definition("__RESHADE_PERFORMANCE_MODE__", "1");
-        preprocessor.add_macro_definition("__RENDERER__", "0x20000");
-        // TODO add more macros
-
-        preprocessor.add_macro_definition("BUFFER_WIDTH", std::to_string(imageExtent.width));
-        preprocessor.add_macro_definition("BUFFER_HEIGHT", std::to_string(imageExtent.height));
-        preprocessor.add_macro_definition("BUFFER_RCP_WIDTH", "(1.0 / BUFFER_WIDTH)");
-        preprocessor.add_macro_definition("BUFFER_RCP_HEIGHT", "(1.0 / BUFFER_HEIGHT)");
-        preprocessor.add_macro_definition("BUFFER_COLOR_DEPTH", (inputOutputFormatUNORM == VK_FORMAT_A2R10G10B10_UNORM_PACK32) ? "10" : "8");
-        preprocessor.add_include_path(pConfig->getOption<std::string>("reshadeIncludePath"));
-        if (!preprocessor.append_file(pConfig->getOption<std::string>(effectName)))
+        std::string effectPath  = pConfig->getOption<std::string>(effectName);
+        std::string includePath = pConfig->getOption<std::string>("reshadeIncludePath");
+
+        std::vector<std::pair<std::string, std::string>> macros = {
+            {"__RESHADE__", std::to_string(INT_MAX)},
+            {"__RESHADE_PERFORMANCE_MODE__", "1"},
+            {"__RENDERER__", "0x20000"},
+            // TODO add more macros
+            {"BUFFER_WIDTH", std::to_string(imageExtent.width)},
+            {"BUFFER_HEIGHT", std::to_string(imageExtent.height)},
+            {"BUFFER_RCP_WIDTH", "(1.0 / BUFFER_WIDTH)"},
+            {"BUFFER_RCP_HEIGHT", "(1.0 / BUFFER_HEIGHT)"},
+            {"BUFFER_COLOR_DEPTH", (inputOutputFormatUNORM == VK_FORMAT_A2R10G10B10_UNORM_PACK32) ? "10" : "8"},
+        };
+
+        // Everything compiling depends on besides the contents of the files, those get checked by the cache.
+        std::string cacheKey = "spirv vulkan debug spec-constants flip-vertex\n" + effectPath + "\n" + includePath + "\n";
+        for (const auto& [name, value] : macros)
         {
-            Logger::err("failed to load shader file: " + pConfig->getOption<std::string>(effectName));
-            Logger::err("Does the filepath exist and does it not include spaces?");
+            cacheKey += name + "=" + value + "\n";
         }
 
-        reshadefx::parser parser;
-
-        std::string errors = preprocessor.errors();
-        if (errors != "")
+        if (!loadReshadeModule(cacheKey, module))
         {
-            Logger::err(errors);
-        }
+            reshadefx::preprocessor preprocessor;
+            for (const auto& [name, value] : macros)
+            {
+                preprocessor.add_macro_definition(name, value);
+            }
+            preprocessor.add_include_path(includePath);
+            if (!preprocessor.append_file(effectPath))
+            {
+                Logger::err("failed to load shader file: " + effectPath);
+                Logger::err("Does the filepath exist and does it not include spaces?");
+            }
 
-        std::unique_ptr<reshadefx::codegen> codegen(reshadefx::create_codegen_spirv(
-            true /* vulkan semantics */, true /* debug info */, true /* uniforms to spec constants */, true /*flip vertex shader*/));
-        parser.parse(std::move(preprocessor.output()), codegen.get());
+            reshadefx::parser parser;
 
-        errors = parser.errors();
-        if (errors != "")
-        {
-            Logger::err(errors);
+            std::string errors = preprocessor.errors();
+            if (errors != "")
+            {
+                Logger::err(errors);
+            }
+
+            std::unique_ptr<reshadefx::codegen> codegen(reshadefx::create_codegen_spirv(
+                true /* vulkan semantics */, true /* debug info */, true /* uniforms to spec constants */, true /*flip vertex shader*/));
+            bool parsed = parser.parse(std::move(preprocessor.output()), codegen.get());
+
+            std::string parserErrors = parser.errors();
+            if (parserErrors != "")
+            {
+                Logger::err(parserErrors);
+            }
+            codegen->write_result(module);
+
+            // Only cache clean results, warnings would otherwise not show up again.
+            if (parsed && errors.empty() && parserErrors.empty())
+            {
+                std::vector<std::filesystem::path> sourceFiles = preprocessor.included_files();
+                sourceFiles.push_back(effectPath);
+                saveReshadeModule(cacheKey, sourceFiles, module);
+            }
         }
-        codegen->write_result(module);
 
         VkShaderModuleCreateInfo shaderCreateInfo;
         shaderCreateInfo.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
@@ -33,8 +33,9 @@ namespace vkBasalt
                       Config*              pConfig,
                       std::string          effectName);
         void virtual applyEffect(uint32_t imageIndex, VkCommandBuffer commandBuffer) override;
-        void virtual updateEffect() override;
+        void virtual updateEffect(uint32_t imageIndex) override;
         void virtual useDepthImage(VkImageView depthImageView) override;
+        bool virtual rebindImages(const std::vector<VkImage>& inputImages, const std::vector<VkImage>& outputImages) override;
         virtual ~ReshadeEffect();
 
     private:
@@ -60,8 +61,15 @@ namespace vkBasalt
         std::vector<VkDescriptorSet> inputDescriptorSets;
         std::vector<VkDescriptorSet> outputDescriptorSets;
         std::vector<VkDescriptorSet> backBufferDescriptorSets;
+        // What got written into the sets above, rebindImages replaces the views of input and output images in there.
+        std::vector<std::vector<VkImageView>> inputDescriptorImageViews;
+        std::vector<std::vector<VkImageView>> outputDescriptorImageViews;
+        std::vector<std::vector<VkImageView>> backBufferDescriptorImageViews;
 
-        std::vector<std::vector<VkFramebuffer>> framebuffers;
+        // Per pass, the attachments and extent every framebuffer of the pass got created with.
+        std::vector<std::vector<VkFramebuffer>>            framebuffers;
+        std::vector<std::vector<std::vector<VkImageView>>> framebufferImageViews;
+        std::vector<VkExtent2D>                            framebufferExtents;
 
         VkDescriptorSetLayout                 uniformDescriptorSetLayout;
         VkDescriptorSetLayout                 imageSamplerDescriptorSetLayout;
@@ -78,7 +86,7 @@ namespace vkBasalt
         Config*                               pConfig;
         std::string                           effectName;
         reshadefx::module                     module;
-        std::vector<VkDeviceMemory>           textureMemory;
+        std::vector<MemoryAllocation>         textureMemory;
 
         VkFormat    inputOutputFormatUNORM;
         VkFormat    inputOutputFormatSRGB;
@@ -91,9 +99,13 @@ namespace vkBasalt
         std::vector<VkImage>     backBufferImages;
         std::vector<VkImageView> backBufferImageViewsUNORM;
         std::vector<VkImageView> backBufferImageViewsSRGB;
-        VkBuffer                 stagingBuffer;
-        VkDeviceMemory           stagingBufferMemory;
+        // One slice of uniforms per image, so that the values of a frame the GPU is still reading don't get overwritten.
+        // The memory stays mapped, the slice is chosen with the dynamic offset of bufferDescriptorSet.
+        VkBuffer                 uniformBuffer;
+        MemoryAllocation         uniformBufferMemory;
+        uint8_t*                 uniformData;
         uint32_t                 bufferSize;
+        VkDeviceSize             uniformSliceSize;
         VkDescriptorSet          bufferDescriptorSet;
 
         std::vector<std::shared_ptr<ReshadeUniform>> uniforms;
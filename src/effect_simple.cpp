@@ -159,6 +159,26 @@ namespace vkBasalt
                                                &secondBarrier);
         Logger::debug("after the second pipeline barrier");
     }
+    bool SimpleEffect::rebindImages(const std::vector<VkImage>& inputImages, const std::vector<VkImage>& outputImages)
+    {
+        for (unsigned int i = 0; i < framebuffers.size(); i++)
+        {
+            pLogicalDevice->vkd.DestroyFramebuffer(pLogicalDevice->device, framebuffers[i], nullptr);
+            pLogicalDevice->vkd.DestroyImageView(pLogicalDevice->device, inputImageViews[i], nullptr);
+            pLogicalDevice->vkd.DestroyImageView(pLogicalDevice->device, outputImageViews[i], nullptr);
+        }
+
+        this->inputImages  = inputImages;
+        this->outputImages = outputImages;
+
+        inputImageViews  = createImageViews(pLogicalDevice, format, inputImages);
+        outputImageViews = createImageViews(pLogicalDevice, format, outputImages);
+
+        writeImageSamplerDescriptorSets(pLogicalDevice, imageDescriptorSets, {sampler}, {inputImageViews});
+
+        framebuffers = createFramebuffers(pLogicalDevice, renderPass, imageExtent, {outputImageViews});
+        return true;
+    }
     SimpleEffect::~SimpleEffect()
     {
         Logger::debug("destroying SimpleEffect " + convertToString(this));
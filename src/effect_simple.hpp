@@ -22,6 +22,7 @@ namespace vkBasalt
     public:
         SimpleEffect();
         void virtual applyEffect(uint32_t imageIndex, VkCommandBuffer commandBuffer) override;
+        bool virtual rebindImages(const std::vector<VkImage>& inputImages, const std::vector<VkImage>& outputImages) override;
         virtual ~SimpleEffect();
 
     protected:
@@ -11,6 +11,7 @@
 #include "shader.hpp"
 #include "sampler.hpp"
 #include "image.hpp"
+#include "memory.hpp"
 #include "util.hpp"
 
 #include "AreaTex.h"
@@ -78,9 +79,9 @@ namespace vkBasalt
                                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                                    searchMemory)[0];
 
-        uploadToImage(pLogicalDevice, areaImage, areaImageExtent, AREATEX_SIZE, areaTexBytes);
+        uploadToImage(pLogicalDevice, areaImage, areaImageExtent, VK_FORMAT_R8G8_UNORM, AREATEX_SIZE, areaTexBytes);
 
-        uploadToImage(pLogicalDevice, searchImage, searchImageExtent, SEARCHTEX_SIZE, searchTexBytes);
+        uploadToImage(pLogicalDevice, searchImage, searchImageExtent, VK_FORMAT_R8_UNORM, SEARCHTEX_SIZE, searchTexBytes);
 
         areaImageView = createImageViews(pLogicalDevice, VK_FORMAT_R8G8_UNORM, std::vector<VkImage>(1, areaImage))[0];
         Logger::debug("after creating area ImageView");
@@ -205,6 +206,33 @@ namespace vkBasalt
         blendFramebuffers    = createFramebuffers(pLogicalDevice, unormRenderPass, imageExtent, {blendImageViews});
         neignborFramebuffers = createFramebuffers(pLogicalDevice, renderPass, imageExtent, {outputImageViews});
     }
+    bool SmaaEffect::rebindImages(const std::vector<VkImage>& inputImages, const std::vector<VkImage>& outputImages)
+    {
+        // Edge and blend images have the size of the swapchain, so they stay.
+        for (unsigned int i = 0; i < neignborFramebuffers.size(); i++)
+        {
+            pLogicalDevice->vkd.DestroyFramebuffer(pLogicalDevice->device, neignborFramebuffers[i], nullptr);
+            pLogicalDevice->vkd.DestroyImageView(pLogicalDevice->device, inputImageViews[i], nullptr);
+            pLogicalDevice->vkd.DestroyImageView(pLogicalDevice->device, outputImageViews[i], nullptr);
+        }
+
+        this->inputImages  = inputImages;
+        this->outputImages = outputImages;
+
+        inputImageViews  = createImageViews(pLogicalDevice, format, inputImages);
+        outputImageViews = createImageViews(pLogicalDevice, format, outputImages);
+
+        std::vector<std::vector<VkImageView>> imageViewsVector = {inputImageViews,
+                                                                  edgeImageViews,
+                                                                  std::vector<VkImageView>(inputImageViews.size(), areaImageView),
+                                                                  std::vector<VkImageView>(inputImageViews.size(), searchImageView),
+                                                                  blendImageViews};
+        writeImageSamplerDescriptorSets(
+            pLogicalDevice, imageDescriptorSets, std::vector<VkSampler>(imageViewsVector.size(), sampler), imageViewsVector);
+
+        neignborFramebuffers = createFramebuffers(pLogicalDevice, renderPass, imageExtent, {outputImageViews});
+        return true;
+    }
     void SmaaEffect::applyEffect(uint32_t imageIndex, VkCommandBuffer commandBuffer)
     {
         Logger::debug("applying smaa effect to cb " + convertToString(commandBuffer));
@@ -349,9 +377,9 @@ namespace vkBasalt
         pLogicalDevice->vkd.DestroyShaderModule(pLogicalDevice->device, neignborFragmentModule, nullptr);
 
         pLogicalDevice->vkd.DestroyDescriptorPool(pLogicalDevice->device, descriptorPool, nullptr);
-        pLogicalDevice->vkd.FreeMemory(pLogicalDevice->device, imageMemory, nullptr);
-        pLogicalDevice->vkd.FreeMemory(pLogicalDevice->device, areaMemory, nullptr);
-        pLogicalDevice->vkd.FreeMemory(pLogicalDevice->device, searchMemory, nullptr);
+        freeMemory(pLogicalDevice, imageMemory);
+        freeMemory(pLogicalDevice, areaMemory);
+        freeMemory(pLogicalDevice, searchMemory);
         for (unsigned int i = 0; i < edgeFramebuffers.size(); i++)
         {
             pLogicalDevice->vkd.DestroyFramebuffer(pLogicalDevice->device, edgeFramebuffers[i], nullptr);
@@ -27,6 +27,7 @@ namespace vkBasalt
                    std::vector<VkImage> outputImages,
                    Config*              pConfig);
         void applyEffect(uint32_t imageIndex, VkCommandBuffer commandBuffer) override;
+        bool rebindImages(const std::vector<VkImage>& inputImages, const std::vector<VkImage>& outputImages) override;
         ~SmaaEffect();
 
     private:
@@ -63,9 +64,9 @@ namespace vkBasalt
         VkPipeline                   neighborPipeline;
         VkExtent2D                   imageExtent;
         VkFormat                     format;
-        VkDeviceMemory               imageMemory;
-        VkDeviceMemory               areaMemory;
-        VkDeviceMemory               searchMemory;
+        MemoryAllocation             imageMemory;
+        MemoryAllocation             areaMemory;
+        MemoryAllocation             searchMemory;
         VkSampler                    sampler;
 
         Config* pConfig;
@@ -81,6 +81,13 @@ namespace vkBasalt
             commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &memoryBarrier);
     }
 
+    bool TransferEffect::rebindImages(const std::vector<VkImage>& inputImages, const std::vector<VkImage>& outputImages)
+    {
+        this->inputImages  = inputImages;
+        this->outputImages = outputImages;
+        return true;
+    }
+
     TransferEffect::~TransferEffect()
     {
     }
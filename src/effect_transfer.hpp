@@ -27,6 +27,7 @@ namespace vkBasalt
                        std::vector<VkImage> outputImages,
                        Config*              pConfig);
         void virtual applyEffect(uint32_t imageIndex, VkCommandBuffer commandBuffer) override;
+        bool virtual rebindImages(const std::vector<VkImage>& inputImages, const std::vector<VkImage>& outputImages) override;
         virtual ~TransferEffect();
 
     private:
@@ -2,12 +2,14 @@
 #include "memory.hpp"
 #include "format.hpp"
 
+#include <algorithm>
+
 namespace vkBasalt
 {
     std::vector<VkImage> createFakeSwapchainImages(LogicalDevice*           pLogicalDevice,
                                                    VkSwapchainCreateInfoKHR swapchainCreateInfo,
                                                    uint32_t                 count,
-                                                   VkDeviceMemory&          deviceMemory)
+                                                   MemoryAllocation&        deviceMemory)
     {
         std::vector<VkImage> fakeImages(count);
 
@@ -66,21 +68,32 @@ namespace vkBasalt
             memoryRequirements.size = (memoryRequirements.size / memoryRequirements.alignment + 1) * memoryRequirements.alignment;
         }
 
-        VkMemoryAllocateInfo memoryAllocateInfo;
-        memoryAllocateInfo.sType          = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        memoryAllocateInfo.pNext          = nullptr;
-        memoryAllocateInfo.allocationSize = memoryRequirements.size * count;
-        memoryAllocateInfo.memoryTypeIndex =
-            findMemoryTypeIndex(pLogicalDevice, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-        result = pLogicalDevice->vkd.AllocateMemory(pLogicalDevice->device, &memoryAllocateInfo, nullptr, &deviceMemory);
-        ASSERT_VULKAN(result);
+        VkDeviceSize imageSize  = memoryRequirements.size;
+        memoryRequirements.size = imageSize * count;
+        deviceMemory = allocateMemory(pLogicalDevice, memoryRequirements, MemoryPool::DeviceLocal, false, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
         for (uint32_t i = 0; i < count; i++)
         {
-            result = pLogicalDevice->vkd.BindImageMemory(pLogicalDevice->device, fakeImages[i], deviceMemory, memoryRequirements.size * i);
+            result = pLogicalDevice->vkd.BindImageMemory(
+                pLogicalDevice->device, fakeImages[i], deviceMemory.memory, deviceMemory.offset + imageSize * i);
             ASSERT_VULKAN(result);
         }
         return fakeImages;
     }
+
+    uint32_t fakeImageSetCount(uint32_t effectCount, bool lastEffectWritesSwapchain)
+    {
+        uint32_t intermediateSets = lastEffectWritesSwapchain && effectCount ? effectCount - 1 : effectCount;
+        return 1 + std::min(intermediateSets, 2u);
+    }
+
+    uint32_t fakeImageInputSet(uint32_t index)
+    {
+        return index ? fakeImageOutputSet(index - 1) : 0;
+    }
+
+    uint32_t fakeImageOutputSet(uint32_t index)
+    {
+        return 1 + index % 2;
+    }
 } // namespace vkBasalt
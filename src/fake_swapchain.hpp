@@ -16,7 +16,14 @@ namespace vkBasalt
     std::vector<VkImage> createFakeSwapchainImages(LogicalDevice*           pLogicalDevice,
                                                    VkSwapchainCreateInfoKHR swapchainCreateInfo,
                                                    uint32_t                 count,
-                                                   VkDeviceMemory&          deviceMemory);
-}
+                                                   MemoryAllocation&        deviceMemory);
+
+    // The effect chain needs the set of fake images the application renders to, and two more that the effects take turns
+    // writing to, no matter how many effects there are. Every set has one image per swapchain image.
+    uint32_t fakeImageSetCount(uint32_t effectCount, bool lastEffectWritesSwapchain);
+    // The set the effect at index reads from, 0 is the one the application renders to.
+    uint32_t fakeImageInputSet(uint32_t index);
+    uint32_t fakeImageOutputSet(uint32_t index);
+} // namespace vkBasalt
 
 #endif // FAKE_SWAPCHAIN_HPP_INCLUDED
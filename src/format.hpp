@@ -33,6 +33,9 @@ namespace vkBasalt
     bool isDepthFormat(VkFormat format);
 
     bool isStencilFormat(VkFormat format);
+
+    // Bytes per 4x4 block if format is one of the BCn formats, else 0
+    uint32_t getBlockSize(VkFormat format);
 } // namespace vkBasalt
 
 #endif // FORMAT_HPP_INCLUDED
@@ -2,6 +2,9 @@
 #include "memory.hpp"
 #include "buffer.hpp"
 #include "format.hpp"
+#include "upload_batch.hpp"
+
+#include <algorithm>
 
 namespace vkBasalt
 {
@@ -11,7 +14,7 @@ namespace vkBasalt
                                       VkFormat              format,
                                       VkImageUsageFlags     usage,
                                       VkMemoryPropertyFlags properties,
-                                      VkDeviceMemory&       imageMemory,
+                                      MemoryAllocation&     imageMemory,
                                       uint32_t              mipLevels)
     {
         std::vector<VkImage> images(count);
@@ -66,204 +69,304 @@ namespace vkBasalt
             memoryRequirements.size = (memoryRequirements.size / memoryRequirements.alignment + 1) * memoryRequirements.alignment;
         }
 
-        VkMemoryAllocateInfo memoryAllocateInfo;
-        memoryAllocateInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        memoryAllocateInfo.pNext           = nullptr;
-        memoryAllocateInfo.allocationSize  = memoryRequirements.size * count;
-        memoryAllocateInfo.memoryTypeIndex = findMemoryTypeIndex(pLogicalDevice, memoryRequirements.memoryTypeBits, properties);
-
-        result = pLogicalDevice->vkd.AllocateMemory(pLogicalDevice->device, &memoryAllocateInfo, nullptr, &imageMemory);
-        ASSERT_VULKAN(result);
+        VkDeviceSize imageSize  = memoryRequirements.size;
+        memoryRequirements.size = imageSize * count;
+        MemoryPool pool = (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) ? MemoryPool::HostVisible : MemoryPool::DeviceLocal;
+        imageMemory     = allocateMemory(pLogicalDevice, memoryRequirements, pool, false, properties);
 
         for (uint32_t i = 0; i < count; i++)
         {
-            result = pLogicalDevice->vkd.BindImageMemory(pLogicalDevice->device, images[i], imageMemory, memoryRequirements.size * i);
+            result = pLogicalDevice->vkd.BindImageMemory(pLogicalDevice->device, images[i], imageMemory.memory, imageMemory.offset + imageSize * i);
             ASSERT_VULKAN(result);
         }
         return images;
     }
 
-    void
-    uploadToImage(LogicalDevice* pLogicalDevice, VkImage image, VkExtent3D extent, uint32_t size, const unsigned char* writeData, uint32_t mipLevels)
+    namespace
     {
+        // Leaves the uploaded levels in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.
+        void recordImageUpload(LogicalDevice*       pLogicalDevice,
+                               UploadBatch&         batch,
+                               VkImage              image,
+                               VkExtent3D           extent,
+                               VkFormat             format,
+                               uint32_t             size,
+                               const unsigned char* writeData,
+                               uint32_t             uploadedLevels)
+        {
+            VkBuffer     stagingBuffer;
+            VkDeviceSize stagingOffset;
+            std::memcpy(batch.stage(size, stagingBuffer, stagingOffset), writeData, size);
+
+            VkCommandBuffer commandBuffer = batch.commandBuffer();
+
+            VkImageMemoryBarrier memoryBarrier;
+            memoryBarrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            memoryBarrier.pNext                           = nullptr;
+            memoryBarrier.srcAccessMask                   = 0;
+            memoryBarrier.dstAccessMask                   = VK_ACCESS_TRANSFER_WRITE_BIT;
+            memoryBarrier.oldLayout                       = VK_IMAGE_LAYOUT_UNDEFINED;
+            memoryBarrier.newLayout                       = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            memoryBarrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+            memoryBarrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+            memoryBarrier.image                           = image;
+            memoryBarrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+            memoryBarrier.subresourceRange.baseMipLevel   = 0;
+            memoryBarrier.subresourceRange.levelCount     = uploadedLevels;
+            memoryBarrier.subresourceRange.baseArrayLayer = 0;
+            memoryBarrier.subresourceRange.layerCount     = 1;
+
+            pLogicalDevice->vkd.CmdPipelineBarrier(
+                commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &memoryBarrier);
+
+            // Levels of block compressed formats consist of whole 4x4 blocks, the sizes of the levels are multiples of one
+            // unit, a texel or a block.
+            uint32_t                       blockExtent = getBlockSize(format) ? 4 : 1;
+            std::vector<VkBufferImageCopy> regions(uploadedLevels);
+            VkDeviceSize                   unitCount = 0;
+            for (uint32_t i = 0; i < uploadedLevels; i++)
+            {
+                regions[i].bufferOffset                    = unitCount;
+                regions[i].bufferRowLength                 = 0;
+                regions[i].bufferImageHeight               = 0;
+                regions[i].imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+                regions[i].imageSubresource.mipLevel       = i;
+                regions[i].imageSubresource.baseArrayLayer = 0;
+                regions[i].imageSubresource.layerCount     = 1;
+                regions[i].imageOffset                     = {0, 0, 0};
+                regions[i].imageExtent                     = {
+                    std::max(extent.width >> i, 1u), std::max(extent.height >> i, 1u), std::max(extent.depth >> i, 1u)};
+
+                unitCount += VkDeviceSize((regions[i].imageExtent.width + blockExtent - 1) / blockExtent)
+                             * ((regions[i].imageExtent.height + blockExtent - 1) / blockExtent) * regions[i].imageExtent.depth;
+            }
+            // Until now bufferOffset counted units.
+            VkDeviceSize unitSize = size / unitCount;
+            for (auto& region : regions)
+            {
+                region.bufferOffset = stagingOffset + region.bufferOffset * unitSize;
+            }
+
+            pLogicalDevice->vkd.CmdCopyBufferToImage(
+                commandBuffer, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, regions.size(), regions.data());
+
+            memoryBarrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            memoryBarrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
-        VkBuffer       stagingBuffer;
-        VkDeviceMemory stagingMemory;
-
-        createBuffer(pLogicalDevice,
-                     size,
-                     VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                     stagingBuffer,
-                     stagingMemory);
-        void*    data;
-        VkResult result = pLogicalDevice->vkd.MapMemory(pLogicalDevice->device, stagingMemory, 0, size, 0, &data);
-        ASSERT_VULKAN(result);
-        std::memcpy(data, writeData, size);
-        pLogicalDevice->vkd.UnmapMemory(pLogicalDevice->device, stagingMemory);
-
-        VkCommandBufferAllocateInfo allocInfo = {};
-
-        allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandPool        = pLogicalDevice->commandPool;
-        allocInfo.commandBufferCount = 1;
-
-        VkCommandBuffer commandBuffer;
-        pLogicalDevice->vkd.AllocateCommandBuffers(pLogicalDevice->device, &allocInfo, &commandBuffer);
-        // initialize dispatch table for commandBuffer since it is a dispatchable object
-        initializeDispatchTable(commandBuffer, pLogicalDevice->device);
-
-        VkCommandBufferBeginInfo beginInfo = {};
-
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-        pLogicalDevice->vkd.BeginCommandBuffer(commandBuffer, &beginInfo);
-
-        VkImageMemoryBarrier memoryBarrier;
-        memoryBarrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        memoryBarrier.pNext                           = nullptr;
-        memoryBarrier.srcAccessMask                   = 0;
-        memoryBarrier.dstAccessMask                   = VK_ACCESS_TRANSFER_WRITE_BIT;
-        memoryBarrier.oldLayout                       = VK_IMAGE_LAYOUT_UNDEFINED;
-        memoryBarrier.newLayout                       = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-        memoryBarrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
-        memoryBarrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
-        memoryBarrier.image                           = image;
-        memoryBarrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-        memoryBarrier.subresourceRange.baseMipLevel   = 0;
-        memoryBarrier.subresourceRange.levelCount     = 1;
-        memoryBarrier.subresourceRange.baseArrayLayer = 0;
-        memoryBarrier.subresourceRange.layerCount     = 1;
-
-        pLogicalDevice->vkd.CmdPipelineBarrier(
-            commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &memoryBarrier);
-
-        VkBufferImageCopy region;
-        region.bufferOffset                    = 0;
-        region.bufferRowLength                 = 0;
-        region.bufferImageHeight               = 0;
-        region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-        region.imageSubresource.mipLevel       = 0;
-        region.imageSubresource.baseArrayLayer = 0;
-        region.imageSubresource.layerCount     = 1;
-        region.imageOffset                     = {0, 0, 0};
-        region.imageExtent                     = extent;
-
-        pLogicalDevice->vkd.CmdCopyBufferToImage(commandBuffer, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-        memoryBarrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-        memoryBarrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-        pLogicalDevice->vkd.CmdPipelineBarrier(
-            commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &memoryBarrier);
-
-        generateMipMaps(pLogicalDevice, commandBuffer, image, extent, mipLevels);
-
-        pLogicalDevice->vkd.EndCommandBuffer(commandBuffer);
-
-        VkSubmitInfo submitInfo = {};
-
-        submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers    = &commandBuffer;
-
-        pLogicalDevice->vkd.QueueSubmit(pLogicalDevice->queue, 1, &submitInfo, VK_NULL_HANDLE);
-        pLogicalDevice->vkd.QueueWaitIdle(pLogicalDevice->queue);
-
-        pLogicalDevice->vkd.FreeCommandBuffers(pLogicalDevice->device, pLogicalDevice->commandPool, 1, &commandBuffer);
-        pLogicalDevice->vkd.FreeMemory(pLogicalDevice->device, stagingMemory, nullptr);
-        pLogicalDevice->vkd.DestroyBuffer(pLogicalDevice->device, stagingBuffer, nullptr);
+            pLogicalDevice->vkd.CmdPipelineBarrier(
+                commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &memoryBarrier);
+        }
+    } // namespace
+
+    void uploadToImage(LogicalDevice*       pLogicalDevice,
+                       VkImage              image,
+                       VkExtent3D           extent,
+                       VkFormat             format,
+                       uint32_t             size,
+                       const unsigned char* writeData,
+                       uint32_t             mipLevels,
+                       uint32_t             uploadedLevels)
+    {
+        recordUpload(pLogicalDevice, [&](UploadBatch& batch) {
+            recordImageUpload(pLogicalDevice, batch, image, extent, format, size, writeData, uploadedLevels);
+            generateMipMaps(pLogicalDevice, batch.commandBuffer(), image, extent, mipLevels, uploadedLevels);
+        });
     }
 
-    void changeImageLayout(LogicalDevice* pLogicalDevice, std::vector<VkImage> images, uint32_t mipLevels)
+    void uploadToImageResized(LogicalDevice*       pLogicalDevice,
+                              VkImage              image,
+                              VkExtent3D           extent,
+                              VkFormat             format,
+                              VkExtent3D           sourceExtent,
+                              uint32_t             size,
+                              const unsigned char* writeData,
+                              uint32_t             mipLevels)
     {
-        VkCommandBufferAllocateInfo allocInfo = {};
-
-        allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandPool        = pLogicalDevice->commandPool;
-        allocInfo.commandBufferCount = 1;
-
-        VkCommandBuffer commandBuffer;
-        pLogicalDevice->vkd.AllocateCommandBuffers(pLogicalDevice->device, &allocInfo, &commandBuffer);
-        // initialize dispatch table for commandBuffer since it is a dispatchable object
-        initializeDispatchTable(commandBuffer, pLogicalDevice->device);
-
-        VkCommandBufferBeginInfo beginInfo = {};
-
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-        pLogicalDevice->vkd.BeginCommandBuffer(commandBuffer, &beginInfo);
-
-        VkImageMemoryBarrier memoryBarrier;
-        memoryBarrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        memoryBarrier.pNext               = nullptr;
-        memoryBarrier.oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED;
-        memoryBarrier.newLayout           = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        memoryBarrier.srcAccessMask       = 0;
-        memoryBarrier.dstAccessMask       = VK_ACCESS_SHADER_READ_BIT;
-        memoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        memoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-
-        memoryBarrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-        memoryBarrier.subresourceRange.baseMipLevel   = 0;
-        memoryBarrier.subresourceRange.levelCount     = mipLevels;
-        memoryBarrier.subresourceRange.baseArrayLayer = 0;
-        memoryBarrier.subresourceRange.layerCount     = 1;
-
-        for (auto& image : images)
+        // A single linear blit only looks at 2x2 texels, halving first until the source is less than twice as large
+        // keeps big downscales from skipping most of the source.
+        uint32_t sourceLevels = 1;
+        while ((sourceExtent.width >> sourceLevels) >= extent.width && (sourceExtent.height >> sourceLevels) >= extent.height
+               && ((sourceExtent.width >> (sourceLevels - 1)) >= 2 * extent.width
+                   || (sourceExtent.height >> (sourceLevels - 1)) >= 2 * extent.height))
         {
-            memoryBarrier.image = image;
-            pLogicalDevice->vkd.CmdPipelineBarrier(
-                commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &memoryBarrier);
+            sourceLevels++;
         }
 
-        pLogicalDevice->vkd.EndCommandBuffer(commandBuffer);
+        recordUpload(pLogicalDevice, [&](UploadBatch& batch) {
+            MemoryAllocation sourceMemory;
+            VkImage          sourceImage = createImages(pLogicalDevice,
+                                                        1,
+                                                        sourceExtent,
+                                                        format,
+                                                        VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                                                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                        sourceMemory,
+                                                        sourceLevels)[0];
+            batch.destroyLater(sourceImage, sourceMemory);
+
+            VkCommandBuffer commandBuffer = batch.commandBuffer();
+            recordImageUpload(pLogicalDevice, batch, sourceImage, sourceExtent, format, size, writeData, 1);
+            generateMipMaps(pLogicalDevice, commandBuffer, sourceImage, sourceExtent, sourceLevels);
+
+            VkImageMemoryBarrier memoryBarriers[2];
+            for (auto& memoryBarrier : memoryBarriers)
+            {
+                memoryBarrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                memoryBarrier.pNext                           = nullptr;
+                memoryBarrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+                memoryBarrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+                memoryBarrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+                memoryBarrier.subresourceRange.levelCount     = 1;
+                memoryBarrier.subresourceRange.baseArrayLayer = 0;
+                memoryBarrier.subresourceRange.layerCount     = 1;
+            }
+            memoryBarriers[0].image                         = sourceImage;
+            memoryBarriers[0].subresourceRange.baseMipLevel = sourceLevels - 1;
+            memoryBarriers[0].oldLayout                     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            memoryBarriers[0].newLayout                     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            memoryBarriers[0].srcAccessMask                 = VK_ACCESS_TRANSFER_WRITE_BIT;
+            memoryBarriers[0].dstAccessMask                 = VK_ACCESS_TRANSFER_READ_BIT;
+
+            memoryBarriers[1].image                         = image;
+            memoryBarriers[1].subresourceRange.baseMipLevel = 0;
+            memoryBarriers[1].oldLayout                     = VK_IMAGE_LAYOUT_UNDEFINED;
+            memoryBarriers[1].newLayout                     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            memoryBarriers[1].srcAccessMask                 = 0;
+            memoryBarriers[1].dstAccessMask                 = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+            pLogicalDevice->vkd.CmdPipelineBarrier(
+                commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 2, memoryBarriers);
+
+            int32_t     blitWidth  = std::max(sourceExtent.width >> (sourceLevels - 1), 1u);
+            int32_t     blitHeight = std::max(sourceExtent.height >> (sourceLevels - 1), 1u);
+            VkImageBlit imageBlit;
+
+            imageBlit.srcSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+            imageBlit.srcSubresource.mipLevel       = sourceLevels - 1;
+            imageBlit.srcSubresource.baseArrayLayer = 0;
+            imageBlit.srcSubresource.layerCount     = 1;
+            imageBlit.srcOffsets[0]                 = {0, 0, 0};
+            imageBlit.srcOffsets[1]                 = {blitWidth, blitHeight, 1};
+
+            imageBlit.dstSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+            imageBlit.dstSubresource.mipLevel       = 0;
+            imageBlit.dstSubresource.baseArrayLayer = 0;
+            imageBlit.dstSubresource.layerCount     = 1;
+            imageBlit.dstOffsets[0]                 = {0, 0, 0};
+            imageBlit.dstOffsets[1]                 = {int32_t(extent.width), int32_t(extent.height), 1};
+
+            pLogicalDevice->vkd.CmdBlitImage(commandBuffer,
+                                             sourceImage,
+                                             VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                             image,
+                                             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                             1,
+                                             &imageBlit,
+                                             VK_FILTER_LINEAR);
+
+            memoryBarriers[1].oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            memoryBarriers[1].newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            memoryBarriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            memoryBarriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
-        VkSubmitInfo submitInfo       = {};
-        submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers    = &commandBuffer;
+            pLogicalDevice->vkd.CmdPipelineBarrier(
+                commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &memoryBarriers[1]);
 
-        pLogicalDevice->vkd.QueueSubmit(pLogicalDevice->queue, 1, &submitInfo, VK_NULL_HANDLE);
-        pLogicalDevice->vkd.QueueWaitIdle(pLogicalDevice->queue);
+            generateMipMaps(pLogicalDevice, commandBuffer, image, extent, mipLevels);
+        });
+    }
 
-        pLogicalDevice->vkd.FreeCommandBuffers(pLogicalDevice->device, pLogicalDevice->commandPool, 1, &commandBuffer);
+    void changeImageLayout(LogicalDevice* pLogicalDevice, std::vector<VkImage> images, uint32_t mipLevels)
+    {
+        recordUpload(pLogicalDevice, [&](UploadBatch& batch) {
+            VkImageMemoryBarrier memoryBarrier;
+            memoryBarrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            memoryBarrier.pNext               = nullptr;
+            memoryBarrier.oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED;
+            memoryBarrier.newLayout           = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            memoryBarrier.srcAccessMask       = 0;
+            memoryBarrier.dstAccessMask       = VK_ACCESS_SHADER_READ_BIT;
+            memoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            memoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+
+            memoryBarrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+            memoryBarrier.subresourceRange.baseMipLevel   = 0;
+            memoryBarrier.subresourceRange.levelCount     = mipLevels;
+            memoryBarrier.subresourceRange.baseArrayLayer = 0;
+            memoryBarrier.subresourceRange.layerCount     = 1;
+
+            for (auto& image : images)
+            {
+                memoryBarrier.image = image;
+                pLogicalDevice->vkd.CmdPipelineBarrier(batch.commandBuffer(),
+                                                       VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                                                       VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                                                       0,
+                                                       0,
+                                                       nullptr,
+                                                       0,
+                                                       nullptr,
+                                                       1,
+                                                       &memoryBarrier);
+            }
+        });
     }
 
-    void generateMipMaps(LogicalDevice* pLogicalDevice, VkCommandBuffer commandBuffer, VkImage image, VkExtent3D extent, uint32_t mipLevels)
+    void generateMipMaps(
+        LogicalDevice* pLogicalDevice, VkCommandBuffer commandBuffer, VkImage image, VkExtent3D extent, uint32_t mipLevels, uint32_t firstLevel)
     {
-        if (mipLevels < 2)
+        if (mipLevels <= firstLevel)
         {
             return;
         }
-        int32_t width  = extent.width;
-        int32_t height = extent.height;
-        int32_t depth  = extent.depth;
-
-        VkImageMemoryBarrier memoryBarrier;
-        memoryBarrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        memoryBarrier.pNext               = nullptr;
-        memoryBarrier.image               = image;
-        memoryBarrier.oldLayout           = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        memoryBarrier.newLayout           = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-        memoryBarrier.srcAccessMask       = 0;
-        memoryBarrier.dstAccessMask       = VK_ACCESS_TRANSFER_READ_BIT;
-        memoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        memoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-
-        memoryBarrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-        memoryBarrier.subresourceRange.baseMipLevel   = 0;
-        memoryBarrier.subresourceRange.levelCount     = 1;
-        memoryBarrier.subresourceRange.baseArrayLayer = 0;
-        memoryBarrier.subresourceRange.layerCount     = 1;
-
-        for (uint32_t i = 1; i < mipLevels; i++)
+        int32_t width  = std::max(extent.width >> (firstLevel - 1), 1u);
+        int32_t height = std::max(extent.height >> (firstLevel - 1), 1u);
+        int32_t depth  = std::max(extent.depth >> (firstLevel - 1), 1u);
+
+        VkImageMemoryBarrier memoryBarriers[2];
+        for (auto& memoryBarrier : memoryBarriers)
+        {
+            memoryBarrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            memoryBarrier.pNext               = nullptr;
+            memoryBarrier.image               = image;
+            memoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            memoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+
+            memoryBarrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+            memoryBarrier.subresourceRange.baseArrayLayer = 0;
+            memoryBarrier.subresourceRange.layerCount     = 1;
+        }
+
+        // The level before firstLevel got uploaded or rendered to, the others may still be read by earlier draws.
+        memoryBarriers[0].subresourceRange.baseMipLevel = firstLevel - 1;
+        memoryBarriers[0].subresourceRange.levelCount   = 1;
+        memoryBarriers[0].oldLayout                     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        memoryBarriers[0].newLayout                     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        memoryBarriers[0].srcAccessMask                 = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+        memoryBarriers[0].dstAccessMask                 = VK_ACCESS_TRANSFER_READ_BIT;
+
+        memoryBarriers[1].subresourceRange.baseMipLevel = firstLevel;
+        memoryBarriers[1].subresourceRange.levelCount   = mipLevels - firstLevel;
+        memoryBarriers[1].oldLayout                     = VK_IMAGE_LAYOUT_UNDEFINED;
+        memoryBarriers[1].newLayout                     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        memoryBarriers[1].srcAccessMask                 = 0;
+        memoryBarriers[1].dstAccessMask                 = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+        pLogicalDevice->vkd.CmdPipelineBarrier(commandBuffer,
+                                               VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
+                                                   | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                               VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                               0,
+                                               0,
+                                               nullptr,
+                                               0,
+                                               nullptr,
+                                               2,
+                                               memoryBarriers);
+
+        for (uint32_t i = firstLevel; i < mipLevels; i++)
         {
             VkImageBlit imageBlit;
 
@@ -285,26 +388,6 @@ namespace vkBasalt
             imageBlit.dstOffsets[0]                 = {0, 0, 0};
             imageBlit.dstOffsets[1]                 = {width, height, depth};
 
-            memoryBarrier.subresourceRange.baseMipLevel = i - 1;
-
-            memoryBarrier.oldLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            memoryBarrier.newLayout     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-            memoryBarrier.srcAccessMask = 0;
-            memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
-            pLogicalDevice->vkd.CmdPipelineBarrier(
-                commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &memoryBarrier);
-
-            memoryBarrier.subresourceRange.baseMipLevel = i;
-
-            memoryBarrier.oldLayout     = VK_IMAGE_LAYOUT_UNDEFINED;
-            memoryBarrier.newLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-            memoryBarrier.srcAccessMask = 0;
-            memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-            pLogicalDevice->vkd.CmdPipelineBarrier(
-                commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &memoryBarrier);
-
             pLogicalDevice->vkd.CmdBlitImage(commandBuffer,
                                              image,
                                              VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
@@ -314,25 +397,52 @@ namespace vkBasalt
                                              &imageBlit,
                                              VK_FILTER_LINEAR);
 
-            memoryBarrier.subresourceRange.baseMipLevel = i - 1;
-
-            memoryBarrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-            memoryBarrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-            memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-            pLogicalDevice->vkd.CmdPipelineBarrier(
-                commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &memoryBarrier);
-
-            memoryBarrier.subresourceRange.baseMipLevel = i;
-
-            memoryBarrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-            memoryBarrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-            memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-            pLogicalDevice->vkd.CmdPipelineBarrier(
-                commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &memoryBarrier);
+            if (i + 1 < mipLevels)
+            {
+                // The next blit reads the level this one wrote.
+                memoryBarriers[0].subresourceRange.baseMipLevel = i;
+                memoryBarriers[0].oldLayout                     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+                memoryBarriers[0].newLayout                     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+                memoryBarriers[0].srcAccessMask                 = VK_ACCESS_TRANSFER_WRITE_BIT;
+                memoryBarriers[0].dstAccessMask                 = VK_ACCESS_TRANSFER_READ_BIT;
+
+                pLogicalDevice->vkd.CmdPipelineBarrier(commandBuffer,
+                                                       VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                                       VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                                       0,
+                                                       0,
+                                                       nullptr,
+                                                       0,
+                                                       nullptr,
+                                                       1,
+                                                       &memoryBarriers[0]);
+            }
         }
+
+        // Every level but the last got read by a blit, the last one only written.
+        memoryBarriers[0].subresourceRange.baseMipLevel = firstLevel - 1;
+        memoryBarriers[0].subresourceRange.levelCount   = mipLevels - firstLevel;
+        memoryBarriers[0].oldLayout                     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        memoryBarriers[0].newLayout                     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        memoryBarriers[0].srcAccessMask                 = 0;
+        memoryBarriers[0].dstAccessMask                 = VK_ACCESS_SHADER_READ_BIT;
+
+        memoryBarriers[1].subresourceRange.baseMipLevel = mipLevels - 1;
+        memoryBarriers[1].subresourceRange.levelCount   = 1;
+        memoryBarriers[1].oldLayout                     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        memoryBarriers[1].newLayout                     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        memoryBarriers[1].srcAccessMask                 = VK_ACCESS_TRANSFER_WRITE_BIT;
+        memoryBarriers[1].dstAccessMask                 = VK_ACCESS_SHADER_READ_BIT;
+
+        pLogicalDevice->vkd.CmdPipelineBarrier(commandBuffer,
+                                               VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                               VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                                               0,
+                                               0,
+                                               nullptr,
+                                               0,
+                                               nullptr,
+                                               2,
+                                               memoryBarriers);
     }
 } // namespace vkBasalt
@@ -20,15 +20,42 @@ namespace vkBasalt
                                       VkFormat              format,
                                       VkImageUsageFlags     usage,
                                       VkMemoryPropertyFlags properties,
-                                      VkDeviceMemory&       imageMemory,
+                                      MemoryAllocation&     imageMemory,
                                       uint32_t              mipLevels = 1);
 
-    void uploadToImage(
-        LogicalDevice* pLogicalDevice, VkImage image, VkExtent3D extent, uint32_t size, const unsigned char* writeData, uint32_t mipLevels = 1);
+    // Both record into the UploadBatch of the calling thread if it has one, see upload_batch.hpp.
+    // writeData holds the first uploadedLevels mip levels tightly packed one after another, the other levels get generated with blits.
+    // format only matters for the layout of several levels, it tells block compressed formats apart.
+    void uploadToImage(LogicalDevice*       pLogicalDevice,
+                       VkImage              image,
+                       VkExtent3D           extent,
+                       VkFormat             format,
+                       uint32_t             size,
+                       const unsigned char* writeData,
+                       uint32_t             mipLevels      = 1,
+                       uint32_t             uploadedLevels = 1);
+
+    // Uploads writeData of sourceExtent into a temporary image and blits it to extent on the GPU, instead of resizing it
+    // on the CPU first. The other mip levels get generated with blits as well.
+    void uploadToImageResized(LogicalDevice*       pLogicalDevice,
+                              VkImage              image,
+                              VkExtent3D           extent,
+                              VkFormat             format,
+                              VkExtent3D           sourceExtent,
+                              uint32_t             size,
+                              const unsigned char* writeData,
+                              uint32_t             mipLevels = 1);
 
     void changeImageLayout(LogicalDevice* pLogicalDevice, std::vector<VkImage> images, uint32_t mipLevels = 1);
 
-    void generateMipMaps(LogicalDevice* pLogicalDevice, VkCommandBuffer commandBuffer, VkImage image, VkExtent3D extent, uint32_t mipLevels);
+    // Blits every level from firstLevel on from the one before it, the levels before firstLevel have to be in SHADER_READ_ONLY_OPTIMAL.
+    // Leaves every level in SHADER_READ_ONLY_OPTIMAL, ready for fragment shaders.
+    void generateMipMaps(LogicalDevice*  pLogicalDevice,
+                         VkCommandBuffer commandBuffer,
+                         VkImage         image,
+                         VkExtent3D      extent,
+                         uint32_t        mipLevels,
+                         uint32_t        firstLevel = 1);
 } // namespace vkBasalt
 
 #endif // IMAGE_HPP_INCLUDED
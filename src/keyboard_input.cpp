@@ -21,10 +21,26 @@ namespace vkBasalt
         return 0u;
     }
 
+    uint32_t convertVirtualKeyToKeySym(uint32_t virtualKey)
+    {
+#if VKBASALT_X11
+        return convertVirtualKeyToKeySymX11(virtualKey);
+#endif
+        return 0u;
+    }
+
     bool isKeyPressed(uint32_t ks)
     {
 #if VKBASALT_X11
         return isKeyPressedX11(ks);
+#endif
+        return false;
+    }
+
+    bool isMouseButtonPressed(uint32_t button)
+    {
+#if VKBASALT_X11
+        return isMouseButtonPressedX11(button);
 #endif
         return false;
     }
@@ -6,5 +6,10 @@
 namespace vkBasalt
 {
     uint32_t convertToKeySym(std::string key);
-    bool     isKeyPressed(uint32_t ks);
+    // Windows virtual key code, as used by the keycode annotation of ReShade uniforms.
+    uint32_t convertVirtualKeyToKeySym(uint32_t virtualKey);
+    // Both read a snapshot kept up to date by an input thread, they never wait for the display server.
+    bool isKeyPressed(uint32_t ks);
+    // 0 is the left, 1 the right and 2 the middle button.
+    bool isMouseButtonPressed(uint32_t button);
 } // namespace vkBasalt
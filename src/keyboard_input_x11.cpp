@@ -5,14 +5,191 @@
 #include <X11/Xlib.h>
 #include <X11/keysym.h>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <memory>
-#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 
 #include <unistd.h>
 #include <cstring>
 
 namespace vkBasalt
 {
+    namespace
+    {
+        // Owns the connection to the X server and polls it on its own thread, so that presenting a frame never waits for a
+        // round trip. Readers load the last snapshot and ask for a new one once it is pollInterval old, so the server only
+        // gets polled while something reads, at most once per read. The thread exits after idleTimeout without reads and
+        // gets started again by the next one.
+        class InputThread
+        {
+        public:
+            static InputThread* get()
+            {
+                static int                          usesX11 = -1;
+                static std::unique_ptr<InputThread> inputThread;
+                static std::mutex                   initMutex;
+
+                std::lock_guard<std::mutex> lock(initMutex);
+                if (usesX11 < 0)
+                {
+                    const char* disVar  = getenv("DISPLAY");
+                    Display*    display = (disVar && std::strcmp(disVar, "")) ? XOpenDisplay(disVar) : nullptr;
+                    if (!display)
+                    {
+                        usesX11 = 0;
+                        Logger::debug("no X11 support");
+                    }
+                    else
+                    {
+                        inputThread.reset(new InputThread(display));
+                        usesX11 = 1;
+                        Logger::debug("X11 support");
+                    }
+                }
+                return inputThread.get();
+            }
+
+            bool isKeyCodePressed(KeyCode kc)
+            {
+                requestPoll();
+                return (keymap[kc >> 6].load(std::memory_order_relaxed) >> (kc & 63)) & 1;
+            }
+
+            bool isButtonPressed(unsigned int buttonMask)
+            {
+                requestPoll();
+                return buttons.load(std::memory_order_relaxed) & buttonMask;
+            }
+
+            // XKeysymToKeycode only needs the server for the first lookup, it still has to share the display with the poller.
+            KeyCode keyCode(uint32_t ks)
+            {
+                std::lock_guard<std::mutex> lock(keyCodesMutex);
+                auto                        keyCode = keyCodes.find(ks);
+                if (keyCode == keyCodes.end())
+                {
+                    std::lock_guard<std::mutex> displayLock(displayMutex);
+                    keyCode = keyCodes.emplace(ks, XKeysymToKeycode(display, (KeySym) ks)).first;
+                }
+                return keyCode->second;
+            }
+
+            ~InputThread()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(pollMutex);
+                    stop = true;
+                }
+                pollCondition.notify_one();
+                if (thread.joinable())
+                {
+                    thread.join();
+                }
+                XCloseDisplay(display);
+            }
+
+        private:
+            // Fast enough that no key press gets lost, while costing nothing noticeable.
+            static constexpr std::chrono::milliseconds pollInterval{4};
+            static constexpr std::chrono::seconds      idleTimeout{1};
+
+            Display*                              display;
+            std::mutex                            displayMutex;
+            std::atomic<uint64_t>                 keymap[4] = {};
+            std::atomic<unsigned int>             buttons   = 0;
+            std::mutex                            keyCodesMutex;
+            std::unordered_map<uint32_t, KeyCode> keyCodes;
+            // steady_clock time of the last poll in nanoseconds.
+            std::atomic<int64_t>                  lastPoll = 0;
+            std::mutex                            pollMutex;
+            std::condition_variable               pollCondition;
+            bool                                  pollRequested = false;
+            bool                                  threadRunning = false;
+            bool                                  stop          = false;
+            std::thread                           thread;
+
+            // The first snapshot is taken right away, so that the first read already sees keys held down.
+            InputThread(Display* display) : display(display)
+            {
+                poll();
+            }
+
+            static int64_t now()
+            {
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            }
+
+            void requestPoll()
+            {
+                if (now() - lastPoll.load(std::memory_order_relaxed) < std::chrono::nanoseconds(pollInterval).count())
+                {
+                    return;
+                }
+                {
+                    std::lock_guard<std::mutex> lock(pollMutex);
+                    pollRequested = true;
+                    if (!threadRunning)
+                    {
+                        // An idle thread has already left its loop when it cleared threadRunning.
+                        if (thread.joinable())
+                        {
+                            thread.join();
+                        }
+                        threadRunning = true;
+                        thread        = std::thread([this]() { pollWhileRead(); });
+                    }
+                }
+                pollCondition.notify_one();
+            }
+
+            void pollWhileRead()
+            {
+                std::unique_lock<std::mutex> lock(pollMutex);
+                while (true)
+                {
+                    if (!pollCondition.wait_for(lock, idleTimeout, [this]() { return stop || pollRequested; }))
+                    {
+                        threadRunning = false;
+                        return;
+                    }
+                    if (stop)
+                    {
+                        return;
+                    }
+                    pollRequested = false;
+                    lock.unlock();
+                    poll();
+                    lock.lock();
+                }
+            }
+
+            void poll()
+            {
+                char         keys_return[32];
+                Window       root, child;
+                int          rootX, rootY, windowX, windowY;
+                unsigned int mask = 0;
+                {
+                    std::lock_guard<std::mutex> lock(displayMutex);
+                    XQueryKeymap(display, keys_return);
+                    XQueryPointer(display, DefaultRootWindow(display), &root, &child, &rootX, &rootY, &windowX, &windowY, &mask);
+                }
+                for (uint32_t i = 0; i < 4; i++)
+                {
+                    uint64_t bits;
+                    std::memcpy(&bits, keys_return + i * 8, sizeof(bits));
+                    keymap[i].store(bits, std::memory_order_relaxed);
+                }
+                buttons.store(mask, std::memory_order_relaxed);
+                lastPoll.store(now(), std::memory_order_relaxed);
+            }
+        };
+    } // namespace
+
     uint32_t convertToKeySymX11(std::string key)
     {
         // TODO what if X11 isn't loaded?
@@ -24,40 +201,90 @@ namespace vkBasalt
         return result;
     }
 
-    bool isKeyPressedX11(uint32_t ks)
+    uint32_t convertVirtualKeyToKeySymX11(uint32_t virtualKey)
     {
-        static int usesX11 = -1;
-
-        static std::unique_ptr<Display, std::function<void(Display*)>> display;
-
-        if (usesX11 < 0)
+        // Windows virtual key codes, which is what ReShade shaders use.
+        if (virtualKey >= '0' && virtualKey <= '9')
         {
-            const char* disVar = getenv("DISPLAY");
-            if (!disVar || !std::strcmp(disVar, ""))
-            {
-                usesX11 = 0;
-                Logger::debug("no X11 support");
-            }
-            else
-            {
-                display = std::unique_ptr<Display, std::function<void(Display*)>>(XOpenDisplay(disVar), [](Display* d) { XCloseDisplay(d); });
-                usesX11 = 1;
-                Logger::debug("X11 support");
-            }
+            return XK_0 + (virtualKey - '0');
+        }
+        if (virtualKey >= 'A' && virtualKey <= 'Z')
+        {
+            return XK_a + (virtualKey - 'A');
+        }
+        if (virtualKey >= 0x60 && virtualKey <= 0x69)
+        {
+            return XK_KP_0 + (virtualKey - 0x60);
+        }
+        if (virtualKey >= 0x70 && virtualKey <= 0x87)
+        {
+            return XK_F1 + (virtualKey - 0x70);
         }
+        switch (virtualKey)
+        {
+            case 0x08: return XK_BackSpace;
+            case 0x09: return XK_Tab;
+            case 0x0D: return XK_Return;
+            case 0x10: return XK_Shift_L;
+            case 0x11: return XK_Control_L;
+            case 0x12: return XK_Alt_L;
+            case 0x13: return XK_Pause;
+            case 0x14: return XK_Caps_Lock;
+            case 0x1B: return XK_Escape;
+            case 0x20: return XK_space;
+            case 0x21: return XK_Page_Up;
+            case 0x22: return XK_Page_Down;
+            case 0x23: return XK_End;
+            case 0x24: return XK_Home;
+            case 0x25: return XK_Left;
+            case 0x26: return XK_Up;
+            case 0x27: return XK_Right;
+            case 0x28: return XK_Down;
+            case 0x2C: return XK_Print;
+            case 0x2D: return XK_Insert;
+            case 0x2E: return XK_Delete;
+            case 0x6A: return XK_KP_Multiply;
+            case 0x6B: return XK_KP_Add;
+            case 0x6D: return XK_KP_Subtract;
+            case 0x6E: return XK_KP_Decimal;
+            case 0x6F: return XK_KP_Divide;
+            case 0x90: return XK_Num_Lock;
+            case 0x91: return XK_Scroll_Lock;
+            case 0xA0: return XK_Shift_L;
+            case 0xA1: return XK_Shift_R;
+            case 0xA2: return XK_Control_L;
+            case 0xA3: return XK_Control_R;
+            case 0xA4: return XK_Alt_L;
+            case 0xA5: return XK_Alt_R;
+            default: return 0;
+        }
+    }
 
-        if (!usesX11)
+    bool isKeyPressedX11(uint32_t ks)
+    {
+        InputThread* inputThread = InputThread::get();
+        if (!inputThread || !ks)
         {
             return false;
         }
+        return inputThread->isKeyCodePressed(inputThread->keyCode(ks));
+    }
 
-        char keys_return[32];
-
-        XQueryKeymap(display.get(), keys_return);
-
-        KeyCode kc2 = XKeysymToKeycode(display.get(), (KeySym) ks);
-
-        return !!(keys_return[kc2 >> 3] & (1 << (kc2 & 7)));
+    bool isMouseButtonPressedX11(uint32_t button)
+    {
+        InputThread* inputThread = InputThread::get();
+        if (!inputThread)
+        {
+            return false;
+        }
+        // ReShade counts left, right, middle, the X server left, middle, right.
+        switch (button)
+        {
+            case 0: return inputThread->isButtonPressed(Button1Mask);
+            case 1: return inputThread->isButtonPressed(Button3Mask);
+            case 2: return inputThread->isButtonPressed(Button2Mask);
+            default: return false;
+        }
     }
 
 } // namespace vkBasalt
@@ -6,5 +6,7 @@
 namespace vkBasalt
 {
     uint32_t convertToKeySymX11(std::string key);
+    uint32_t convertVirtualKeyToKeySymX11(uint32_t virtualKey);
     bool     isKeyPressedX11(uint32_t ks);
+    bool     isMouseButtonPressedX11(uint32_t button);
 } // namespace vkBasalt
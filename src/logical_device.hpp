@@ -5,9 +5,13 @@
 #include <string>
 #include <iostream>
 #include <vector>
+#include <mutex>
+#include <atomic>
 
 #include "vulkan_include.hpp"
 
+#include "memory_allocator.hpp"
+
 namespace vkBasalt
 {
     struct LogicalDevice
@@ -21,9 +25,27 @@ namespace vkBasalt
         uint32_t                     queueFamilyIndex;
         VkCommandPool                commandPool;
         bool                         supportsMutableFormat;
+        bool                         supportsStorage16Bit;
+        bool                         supportsTextureCompressionBC;
         std::vector<VkImage>         depthImages;
         std::vector<VkFormat>        depthFormats;
         std::vector<VkImageView>     depthImageViews;
+        // Used for every pipeline the layer creates, see pipeline_cache.hpp.
+        VkPipelineCache              pipelineCache = VK_NULL_HANDLE;
+        std::string                  pipelineCachePath;
+        std::atomic<size_t>          pipelineCacheSavedSize = 0;
+        // Memory of everything the layer creates on the device, see memory.hpp.
+        MemoryAllocator              memoryAllocator;
+        // Guards the depth images and the swapchains of the device, lookups of the device itself don't lock.
+        std::mutex lock;
+        // vkQueueSubmit2 and vkQueueSubmit2KHR of the next layer, the dispatch table predates them. Null if the device has none.
+        // Their VkSubmitInfo2 is only passed through, so they are declared with an opaque pointer.
+        using PFN_QueueSubmit2 = VkResult(VKAPI_PTR*)(VkQueue queue, uint32_t submitCount, const void* pSubmits, VkFence fence);
+        PFN_QueueSubmit2             queueSubmit2    = nullptr;
+        PFN_QueueSubmit2             queueSubmit2KHR = nullptr;
+        // Guards queue and commandPool, effects get built on their own thread while the application keeps presenting.
+        // Taken after lock if both are needed, never wait for lock while holding it.
+        std::mutex queueLock;
     };
 } // namespace vkBasalt
 
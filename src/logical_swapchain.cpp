@@ -1,26 +1,54 @@
 #include "logical_swapchain.hpp"
 
+#include "memory.hpp"
+
 namespace vkBasalt
 {
+    void LogicalSwapchain::stopEffectsThread()
+    {
+        if (effectsThread.joinable())
+        {
+            cancelEffects = true;
+            effectsThread.join();
+        }
+    }
+
+    void LogicalSwapchain::handOverEffects(LogicalSwapchain* pSwapchain, uint32_t swapchainImageCount)
+    {
+        if (!effectsReady || pSwapchain->format != format || pSwapchain->imageExtent.width != imageExtent.width
+            || pSwapchain->imageExtent.height != imageExtent.height || swapchainImageCount != imageCount)
+        {
+            return;
+        }
+        Logger::debug("reusing the effects of the old swapchain");
+        // commandBuffersEffect still reference the effects, they get freed with the swapchain once the GPU is done.
+        effectsReady                = false;
+        pSwapchain->reusableEffects = std::move(effects);
+        effects.clear();
+    }
+
     void LogicalSwapchain::destroy()
     {
         if (imageCount > 0)
         {
             effects.clear();
+            reusableEffects.clear();
             defaultTransfer.reset();
+            profiler.reset();
+            uploads.reset();
 
+            std::lock_guard<std::mutex> lock(pLogicalDevice->queueLock);
             pLogicalDevice->vkd.FreeCommandBuffers(
                 pLogicalDevice->device, pLogicalDevice->commandPool, commandBuffersEffect.size(), commandBuffersEffect.data());
             pLogicalDevice->vkd.FreeCommandBuffers(
                 pLogicalDevice->device, pLogicalDevice->commandPool, commandBuffersNoEffect.size(), commandBuffersNoEffect.data());
             Logger::debug("after free commandbuffer");
 
-            pLogicalDevice->vkd.FreeMemory(pLogicalDevice->device, fakeImageMemory, nullptr);
-
             for (uint32_t i = 0; i < fakeImages.size(); i++)
             {
                 pLogicalDevice->vkd.DestroyImage(pLogicalDevice->device, fakeImages[i], nullptr);
             }
+            freeMemory(pLogicalDevice, fakeImageMemory);
 
             for (unsigned int i = 0; i < imageCount; i++)
             {
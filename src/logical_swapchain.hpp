@@ -6,12 +6,16 @@
 #include <iostream>
 #include <vector>
 #include <memory>
+#include <atomic>
+#include <thread>
 
 #include "effect.hpp"
 
 #include "vulkan_include.hpp"
 
 #include "logical_device.hpp"
+#include "profiler.hpp"
+#include "upload_batch.hpp"
 
 namespace vkBasalt
 {
@@ -29,9 +33,24 @@ namespace vkBasalt
         std::vector<VkCommandBuffer>         commandBuffersNoEffect;
         std::vector<VkSemaphore>             semaphores;
         std::vector<std::shared_ptr<Effect>> effects;
+        // Effects of the swapchain this one replaced, effectsThread rebinds them to the new images instead of creating them again.
+        std::vector<std::shared_ptr<Effect>> reusableEffects;
         std::shared_ptr<Effect>              defaultTransfer;
-        VkDeviceMemory                       fakeImageMemory;
+        MemoryAllocation                     fakeImageMemory;
+        // Only with VKBASALT_PROFILE=1, times commandBuffersEffect.
+        std::unique_ptr<Profiler>            profiler;
+        // Textures and buffers of effects, the first frame with effects waits for them on the GPU.
+        std::unique_ptr<UploadBatch>         uploads;
+        // Builds effects and commandBuffersEffect, until effectsReady the swapchain presents with commandBuffersNoEffect.
+        std::thread                          effectsThread;
+        std::atomic<bool>                    effectsReady  = false;
+        std::atomic<bool>                    cancelEffects = false;
 
+        // Must not be called with pLogicalDevice->lock held, the thread takes it to publish the effects.
+        void stopEffectsThread();
+        // Needs pLogicalDevice->lock. Moves finished effects to pSwapchain if it has the same extent, format and image count,
+        // this swapchain presents without effects afterwards.
+        void handOverEffects(LogicalSwapchain* pSwapchain, uint32_t swapchainImageCount);
         void destroy();
     };
 } // namespace vkBasalt
@@ -2,10 +2,21 @@
 
 namespace vkBasalt
 {
-    uint32_t findMemoryTypeIndex(LogicalDevice* pLogicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties)
+    std::optional<uint32_t> findMemoryTypeIndex(LogicalDevice*        pLogicalDevice,
+                                                uint32_t              typeFilter,
+                                                VkMemoryPropertyFlags properties,
+                                                VkMemoryPropertyFlags preferredProperties)
     {
         VkPhysicalDeviceMemoryProperties physicalDeviceMemoryProperties;
         pLogicalDevice->vki.GetPhysicalDeviceMemoryProperties(pLogicalDevice->physicalDevice, &physicalDeviceMemoryProperties);
+        VkMemoryPropertyFlags allProperties = properties | preferredProperties;
+        for (uint32_t i = 0; allProperties != properties && i < physicalDeviceMemoryProperties.memoryTypeCount; i++)
+        {
+            if ((typeFilter & (1u << i)) && (physicalDeviceMemoryProperties.memoryTypes[i].propertyFlags & allProperties) == allProperties)
+            {
+                return i;
+            }
+        }
         for (uint32_t i = 0; i < physicalDeviceMemoryProperties.memoryTypeCount; i++)
         {
             if ((typeFilter & (1u << i)) && (physicalDeviceMemoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
@@ -15,6 +26,27 @@ namespace vkBasalt
         }
 
         Logger::err("Found no correct memory type");
-        return 0x70AD;
+        return std::nullopt;
+    }
+
+    MemoryAllocation allocateMemory(LogicalDevice*              pLogicalDevice,
+                                    const VkMemoryRequirements& requirements,
+                                    MemoryPool                  pool,
+                                    bool                        linear,
+                                    VkMemoryPropertyFlags       properties,
+                                    VkMemoryPropertyFlags       preferredProperties)
+    {
+        std::optional<uint32_t> memoryTypeIndex = findMemoryTypeIndex(pLogicalDevice, requirements.memoryTypeBits, properties, preferredProperties);
+        if (!memoryTypeIndex)
+        {
+            return {};
+        }
+        return pLogicalDevice->memoryAllocator.allocate(pLogicalDevice, requirements, pool, linear, *memoryTypeIndex);
+    }
+
+    void freeMemory(LogicalDevice* pLogicalDevice, MemoryAllocation& allocation)
+    {
+        pLogicalDevice->memoryAllocator.free(pLogicalDevice, allocation);
+        allocation = {};
     }
 } // namespace vkBasalt
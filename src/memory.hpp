@@ -6,6 +6,7 @@
 #include <iostream>
 #include <vector>
 #include <memory>
+#include <optional>
 
 #include "vulkan_include.hpp"
 
@@ -13,7 +14,23 @@
 
 namespace vkBasalt
 {
-    uint32_t findMemoryTypeIndex(LogicalDevice* pLogicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties);
-}
+    // Types that also have preferredProperties come first, if there are any.
+    std::optional<uint32_t> findMemoryTypeIndex(LogicalDevice*        pLogicalDevice,
+                                                uint32_t              typeFilter,
+                                                VkMemoryPropertyFlags properties,
+                                                VkMemoryPropertyFlags preferredProperties = 0);
+
+    // Memory from pLogicalDevice->memoryAllocator, bind the resource at allocation.offset. The returned allocation has
+    // no memory if there is no fitting memory type or the device is out of memory.
+    MemoryAllocation allocateMemory(LogicalDevice*              pLogicalDevice,
+                                    const VkMemoryRequirements& requirements,
+                                    MemoryPool                  pool,
+                                    bool                        linear,
+                                    VkMemoryPropertyFlags       properties,
+                                    VkMemoryPropertyFlags       preferredProperties = 0);
+
+    // Resets allocation, does nothing if it has no memory.
+    void freeMemory(LogicalDevice* pLogicalDevice, MemoryAllocation& allocation);
+} // namespace vkBasalt
 
 #endif // MEMORY_HPP_INCLUDED
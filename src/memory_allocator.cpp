@@ -0,0 +1,276 @@
+#include "memory_allocator.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+#include "logical_device.hpp"
+#include "logger.hpp"
+
+namespace vkBasalt
+{
+    namespace
+    {
+        constexpr VkDeviceSize mebibyte = 1024 * 1024;
+
+        const char* poolName(MemoryPool pool)
+        {
+            switch (pool)
+            {
+                case MemoryPool::DeviceLocal: return "device local";
+                case MemoryPool::HostVisible: return "host visible";
+                case MemoryPool::Staging: return "staging";
+                default: return "unknown";
+            }
+        }
+
+        std::string toMebibytes(VkDeviceSize size)
+        {
+            char text[32];
+            std::snprintf(text, sizeof(text), "%.1f MiB", double(size) / mebibyte);
+            return text;
+        }
+    } // namespace
+
+    MemoryAllocation MemoryAllocator::allocate(LogicalDevice*              pLogicalDevice,
+                                               const VkMemoryRequirements& requirements,
+                                               MemoryPool                  pool,
+                                               bool                        linear,
+                                               uint32_t                    memoryTypeIndex)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        initialize(pLogicalDevice);
+
+        VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+        Block*       pBlock    = nullptr;
+        VkDeviceSize offset    = 0;
+        for (auto& block : blocks)
+        {
+            if (!block->dedicated && block->pool == pool && block->linear == linear && block->memoryTypeIndex == memoryTypeIndex
+                && place(block.get(), requirements.size, alignment, offset))
+            {
+                pBlock = block.get();
+                break;
+            }
+        }
+
+        if (!pBlock)
+        {
+            // Large resources like the fake swapchain images at high resolutions would mostly waste a shared block.
+            VkDeviceSize size      = blockSize(pool, memoryTypeIndex);
+            bool         dedicated = requirements.size > size / 2;
+            pBlock                 = createBlock(pLogicalDevice, pool, linear, memoryTypeIndex, dedicated ? requirements.size : size);
+            if (!pBlock)
+            {
+                return {};
+            }
+            pBlock->dedicated = dedicated;
+            place(pBlock, requirements.size, alignment, offset);
+        }
+
+        pBlock->usedSize += requirements.size;
+        pBlock->allocationCount++;
+
+        MemoryAllocation allocation;
+        allocation.memory = pBlock->memory;
+        allocation.offset = offset;
+        allocation.size   = requirements.size;
+        allocation.mapped = pBlock->mapped ? pBlock->mapped + offset : nullptr;
+        return allocation;
+    }
+
+    void MemoryAllocator::free(LogicalDevice* pLogicalDevice, const MemoryAllocation& allocation)
+    {
+        if (allocation.memory == VK_NULL_HANDLE)
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto entry = blocksByMemory.find(allocation.memory);
+        if (entry == blocksByMemory.end())
+        {
+            Logger::err("freeing memory that wasn't allocated by the memory allocator");
+            return;
+        }
+        Block* pBlock = entry->second;
+        pBlock->usedSize -= allocation.size;
+        pBlock->allocationCount--;
+
+        auto next  = pBlock->freeRanges.lower_bound(allocation.offset);
+        auto range = pBlock->freeRanges.emplace_hint(next, allocation.offset, allocation.size);
+        if (next != pBlock->freeRanges.end() && range->first + range->second == next->first)
+        {
+            range->second += next->second;
+            pBlock->freeRanges.erase(next);
+        }
+        if (range != pBlock->freeRanges.begin())
+        {
+            auto previous = std::prev(range);
+            if (previous->first + previous->second == range->first)
+            {
+                previous->second += range->second;
+                pBlock->freeRanges.erase(range);
+            }
+        }
+
+        if (pBlock->allocationCount)
+        {
+            return;
+        }
+        // Keep one empty block of every kind around, so that a burst of staging buffers or a recreated swapchain
+        // doesn't allocate and free a block every time.
+        bool otherEmptyBlock = std::any_of(blocks.begin(), blocks.end(), [pBlock](const std::unique_ptr<Block>& block) {
+            return block.get() != pBlock && !block->dedicated && !block->allocationCount && block->pool == pBlock->pool
+                   && block->linear == pBlock->linear && block->memoryTypeIndex == pBlock->memoryTypeIndex;
+        });
+        if (pBlock->dedicated || otherEmptyBlock)
+        {
+            destroyBlock(pLogicalDevice, pBlock);
+        }
+    }
+
+    void MemoryAllocator::logStatistics()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (MemoryPool pool : {MemoryPool::DeviceLocal, MemoryPool::HostVisible, MemoryPool::Staging})
+        {
+            uint32_t     blockCount = 0, dedicatedCount = 0, allocationCount = 0;
+            VkDeviceSize size = 0, usedSize = 0;
+            for (auto& block : blocks)
+            {
+                if (block->pool == pool)
+                {
+                    blockCount++;
+                    dedicatedCount += block->dedicated;
+                    allocationCount += block->allocationCount;
+                    size += block->size;
+                    usedSize += block->usedSize;
+                }
+            }
+            Logger::info(std::string("memory ") + poolName(pool) + ": " + std::to_string(allocationCount) + " allocations using "
+                         + toMebibytes(usedSize) + " of " + toMebibytes(size) + " in " + std::to_string(blockCount) + " blocks, "
+                         + std::to_string(dedicatedCount) + " of them dedicated");
+        }
+    }
+
+    void MemoryAllocator::destroy(LogicalDevice* pLogicalDevice)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        while (!blocks.empty())
+        {
+            if (blocks.back()->allocationCount)
+            {
+                Logger::warn(std::to_string(blocks.back()->allocationCount) + " allocations left in a " + poolName(blocks.back()->pool)
+                             + " memory block");
+            }
+            destroyBlock(pLogicalDevice, blocks.back().get());
+        }
+    }
+
+    void MemoryAllocator::initialize(LogicalDevice* pLogicalDevice)
+    {
+        if (initialized)
+        {
+            return;
+        }
+        pLogicalDevice->vki.GetPhysicalDeviceMemoryProperties(pLogicalDevice->physicalDevice, &memoryProperties);
+        VkPhysicalDeviceProperties properties;
+        pLogicalDevice->vki.GetPhysicalDeviceProperties(pLogicalDevice->physicalDevice, &properties);
+        maxAllocationCount = properties.limits.maxMemoryAllocationCount;
+        initialized        = true;
+    }
+
+    MemoryAllocator::Block*
+    MemoryAllocator::createBlock(LogicalDevice* pLogicalDevice, MemoryPool pool, bool linear, uint32_t memoryTypeIndex, VkDeviceSize size)
+    {
+        if (blocks.size() + 1 >= maxAllocationCount)
+        {
+            Logger::warn("the layer alone uses " + std::to_string(blocks.size()) + " of " + std::to_string(maxAllocationCount)
+                         + " memory allocations");
+        }
+
+        VkMemoryAllocateInfo allocateInfo;
+        allocateInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocateInfo.pNext           = nullptr;
+        allocateInfo.allocationSize  = size;
+        allocateInfo.memoryTypeIndex = memoryTypeIndex;
+
+        VkDeviceMemory memory;
+        VkResult       result = pLogicalDevice->vkd.AllocateMemory(pLogicalDevice->device, &allocateInfo, nullptr, &memory);
+        if (result != VK_SUCCESS)
+        {
+            Logger::err("can't allocate " + toMebibytes(size) + " of " + poolName(pool) + " memory; " + std::to_string(result));
+            return nullptr;
+        }
+
+        uint8_t* mapped = nullptr;
+        if (memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+        {
+            result = pLogicalDevice->vkd.MapMemory(pLogicalDevice->device, memory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void**>(&mapped));
+            ASSERT_VULKAN(result);
+        }
+
+        Logger::debug(std::string("new ") + poolName(pool) + " memory block: " + toMebibytes(size) + ", memory type "
+                      + std::to_string(memoryTypeIndex) + (linear ? ", buffers" : ", images"));
+
+        std::unique_ptr<Block> block(new Block());
+        block->pool            = pool;
+        block->linear          = linear;
+        block->memoryTypeIndex = memoryTypeIndex;
+        block->memory          = memory;
+        block->size            = size;
+        block->mapped          = mapped;
+        block->freeRanges[0]   = size;
+        blocksByMemory[memory] = block.get();
+        blocks.push_back(std::move(block));
+        return blocks.back().get();
+    }
+
+    void MemoryAllocator::destroyBlock(LogicalDevice* pLogicalDevice, Block* pBlock)
+    {
+        if (pBlock->mapped)
+        {
+            pLogicalDevice->vkd.UnmapMemory(pLogicalDevice->device, pBlock->memory);
+        }
+        pLogicalDevice->vkd.FreeMemory(pLogicalDevice->device, pBlock->memory, nullptr);
+        blocksByMemory.erase(pBlock->memory);
+        blocks.erase(std::find_if(
+            blocks.begin(), blocks.end(), [pBlock](const std::unique_ptr<Block>& block) { return block.get() == pBlock; }));
+    }
+
+    bool MemoryAllocator::place(Block* pBlock, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset)
+    {
+        // First fit, the layer allocates few and mostly long lived resources.
+        for (auto range = pBlock->freeRanges.begin(); range != pBlock->freeRanges.end(); range++)
+        {
+            VkDeviceSize rangeOffset   = range->first;
+            VkDeviceSize rangeEnd      = range->first + range->second;
+            VkDeviceSize alignedOffset = (rangeOffset + alignment - 1) / alignment * alignment;
+            if (alignedOffset + size > rangeEnd)
+            {
+                continue;
+            }
+            pBlock->freeRanges.erase(range);
+            if (alignedOffset > rangeOffset)
+            {
+                pBlock->freeRanges[rangeOffset] = alignedOffset - rangeOffset;
+            }
+            if (alignedOffset + size < rangeEnd)
+            {
+                pBlock->freeRanges[alignedOffset + size] = rangeEnd - alignedOffset - size;
+            }
+            offset = alignedOffset;
+            return true;
+        }
+        return false;
+    }
+
+    VkDeviceSize MemoryAllocator::blockSize(MemoryPool pool, uint32_t memoryTypeIndex) const
+    {
+        VkDeviceSize size = pool == MemoryPool::DeviceLocal ? 256 * mebibyte : pool == MemoryPool::HostVisible ? 32 * mebibyte : 16 * mebibyte;
+        // Small heaps, like the 256 MiB of host visible VRAM without resizable BAR, shouldn't go to one block.
+        VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[memoryTypeIndex].heapIndex].size;
+        return std::max(std::min(size, heapSize / 8), mebibyte);
+    }
+} // namespace vkBasalt
@@ -0,0 +1,83 @@
+#ifndef MEMORY_ALLOCATOR_HPP_INCLUDED
+#define MEMORY_ALLOCATOR_HPP_INCLUDED
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "vulkan_include.hpp"
+
+namespace vkBasalt
+{
+    struct LogicalDevice;
+
+    // Every pool has its own blocks, so that short lived staging memory doesn't fragment the blocks of long lived
+    // resources and host visible memory stays mapped.
+    enum class MemoryPool : uint32_t
+    {
+        DeviceLocal = 0,
+        HostVisible = 1,
+        Staging     = 2,
+    };
+
+    struct MemoryAllocation
+    {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize   offset = 0;
+        VkDeviceSize   size   = 0;
+        // Points to offset in memory if the pool is host visible, the memory stays mapped as long as its block lives.
+        uint8_t* mapped = nullptr;
+    };
+
+    // Sub-allocates the memory of all resources the layer creates on a device from a few large blocks, instead of one
+    // vkAllocateMemory per resource, which some drivers limit to a few thousand. Use through allocateMemory and
+    // freeMemory in memory.hpp, which pick the memory type.
+    class MemoryAllocator
+    {
+    public:
+        // Buffers are linear, images with optimal tiling are not. They never share a block, which keeps them
+        // bufferImageGranularity apart without aligning everything to it.
+        MemoryAllocation allocate(LogicalDevice*              pLogicalDevice,
+                                  const VkMemoryRequirements& requirements,
+                                  MemoryPool                  pool,
+                                  bool                        linear,
+                                  uint32_t                    memoryTypeIndex);
+        void             free(LogicalDevice* pLogicalDevice, const MemoryAllocation& allocation);
+        void             logStatistics();
+        // Frees every block, before the device gets destroyed.
+        void destroy(LogicalDevice* pLogicalDevice);
+
+    private:
+        struct Block
+        {
+            MemoryPool     pool;
+            bool           linear;
+            uint32_t       memoryTypeIndex;
+            VkDeviceMemory memory;
+            VkDeviceSize   size;
+            uint8_t*       mapped;
+            // Offset to size of every range that isn't allocated, neighbours get merged on free.
+            std::map<VkDeviceSize, VkDeviceSize> freeRanges;
+            VkDeviceSize                         usedSize        = 0;
+            uint32_t                             allocationCount = 0;
+            // Holds a single allocation that was too large to share a block.
+            bool dedicated = false;
+        };
+
+        // Effects get created on their own thread while the application creates swapchains.
+        std::mutex                          mutex;
+        std::vector<std::unique_ptr<Block>> blocks;
+        std::map<VkDeviceMemory, Block*>    blocksByMemory;
+        VkPhysicalDeviceMemoryProperties    memoryProperties;
+        uint32_t                            maxAllocationCount = 0;
+        bool                                initialized        = false;
+
+        void   initialize(LogicalDevice* pLogicalDevice);
+        Block* createBlock(LogicalDevice* pLogicalDevice, MemoryPool pool, bool linear, uint32_t memoryTypeIndex, VkDeviceSize size);
+        void   destroyBlock(LogicalDevice* pLogicalDevice, Block* pBlock);
+        bool   place(Block* pBlock, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+        VkDeviceSize blockSize(MemoryPool pool, uint32_t memoryTypeIndex) const;
+    };
+} // namespace vkBasalt
+
+#endif // MEMORY_ALLOCATOR_HPP_INCLUDED
@@ -0,0 +1,107 @@
+#include "pipeline_cache.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "logger.hpp"
+#include "util.hpp"
+
+namespace vkBasalt
+{
+    namespace
+    {
+        std::string pipelineCachePath(LogicalDevice* pLogicalDevice)
+        {
+            std::string directory = cacheDirectory();
+            if (directory.empty())
+            {
+                return "";
+            }
+
+            VkPhysicalDeviceProperties properties;
+            pLogicalDevice->vki.GetPhysicalDeviceProperties(pLogicalDevice->physicalDevice, &properties);
+            char name[64];
+            std::snprintf(name, sizeof(name), "pipelines-%04x-%04x-%08x-", properties.vendorID, properties.deviceID, properties.driverVersion);
+            std::string path = directory + "/" + name;
+            for (uint8_t byte : properties.pipelineCacheUUID)
+            {
+                std::snprintf(name, sizeof(name), "%02x", byte);
+                path += name;
+            }
+            return path + ".bin";
+        }
+    } // namespace
+
+    VkPipelineCache createPipelineCache(LogicalDevice* pLogicalDevice)
+    {
+        pLogicalDevice->pipelineCachePath = pipelineCachePath(pLogicalDevice);
+
+        std::vector<char> initialData;
+        if (!pLogicalDevice->pipelineCachePath.empty())
+        {
+            std::ifstream file(pLogicalDevice->pipelineCachePath, std::ios::binary);
+            initialData.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+
+        VkPipelineCacheCreateInfo pipelineCacheCreateInfo;
+        pipelineCacheCreateInfo.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        pipelineCacheCreateInfo.pNext           = nullptr;
+        pipelineCacheCreateInfo.flags           = 0;
+        pipelineCacheCreateInfo.initialDataSize = initialData.size();
+        pipelineCacheCreateInfo.pInitialData    = initialData.data();
+
+        VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+        VkResult        result = pLogicalDevice->vkd.CreatePipelineCache(pLogicalDevice->device, &pipelineCacheCreateInfo, nullptr, &pipelineCache);
+        if (result != VK_SUCCESS && !initialData.empty())
+        {
+            // The driver checks the header itself, a corrupt file just means starting over.
+            Logger::warn("ignoring unusable pipeline cache " + pLogicalDevice->pipelineCachePath);
+            pipelineCacheCreateInfo.initialDataSize = 0;
+            pipelineCacheCreateInfo.pInitialData    = nullptr;
+            initialData.clear();
+            result = pLogicalDevice->vkd.CreatePipelineCache(pLogicalDevice->device, &pipelineCacheCreateInfo, nullptr, &pipelineCache);
+        }
+        if (result != VK_SUCCESS)
+        {
+            Logger::warn("creating pipeline cache failed: " + std::to_string(result));
+            return VK_NULL_HANDLE;
+        }
+
+        pLogicalDevice->pipelineCacheSavedSize = initialData.size();
+        Logger::info("pipeline cache: " + std::to_string(initialData.size()) + " bytes from " + pLogicalDevice->pipelineCachePath);
+        return pipelineCache;
+    }
+
+    void savePipelineCache(LogicalDevice* pLogicalDevice)
+    {
+        if (pLogicalDevice->pipelineCache == VK_NULL_HANDLE || pLogicalDevice->pipelineCachePath.empty())
+        {
+            return;
+        }
+
+        size_t   size   = 0;
+        VkResult result = pLogicalDevice->vkd.GetPipelineCacheData(pLogicalDevice->device, pLogicalDevice->pipelineCache, &size, nullptr);
+        if (result != VK_SUCCESS || size == pLogicalDevice->pipelineCacheSavedSize)
+        {
+            return;
+        }
+        std::vector<char> data(size);
+        result = pLogicalDevice->vkd.GetPipelineCacheData(pLogicalDevice->device, pLogicalDevice->pipelineCache, &size, data.data());
+        if (result != VK_SUCCESS)
+        {
+            return;
+        }
+
+        if (writeFileAtomically(pLogicalDevice->pipelineCachePath, data.data(), size))
+        {
+            pLogicalDevice->pipelineCacheSavedSize = size;
+            Logger::debug("saved " + std::to_string(size) + " bytes of pipeline cache");
+        }
+        else
+        {
+            Logger::warn("can't write pipeline cache " + pLogicalDevice->pipelineCachePath);
+        }
+    }
+} // namespace vkBasalt
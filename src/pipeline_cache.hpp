@@ -0,0 +1,19 @@
+#ifndef PIPELINE_CACHE_HPP_INCLUDED
+#define PIPELINE_CACHE_HPP_INCLUDED
+#include <string>
+
+#include "vulkan_include.hpp"
+
+#include "logical_device.hpp"
+
+namespace vkBasalt
+{
+    // Pipeline cache shared by every pipeline the layer creates on a device, loaded from and saved to the cache
+    // directory. The file name contains vendor, device and driver, so a driver update starts with an empty cache.
+    VkPipelineCache createPipelineCache(LogicalDevice* pLogicalDevice);
+
+    // Does nothing if the cache didn't grow since it was loaded or last saved.
+    void savePipelineCache(LogicalDevice* pLogicalDevice);
+} // namespace vkBasalt
+
+#endif // PIPELINE_CACHE_HPP_INCLUDED
@@ -0,0 +1,220 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cxxabi.h>
+#include <numeric>
+
+#include "logger.hpp"
+#include "util.hpp"
+
+namespace vkBasalt
+{
+    bool Profiler::enabled()
+    {
+        const char* envVar = std::getenv("VKBASALT_PROFILE");
+        return envVar && std::string(envVar) == "1";
+    }
+
+    Profiler* Profiler::create(LogicalDevice* pLogicalDevice, uint32_t imageCount)
+    {
+        uint32_t familyCount = 0;
+        pLogicalDevice->vki.GetPhysicalDeviceQueueFamilyProperties(pLogicalDevice->physicalDevice, &familyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> families(familyCount);
+        pLogicalDevice->vki.GetPhysicalDeviceQueueFamilyProperties(pLogicalDevice->physicalDevice, &familyCount, families.data());
+        uint32_t validBits = pLogicalDevice->queueFamilyIndex < familyCount ? families[pLogicalDevice->queueFamilyIndex].timestampValidBits : 0;
+        if (validBits == 0)
+        {
+            Logger::warn("profiling disabled, the queue doesn't support timestamps");
+            return nullptr;
+        }
+
+        VkPhysicalDeviceProperties properties;
+        pLogicalDevice->vki.GetPhysicalDeviceProperties(pLogicalDevice->physicalDevice, &properties);
+        return new Profiler(pLogicalDevice, imageCount, validBits, properties.limits.timestampPeriod);
+    }
+
+    std::string Profiler::scopeName(uint32_t index, const std::type_info& type)
+    {
+        int   status    = 0;
+        char* demangled = abi::__cxa_demangle(type.name(), nullptr, nullptr, &status);
+        std::string name = std::to_string(index) + " " + (status == 0 ? demangled : type.name());
+        std::free(demangled);
+        return name;
+    }
+
+    Profiler::Profiler(LogicalDevice* pLogicalDevice, uint32_t imageCount, uint32_t validBits, float timestampPeriod)
+        : pLogicalDevice(pLogicalDevice), timestampMask(validBits >= 64 ? ~0ull : (1ull << validBits) - 1), timestampPeriod(timestampPeriod)
+    {
+        VkQueryPoolCreateInfo queryPoolInfo;
+        queryPoolInfo.sType              = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.pNext              = nullptr;
+        queryPoolInfo.flags              = 0;
+        queryPoolInfo.queryType          = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount         = maxScopes * 2;
+        queryPoolInfo.pipelineStatistics = 0;
+
+        images.resize(imageCount);
+        for (auto& image : images)
+        {
+            VkResult result = pLogicalDevice->vkd.CreateQueryPool(pLogicalDevice->device, &queryPoolInfo, nullptr, &image.queryPool);
+            ASSERT_VULKAN(result);
+            image.pending = false;
+        }
+
+        const char* envVar = std::getenv("VKBASALT_PROFILE_FILE");
+        std::string fileName = envVar ? envVar : "vkBasalt-profile.csv";
+        // Every swapchain appends to the same file, the header goes only into a new one.
+        csvFile.open(fileName, std::ios::out | std::ios::app);
+        csvFile.seekp(0, std::ios::end);
+        if (csvFile.is_open() && csvFile.tellp() == 0)
+        {
+            csvFile << "seconds,scope,samples,min_ms,avg_ms,p99_ms" << std::endl;
+        }
+        if (!csvFile.is_open())
+        {
+            Logger::warn("can't open profile file " + fileName);
+        }
+        start = lastReport = std::chrono::steady_clock::now();
+        Logger::info("profiling GPU time of effects, writing " + fileName);
+    }
+
+    void Profiler::beginCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+    {
+        ImageQueries& image = images[imageIndex];
+        image.names.clear();
+        image.openScopes.clear();
+        image.pending = false;
+        pLogicalDevice->vkd.CmdResetQueryPool(commandBuffer, image.queryPool, 0, maxScopes * 2);
+    }
+
+    void Profiler::beginScope(VkCommandBuffer commandBuffer, uint32_t imageIndex, const std::string& name)
+    {
+        ImageQueries& image = images[imageIndex];
+        if (image.names.size() == maxScopes)
+        {
+            // Still keep begin and end balanced, the scope just isn't measured.
+            image.openScopes.push_back(maxScopes);
+            return;
+        }
+        uint32_t scope = image.names.size();
+        image.names.push_back(name);
+        image.openScopes.push_back(scope);
+        // Both timestamps at the bottom of the pipe, so a scope starts once the work before it is done.
+        pLogicalDevice->vkd.CmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, image.queryPool, scope * 2);
+    }
+
+    void Profiler::endScope(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+    {
+        ImageQueries& image = images[imageIndex];
+        uint32_t      scope = image.openScopes.back();
+        image.openScopes.pop_back();
+        if (scope < maxScopes)
+        {
+            pLogicalDevice->vkd.CmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, image.queryPool, scope * 2 + 1);
+        }
+    }
+
+    void Profiler::collect(uint32_t imageIndex)
+    {
+        ImageQueries& image = images[imageIndex];
+        if (!image.pending || image.names.empty())
+        {
+            return;
+        }
+        // Value and availability of each query.
+        std::vector<uint64_t> results(image.names.size() * 2 * 2);
+        VkResult result = pLogicalDevice->vkd.GetQueryPoolResults(pLogicalDevice->device,
+                                                                  image.queryPool,
+                                                                  0,
+                                                                  image.names.size() * 2,
+                                                                  results.size() * sizeof(uint64_t),
+                                                                  results.data(),
+                                                                  2 * sizeof(uint64_t),
+                                                                  VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+        if (result != VK_SUCCESS && result != VK_NOT_READY)
+        {
+            return;
+        }
+        image.pending = false;
+        for (uint32_t scope = 0; scope < image.names.size(); scope++)
+        {
+            const uint64_t* begin = &results[scope * 4];
+            const uint64_t* end   = &results[scope * 4 + 2];
+            if (!begin[1] || !end[1])
+            {
+                continue;
+            }
+            uint64_t ticks = ((end[0] & timestampMask) - (begin[0] & timestampMask)) & timestampMask;
+            Samples& scopeSamples = samples[image.names[scope]];
+            double   milliseconds = ticks * double(timestampPeriod) / 1e6;
+            if (scopeSamples.milliseconds.size() < window)
+            {
+                scopeSamples.milliseconds.push_back(milliseconds);
+            }
+            else
+            {
+                scopeSamples.milliseconds[scopeSamples.next] = milliseconds;
+                scopeSamples.next = (scopeSamples.next + 1) % window;
+            }
+        }
+
+        if (std::chrono::steady_clock::now() - lastReport >= std::chrono::seconds(5))
+        {
+            report();
+        }
+    }
+
+    void Profiler::submitted(uint32_t imageIndex)
+    {
+        images[imageIndex].pending = true;
+    }
+
+    std::vector<Profiler::Summary> Profiler::summarize() const
+    {
+        std::vector<Summary> summaries;
+        for (const auto& [name, scopeSamples] : samples)
+        {
+            std::vector<double> sorted = scopeSamples.milliseconds;
+            std::sort(sorted.begin(), sorted.end());
+            summaries.push_back({
+                name,
+                sorted.size(),
+                sorted.front(),
+                std::accumulate(sorted.begin(), sorted.end(), 0.0) / sorted.size(),
+                sorted[(sorted.size() - 1) * 99 / 100],
+            });
+        }
+        return summaries;
+    }
+
+    void Profiler::report()
+    {
+        lastReport = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(lastReport - start).count();
+        for (const Summary& summary : summarize())
+        {
+            Logger::info("profile " + summary.name + ": min " + std::to_string(summary.minMilliseconds) + " ms, avg "
+                         + std::to_string(summary.avgMilliseconds) + " ms, p99 " + std::to_string(summary.p99Milliseconds) + " ms over "
+                         + std::to_string(summary.samples) + " frames");
+            if (csvFile.is_open())
+            {
+                csvFile << seconds << ",\"" << summary.name << "\"," << summary.samples << "," << summary.minMilliseconds << ","
+                        << summary.avgMilliseconds << "," << summary.p99Milliseconds << "\n";
+            }
+        }
+        csvFile.flush();
+    }
+
+    Profiler::~Profiler()
+    {
+        if (!samples.empty())
+        {
+            report();
+        }
+        for (auto& image : images)
+        {
+            pLogicalDevice->vkd.DestroyQueryPool(pLogicalDevice->device, image.queryPool, nullptr);
+        }
+    }
+} // namespace vkBasalt
@@ -0,0 +1,92 @@
+#ifndef PROFILER_HPP_INCLUDED
+#define PROFILER_HPP_INCLUDED
+#include <vector>
+#include <string>
+#include <fstream>
+#include <chrono>
+#include <map>
+#include <typeinfo>
+
+#include "vulkan_include.hpp"
+
+#include "logical_device.hpp"
+
+namespace vkBasalt
+{
+    // GPU time of effects and AIST layers, enabled with VKBASALT_PROFILE=1.
+    // Every swapchain image has its own query pool, since its command buffer is recorded once and submitted every time
+    // the image is presented. Results of a submission are read the next time the image comes around, without waiting.
+    class Profiler
+    {
+    public:
+        static bool enabled();
+
+        // Returns nullptr if the queue can't write timestamps.
+        static Profiler* create(LogicalDevice* pLogicalDevice, uint32_t imageCount);
+
+        // "index TypeName" of a profiled object, e.g. "1 vkBasalt::CasEffect".
+        static std::string scopeName(uint32_t index, const std::type_info& type);
+
+        // Called first when recording the command buffer of an image.
+        void beginCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+
+        // Scopes may nest, the name is what gets reported.
+        void beginScope(VkCommandBuffer commandBuffer, uint32_t imageIndex, const std::string& name);
+        void endScope(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+
+        // Called right before the command buffer of the image is submitted again.
+        void collect(uint32_t imageIndex);
+        void submitted(uint32_t imageIndex);
+
+        struct Summary
+        {
+            std::string name;
+            size_t      samples;
+            double      minMilliseconds;
+            double      avgMilliseconds;
+            double      p99Milliseconds;
+        };
+
+        // Over the last samples of every scope, in the order of scope names.
+        std::vector<Summary> summarize() const;
+
+        // Logs the summary and appends it to the CSV file, collect() does it every few seconds.
+        void report();
+
+        ~Profiler();
+
+    private:
+        Profiler(LogicalDevice* pLogicalDevice, uint32_t imageCount, uint32_t validBits, float timestampPeriod);
+
+        // Per image, pairs of queries.
+        static constexpr uint32_t maxScopes = 256;
+        // Samples kept per scope for min/avg/p99.
+        static constexpr size_t window = 512;
+
+        struct ImageQueries
+        {
+            VkQueryPool              queryPool;
+            std::vector<std::string> names;
+            // Scopes that are begun but not ended yet.
+            std::vector<uint32_t>    openScopes;
+            bool                     pending;
+        };
+
+        struct Samples
+        {
+            std::vector<double> milliseconds;
+            size_t              next = 0;
+        };
+
+        LogicalDevice*                        pLogicalDevice;
+        uint64_t                              timestampMask;
+        float                                 timestampPeriod;
+        std::vector<ImageQueries>             images;
+        std::map<std::string, Samples>        samples;
+        std::ofstream                         csvFile;
+        std::chrono::steady_clock::time_point start;
+        std::chrono::steady_clock::time_point lastReport;
+    };
+} // namespace vkBasalt
+
+#endif // PROFILER_HPP_INCLUDED
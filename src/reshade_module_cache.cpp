@@ -0,0 +1,449 @@
+#include "reshade_module_cache.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "logger.hpp"
+#include "util.hpp"
+
+namespace vkBasalt
+{
+    namespace
+    {
+        // Bump when the layout below or anything about code generation changes.
+        constexpr uint32_t cacheVersion = 1;
+        constexpr char     cacheMagic[] = "vkBasaltRFX";
+
+        struct SourceFile
+        {
+            std::string path;
+            uint64_t    size;
+            int64_t     modified;
+        };
+
+        bool describeSourceFile(const std::filesystem::path& path, SourceFile& sourceFile)
+        {
+            std::error_code error;
+            sourceFile.path = path.string();
+            sourceFile.size = std::filesystem::file_size(path, error);
+            if (error)
+            {
+                return false;
+            }
+            sourceFile.modified = std::filesystem::last_write_time(path, error).time_since_epoch().count();
+            return !error;
+        }
+
+        std::string cacheFilePath(const std::string& key)
+        {
+            std::string directory = cacheDirectory();
+            if (directory.empty())
+            {
+                return "";
+            }
+            // FNV-1a, the full key is stored in the file and compared as well.
+            uint64_t hash = 0xcbf29ce484222325ull;
+            for (char c : key)
+            {
+                hash = (hash ^ uint8_t(c)) * 0x100000001b3ull;
+            }
+            char name[32];
+            std::snprintf(name, sizeof(name), "reshade-%016llx.bin", (unsigned long long) hash);
+            return directory + "/" + name;
+        }
+
+        // Writer and Reader share one description of the layout, the transfer functions below.
+        class Writer
+        {
+        public:
+            std::vector<uint8_t> data;
+
+            template<typename T>
+            void operator()(T& value)
+            {
+                if constexpr (std::is_arithmetic_v<T> || std::is_enum_v<T>)
+                {
+                    bytes(&value, sizeof(T));
+                }
+                else
+                {
+                    transfer(*this, value);
+                }
+            }
+
+            void operator()(std::string& value)
+            {
+                uint32_t size = value.size();
+                (*this)(size);
+                bytes(value.data(), size);
+            }
+
+            template<typename T>
+            void operator()(std::vector<T>& values)
+            {
+                uint32_t size = values.size();
+                (*this)(size);
+                if constexpr (std::is_arithmetic_v<T>)
+                {
+                    bytes(values.data(), size * sizeof(T));
+                }
+                else
+                {
+                    for (auto& value : values)
+                    {
+                        (*this)(value);
+                    }
+                }
+            }
+
+        private:
+            void bytes(const void* source, size_t size)
+            {
+                data.insert(data.end(), static_cast<const uint8_t*>(source), static_cast<const uint8_t*>(source) + size);
+            }
+        };
+
+        class Reader
+        {
+        public:
+            Reader(const uint8_t* begin, size_t size) : position(begin), end(begin + size)
+            {
+            }
+
+            // Becomes false once something was out of bounds, everything read after that is zero.
+            bool ok = true;
+
+            bool atEnd() const
+            {
+                return position == end;
+            }
+
+            template<typename T>
+            void operator()(T& value)
+            {
+                if constexpr (std::is_arithmetic_v<T> || std::is_enum_v<T>)
+                {
+                    bytes(&value, sizeof(T));
+                }
+                else
+                {
+                    transfer(*this, value);
+                }
+            }
+
+            void operator()(std::string& value)
+            {
+                uint32_t size = 0;
+                (*this)(size);
+                if (!fits(size))
+                {
+                    return;
+                }
+                value.assign(reinterpret_cast<const char*>(position), size);
+                position += size;
+            }
+
+            template<typename T>
+            void operator()(std::vector<T>& values)
+            {
+                uint32_t size = 0;
+                (*this)(size);
+                // Every element takes at least a byte, which keeps a corrupt size from allocating a lot.
+                if (!fits(size))
+                {
+                    return;
+                }
+                values.resize(size);
+                if constexpr (std::is_arithmetic_v<T>)
+                {
+                    bytes(values.data(), size * sizeof(T));
+                }
+                else
+                {
+                    for (auto& value : values)
+                    {
+                        (*this)(value);
+                    }
+                }
+            }
+
+        private:
+            const uint8_t* position;
+            const uint8_t* end;
+
+            bool fits(size_t size)
+            {
+                if (!ok || size_t(end - position) < size)
+                {
+                    ok = false;
+                }
+                return ok;
+            }
+
+            void bytes(void* destination, size_t size)
+            {
+                if (!fits(size))
+                {
+                    std::memset(destination, 0, size);
+                    return;
+                }
+                std::memcpy(destination, position, size);
+                position += size;
+            }
+        };
+
+        template<typename Archive>
+        void transfer(Archive& archive, SourceFile& sourceFile)
+        {
+            archive(sourceFile.path);
+            archive(sourceFile.size);
+            archive(sourceFile.modified);
+        }
+
+        template<typename Archive>
+        void transfer(Archive& archive, reshadefx::type& type)
+        {
+            archive(type.base);
+            archive(type.rows);
+            archive(type.cols);
+            archive(type.qualifiers);
+            archive(type.array_length);
+            archive(type.definition);
+        }
+
+        template<typename Archive>
+        void transfer(Archive& archive, reshadefx::constant& constant)
+        {
+            for (auto& value : constant.as_uint)
+            {
+                archive(value);
+            }
+            archive(constant.string_data);
+            archive(constant.array_data);
+        }
+
+        template<typename Archive>
+        void transfer(Archive& archive, reshadefx::annotation& annotation)
+        {
+            archive(annotation.type);
+            archive(annotation.name);
+            archive(annotation.value);
+        }
+
+        template<typename Archive>
+        void transfer(Archive& archive, reshadefx::entry_point& entryPoint)
+        {
+            archive(entryPoint.name);
+            archive(entryPoint.is_pixel_shader);
+        }
+
+        template<typename Archive>
+        void transfer(Archive& archive, reshadefx::texture_info& texture)
+        {
+            archive(texture.id);
+            archive(texture.binding);
+            archive(texture.semantic);
+            archive(texture.unique_name);
+            archive(texture.annotations);
+            archive(texture.width);
+            archive(texture.height);
+            archive(texture.levels);
+            archive(texture.format);
+        }
+
+        template<typename Archive>
+        void transfer(Archive& archive, reshadefx::sampler_info& sampler)
+        {
+            archive(sampler.id);
+            archive(sampler.binding);
+            archive(sampler.texture_binding);
+            archive(sampler.unique_name);
+            archive(sampler.texture_name);
+            archive(sampler.annotations);
+            archive(sampler.filter);
+            archive(sampler.address_u);
+            archive(sampler.address_v);
+            archive(sampler.address_w);
+            archive(sampler.min_lod);
+            archive(sampler.max_lod);
+            archive(sampler.lod_bias);
+            archive(sampler.srgb);
+        }
+
+        template<typename Archive>
+        void transfer(Archive& archive, reshadefx::uniform_info& uniform)
+        {
+            archive(uniform.name);
+            archive(uniform.type);
+            archive(uniform.size);
+            archive(uniform.offset);
+            archive(uniform.annotations);
+            archive(uniform.has_initializer_value);
+            archive(uniform.initializer_value);
+        }
+
+        template<typename Archive>
+        void transfer(Archive& archive, reshadefx::pass_info& pass)
+        {
+            for (auto& renderTargetName : pass.render_target_names)
+            {
+                archive(renderTargetName);
+            }
+            archive(pass.vs_entry_point);
+            archive(pass.ps_entry_point);
+            archive(pass.clear_render_targets);
+            archive(pass.srgb_write_enable);
+            archive(pass.blend_enable);
+            archive(pass.stencil_enable);
+            archive(pass.color_write_mask);
+            archive(pass.stencil_read_mask);
+            archive(pass.stencil_write_mask);
+            archive(pass.blend_op);
+            archive(pass.blend_op_alpha);
+            archive(pass.src_blend);
+            archive(pass.dest_blend);
+            archive(pass.src_blend_alpha);
+            archive(pass.dest_blend_alpha);
+            archive(pass.stencil_comparison_func);
+            archive(pass.stencil_reference_value);
+            archive(pass.stencil_op_pass);
+            archive(pass.stencil_op_fail);
+            archive(pass.stencil_op_depth_fail);
+            archive(pass.num_vertices);
+            archive(pass.topology);
+            archive(pass.viewport_width);
+            archive(pass.viewport_height);
+        }
+
+        template<typename Archive>
+        void transfer(Archive& archive, reshadefx::technique_info& technique)
+        {
+            archive(technique.name);
+            archive(technique.passes);
+            archive(technique.annotations);
+        }
+
+        template<typename Archive>
+        void transfer(Archive& archive, reshadefx::module& module)
+        {
+            archive(module.spirv);
+            archive(module.entry_points);
+            archive(module.textures);
+            archive(module.samplers);
+            archive(module.uniforms);
+            archive(module.spec_constants);
+            archive(module.techniques);
+            archive(module.total_uniform_size);
+            archive(module.num_sampler_bindings);
+            archive(module.num_texture_bindings);
+        }
+
+        template<typename Archive>
+        void transferHeader(Archive& archive, char (&magic)[sizeof(cacheMagic)], uint32_t& version, std::string& key)
+        {
+            for (auto& c : magic)
+            {
+                archive(c);
+            }
+            archive(version);
+            archive(key);
+        }
+    } // namespace
+
+    bool loadReshadeModule(const std::string& key, reshadefx::module& module)
+    {
+        std::string path = cacheFilePath(key);
+        int         fd   = path.empty() ? -1 : open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return false;
+        }
+        struct stat fileStat;
+        void*       mapping = MAP_FAILED;
+        if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0)
+        {
+            mapping = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        close(fd);
+        if (mapping == MAP_FAILED)
+        {
+            return false;
+        }
+
+        Reader      reader(static_cast<const uint8_t*>(mapping), fileStat.st_size);
+        char        magic[sizeof(cacheMagic)];
+        uint32_t    version;
+        std::string storedKey;
+        transferHeader(reader, magic, version, storedKey);
+        bool hit = reader.ok && std::memcmp(magic, cacheMagic, sizeof(cacheMagic)) == 0 && version == cacheVersion && storedKey == key;
+
+        std::vector<SourceFile> sourceFiles;
+        if (hit)
+        {
+            reader(sourceFiles);
+            for (const auto& sourceFile : sourceFiles)
+            {
+                SourceFile current;
+                hit = hit && describeSourceFile(sourceFile.path, current) && current.size == sourceFile.size
+                      && current.modified == sourceFile.modified;
+            }
+        }
+
+        reshadefx::module cachedModule;
+        if (hit)
+        {
+            reader(cachedModule);
+            hit = reader.ok && reader.atEnd();
+        }
+        munmap(mapping, fileStat.st_size);
+
+        if (!hit)
+        {
+            Logger::debug("reshade module cache miss: " + path);
+            return false;
+        }
+        Logger::debug("reshade module cache hit: " + path);
+        module = std::move(cachedModule);
+        return true;
+    }
+
+    void saveReshadeModule(const std::string& key, const std::vector<std::filesystem::path>& sourceFiles, const reshadefx::module& module)
+    {
+        std::string path = cacheFilePath(key);
+        if (path.empty())
+        {
+            return;
+        }
+
+        std::vector<SourceFile> describedFiles(sourceFiles.size());
+        for (size_t i = 0; i < sourceFiles.size(); i++)
+        {
+            if (!describeSourceFile(sourceFiles[i], describedFiles[i]))
+            {
+                return;
+            }
+        }
+
+        Writer      writer;
+        char        magic[sizeof(cacheMagic)];
+        uint32_t    version   = cacheVersion;
+        std::string storedKey = key;
+        std::memcpy(magic, cacheMagic, sizeof(cacheMagic));
+        transferHeader(writer, magic, version, storedKey);
+        writer(describedFiles);
+        // The writer only reads from the module.
+        writer(const_cast<reshadefx::module&>(module));
+
+        if (!writeFileAtomically(path, writer.data.data(), writer.data.size()))
+        {
+            Logger::warn("can't write reshade module cache " + path);
+        }
+    }
+} // namespace vkBasalt
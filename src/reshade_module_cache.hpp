@@ -0,0 +1,21 @@
+#ifndef RESHADE_MODULE_CACHE_HPP_INCLUDED
+#define RESHADE_MODULE_CACHE_HPP_INCLUDED
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "reshade/effect_module.hpp"
+
+namespace vkBasalt
+{
+    // Compiled ReShade effects in the cache directory, so that starting a game again skips preprocessor, parser and
+    // SPIR-V generation. The key has to contain everything that goes into compiling besides the source files: the
+    // effect file, include path, macros and codegen flags. The source files are checked by size and modification time.
+
+    // Returns false if there is no entry for the key or one of its files changed.
+    bool loadReshadeModule(const std::string& key, reshadefx::module& module);
+
+    void saveReshadeModule(const std::string& key, const std::vector<std::filesystem::path>& sourceFiles, const reshadefx::module& module);
+} // namespace vkBasalt
+
+#endif // RESHADE_MODULE_CACHE_HPP_INCLUDED
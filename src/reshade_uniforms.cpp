@@ -8,6 +8,7 @@
 #include <algorithm>
 
 #include "logger.hpp"
+#include "keyboard_input.hpp"
 
 namespace vkBasalt
 {
@@ -282,40 +283,71 @@ namespace vkBasalt
     }
 
     //////////////////////////////////////////////////////////////////////////////////////////////////////////
-    KeyUniform::KeyUniform(reshadefx::uniform_info uniformInfo)
+    InputUniform::InputUniform(const reshadefx::uniform_info& uniformInfo)
+    {
+        if (auto keycodeAnnotation =
+                std::find_if(uniformInfo.annotations.begin(), uniformInfo.annotations.end(), [](const auto& a) { return a.name == "keycode"; });
+            keycodeAnnotation != uniformInfo.annotations.end())
+        {
+            keycode = keycodeAnnotation->type.is_integral() ? keycodeAnnotation->value.as_uint[0]
+                                                            : static_cast<uint32_t>(keycodeAnnotation->value.as_float[0]);
+        }
+        if (auto modeAnnotation =
+                std::find_if(uniformInfo.annotations.begin(), uniformInfo.annotations.end(), [](const auto& a) { return a.name == "mode"; });
+            modeAnnotation != uniformInfo.annotations.end())
+        {
+            if (modeAnnotation->value.string_data == "press")
+            {
+                mode = Mode::Press;
+            }
+            else if (modeAnnotation->value.string_data == "toggle")
+            {
+                mode = Mode::Toggle;
+            }
+        }
+        offset = uniformInfo.offset;
+        size   = uniformInfo.size;
+    }
+    void InputUniform::write(void* mapedBuffer, bool down)
+    {
+        bool pressed = down && !wasDown;
+        wasDown      = down;
+        toggledOn    = toggledOn != pressed;
+
+        VkBool32 value = mode == Mode::Press ? pressed : mode == Mode::Toggle ? toggledOn : down;
+        std::memcpy((uint8_t*) mapedBuffer + offset, &(value), sizeof(VkBool32));
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////
+    KeyUniform::KeyUniform(reshadefx::uniform_info uniformInfo) : InputUniform(uniformInfo)
     {
         auto source = std::find_if(uniformInfo.annotations.begin(), uniformInfo.annotations.end(), [](const auto& a) { return a.name == "source"; });
         if (source->value.string_data != "key")
         {
             Logger::err("Tried to create a KeyUniform from a non key uniform_info");
         }
-        offset = uniformInfo.offset;
-        size   = uniformInfo.size;
+        keySymbol = convertVirtualKeyToKeySym(keycode);
     }
     void KeyUniform::update(void* mapedBuffer)
     {
-        VkBool32 keyDown = VK_FALSE; // TODO
-        std::memcpy((uint8_t*) mapedBuffer + offset, &(keyDown), sizeof(VkBool32));
+        write(mapedBuffer, isKeyPressed(keySymbol));
     }
     KeyUniform::~KeyUniform()
     {
     }
 
     //////////////////////////////////////////////////////////////////////////////////////////////////////////
-    MouseButtonUniform::MouseButtonUniform(reshadefx::uniform_info uniformInfo)
+    MouseButtonUniform::MouseButtonUniform(reshadefx::uniform_info uniformInfo) : InputUniform(uniformInfo)
     {
         auto source = std::find_if(uniformInfo.annotations.begin(), uniformInfo.annotations.end(), [](const auto& a) { return a.name == "source"; });
         if (source->value.string_data != "mousebutton")
         {
             Logger::err("Tried to create a MouseButtonUniform from a non mousebutton uniform_info");
         }
-        offset = uniformInfo.offset;
-        size   = uniformInfo.size;
     }
     void MouseButtonUniform::update(void* mapedBuffer)
     {
-        VkBool32 keyDown = VK_FALSE; // TODO
-        std::memcpy((uint8_t*) mapedBuffer + offset, &(keyDown), sizeof(VkBool32));
+        write(mapedBuffer, isMouseButtonPressed(keycode));
     }
     MouseButtonUniform::~MouseButtonUniform()
     {
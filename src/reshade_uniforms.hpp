@@ -100,15 +100,40 @@ namespace vkBasalt
         int min = 0;
     };
 
-    class KeyUniform : public ReshadeUniform
+    // State of a key or mouse button, in one of the modes of the "mode" annotation.
+    class InputUniform : public ReshadeUniform
+    {
+    protected:
+        InputUniform(const reshadefx::uniform_info& uniformInfo);
+        void write(void* mapedBuffer, bool down);
+
+        uint32_t keycode = 0;
+
+    private:
+        enum class Mode
+        {
+            Down,
+            Press,
+            Toggle,
+        };
+
+        Mode mode      = Mode::Down;
+        bool wasDown   = false;
+        bool toggledOn = false;
+    };
+
+    class KeyUniform : public InputUniform
     {
     public:
         KeyUniform(reshadefx::uniform_info uniformInfo);
         void virtual update(void* mapedBuffer) override;
         virtual ~KeyUniform();
+
+    private:
+        uint32_t keySymbol;
     };
 
-    class MouseButtonUniform : public ReshadeUniform
+    class MouseButtonUniform : public InputUniform
     {
     public:
         MouseButtonUniform(reshadefx::uniform_info uniformInfo);
@@ -1,3 +1,12 @@
 #extension GL_EXT_scalar_block_layout : require
+//Tensors are stored either as 32-bit or as 16-bit floats, all arithmetic stays 32-bit.
+#ifdef TENSOR_FP16
+#extension GL_EXT_shader_16bit_storage : require
+#define TENSOR_T float16_t
+#define TENSOR_VEC4 f16vec4
+#else
+#define TENSOR_T float
+#define TENSOR_VEC4 vec4
+#endif
 layout(constant_id = 0) const int WIDTH = 1;
-layout(constant_id = 1) const int HEIGHT = 1;
\ No newline at end of file
+layout(constant_id = 1) const int HEIGHT = 1;
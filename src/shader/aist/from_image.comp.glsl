@@ -1,65 +1,119 @@
 #version 450
 #extension GL_GOOGLE_include_directive : require
 #include "consts.comp.glsl"
-layout(local_size_x = 4, local_size_y = 4, local_size_z = 4) in;
+//Also write per-workgroup mean, M2 and count of every output channel for the following In2D.
+layout(constant_id = 2) const bool STATS = false;
+//Every invocation produces all output channels of one pixel of the half-resolution tensor.
+layout(local_size_x = 8, local_size_y = 8) in;
 
 const int IN_CHANNELS = 3;
 const int OUT_CHANNELS = 32;
+const int STRIDE = 2;
+//Input pixels the workgroup reads in each direction: its outputs plus a halo of 1 on both sides.
+const int TILE_X = int(gl_WorkGroupSize.x) * STRIDE + 1;
+const int TILE_Y = int(gl_WorkGroupSize.y) * STRIDE + 1;
+const uint INVOCATIONS = gl_WorkGroupSize.x * gl_WorkGroupSize.y;
 layout(std430, set = 0, binding = 0) uniform restrict readonly Convs {
     float convs[OUT_CHANNELS][IN_CHANNELS][3 * 3];
 };
 layout(set = 1, binding = 0, rgba8) uniform restrict readonly image2D inImage;
 layout(std430, set = 1, binding = 1) buffer restrict writeonly OutTensor {
-    float outTensor[WIDTH / 2 * (HEIGHT / 2)][OUT_CHANNELS];
+    TENSOR_T outTensor[WIDTH / 2 * (HEIGHT / 2)][OUT_CHANNELS];
 };
+//Same layout as In2D stats viewed as floats: shift and scale, then partial means, partial M2 and partial counts.
+layout(std430, set = 1, binding = 2) buffer restrict writeonly Stats {
+    float stats[];
+};
+
+//Plain floats keep shared memory within the guaranteed 16 KiB together with the statistics.
+shared float tile[TILE_X][TILE_Y][IN_CHANNELS];
+//Kernel index is kx × 3 + ky, same as in the UBO.
+shared float sharedConvs[OUT_CHANNELS][3 * 3][IN_CHANNELS];
+shared float sharedOut[INVOCATIONS][OUT_CHANNELS];
+
+bool isInside(const in uvec2 globalId) {
+    return int(globalId.x) * STRIDE < WIDTH && int(globalId.y) * STRIDE < HEIGHT;
+}
+
+void writeStats() {
+    const uint c = gl_LocalInvocationIndex;
+    float count = 0.0;
+    float sum = 0.0;
+    for (uint i = 0; i < INVOCATIONS; i++) {
+        if (isInside(gl_WorkGroupID.xy * gl_WorkGroupSize.xy + uvec2(i % gl_WorkGroupSize.x, i / gl_WorkGroupSize.x))) {
+            count += 1.0;
+            sum += sharedOut[i][c];
+        }
+    }
+    const float mean = sum / count;
+    float m2 = 0.0;
+    for (uint i = 0; i < INVOCATIONS; i++) {
+        if (isInside(gl_WorkGroupID.xy * gl_WorkGroupSize.xy + uvec2(i % gl_WorkGroupSize.x, i / gl_WorkGroupSize.x))) {
+            const float delta = sharedOut[i][c] - mean;
+            m2 = fma(delta, delta, m2);
+        }
+    }
+    const uint groups = gl_NumWorkGroups.x * gl_NumWorkGroups.y;
+    const uint group = gl_WorkGroupID.x * gl_NumWorkGroups.y + gl_WorkGroupID.y;
+    const uint meanBase = OUT_CHANNELS * 2;
+    const uint m2Base = meanBase + groups * OUT_CHANNELS;
+    const uint countBase = m2Base + groups * OUT_CHANNELS;
+    stats[meanBase + group * OUT_CHANNELS + c] = mean;
+    stats[m2Base + group * OUT_CHANNELS + c] = m2;
+    if (c == 0) {
+        stats[countBase + group * 4] = count;
+    }
+}
 
 void main() {
-    const int cx = int(gl_GlobalInvocationID.x) * 2;
-    const int cy = int(gl_GlobalInvocationID.y) * 2;
-    if (cx >= WIDTH || cy >= HEIGHT) return;
-    const uint c = gl_GlobalInvocationID.z;
-    const int by = max(cy - 1, 0);
-    const int dy = min(cy + 1, HEIGHT - 1);
-    float buf = 0.0;
-    float conv[IN_CHANNELS][9] = convs[c];
-    int x = max(cx - 1, 0);
-    buf += dot(
-    vec3(conv[0][0], conv[1][0], conv[2][0]),
-    imageLoad(inImage, ivec2(x, by)).rgb
-    );
-    buf += dot(
-    vec3(conv[0][1], conv[1][1], conv[2][1]),
-    imageLoad(inImage, ivec2(x, cy)).rgb
-    );
-    buf += dot(
-    vec3(conv[0][2], conv[1][2], conv[2][2]),
-    imageLoad(inImage, ivec2(x, dy)).rgb
-    );
-    x = cx;
-    buf += dot(
-    vec3(conv[0][3], conv[1][3], conv[2][3]),
-    imageLoad(inImage, ivec2(cx, by)).rgb
-    );
-    buf += dot(
-    vec3(conv[0][4], conv[1][4], conv[2][4]),
-    imageLoad(inImage, ivec2(cx, cy)).rgb
-    );
-    buf += dot(
-    vec3(conv[0][5], conv[1][5], conv[2][5]),
-    imageLoad(inImage, ivec2(cx, dy)).rgb
-    );
-    x = min(cx + 1, WIDTH - 1);
-    buf += dot(
-    vec3(conv[0][6], conv[1][6], conv[2][6]),
-    imageLoad(inImage, ivec2(x, by)).rgb
-    );
-    buf += dot(
-    vec3(conv[0][7], conv[1][7], conv[2][7]),
-    imageLoad(inImage, ivec2(x, cy)).rgb
-    );
-    buf += dot(
-    vec3(conv[0][8], conv[1][8], conv[2][8]),
-    imageLoad(inImage, ivec2(x, dy)).rgb
-    );
-    outTensor[gl_GlobalInvocationID.x * HEIGHT / 2 + gl_GlobalInvocationID.y][c] = buf;
+    const uint li = gl_LocalInvocationIndex;
+    for (uint i = li; i < OUT_CHANNELS * 9; i += INVOCATIONS) {
+        const uint c = i / 9;
+        const uint k = i % 9;
+        for (uint ic = 0; ic < IN_CHANNELS; ic++) {
+            sharedConvs[c][k][ic] = convs[c][ic][k];
+        }
+    }
+    //Clamp to edge, same as the direct kernel.
+    const ivec2 origin = ivec2(gl_WorkGroupID.xy * gl_WorkGroupSize.xy) * STRIDE - 1;
+    for (uint i = li; i < TILE_X * TILE_Y; i += INVOCATIONS) {
+        const int tx = int(i) / TILE_Y;
+        const int ty = int(i) % TILE_Y;
+        const ivec2 pos = clamp(origin + ivec2(tx, ty), ivec2(0), ivec2(WIDTH - 1, HEIGHT - 1));
+        const vec3 rgb = imageLoad(inImage, pos).rgb;
+        tile[tx][ty][0] = rgb.r;
+        tile[tx][ty][1] = rgb.g;
+        tile[tx][ty][2] = rgb.b;
+    }
+    barrier();
+
+    //Invocations outside of the image still take part in barriers.
+    const bool inside = isInside(gl_GlobalInvocationID.xy);
+    if (inside) {
+        const ivec2 base = ivec2(gl_LocalInvocationID.xy) * STRIDE;
+        vec3 neighbourhood[9];
+        for (int kx = 0; kx < 3; kx++) {
+            for (int ky = 0; ky < 3; ky++) {
+                const ivec2 t = base + ivec2(kx, ky);
+                neighbourhood[kx * 3 + ky] = vec3(tile[t.x][t.y][0], tile[t.x][t.y][1], tile[t.x][t.y][2]);
+            }
+        }
+        const uint outPos = gl_GlobalInvocationID.x * HEIGHT / 2 + gl_GlobalInvocationID.y;
+        for (uint c = 0; c < OUT_CHANNELS; c++) {
+            float buf = 0.0;
+            for (uint k = 0; k < 9; k++) {
+                buf += dot(vec3(sharedConvs[c][k][0], sharedConvs[c][k][1], sharedConvs[c][k][2]), neighbourhood[k]);
+            }
+            outTensor[outPos][c] = TENSOR_T(buf);
+            if (STATS) {
+                sharedOut[li][c] = buf;
+            }
+        }
+    }
+    if (STATS) {
+        barrier();
+        if (li < OUT_CHANNELS) {
+            writeStats();
+        }
+    }
 }
@@ -0,0 +1,117 @@
+//Strided grouped 3 × 3 convolution with a bias per output channel.
+//Reads the image with IMAGE_INPUT defined, otherwise a tensor SPATIAL_DIVISOR times smaller than the image.
+layout(constant_id = 2) const uint SPATIAL_DIVISOR = 1;
+layout(constant_id = 3) const uint IN_CHANNELS = 3;
+layout(constant_id = 4) const uint OUT_CHANNELS = 32;
+layout(constant_id = 5) const uint GROUPS = 1;
+layout(constant_id = 6) const uint STRIDE = 2;
+//Same as padding_mode='reflect', otherwise clamps to edge.
+layout(constant_id = 7) const bool REFLECT = false;
+//Every invocation produces all output channels of one output pixel.
+layout(local_size_x = 8, local_size_y = 8) in;
+
+const int IN_WIDTH = WIDTH / int(SPATIAL_DIVISOR);
+const int IN_HEIGHT = HEIGHT / int(SPATIAL_DIVISOR);
+const int OUT_WIDTH = IN_WIDTH / int(STRIDE);
+const int OUT_HEIGHT = IN_HEIGHT / int(STRIDE);
+const uint IN_PER_GROUP = IN_CHANNELS / GROUPS;
+const uint OUT_PER_GROUP = OUT_CHANNELS / GROUPS;
+//The biases follow the kernels.
+const uint BIAS_OFFSET = OUT_CHANNELS * IN_PER_GROUP * 9;
+//Input channels in shared memory at once, keeps the tile within 16 KiB for strides up to 2.
+const uint CHUNK = IN_CHANNELS < 8 ? IN_CHANNELS : 8;
+//Input pixels the workgroup reads in each direction: its outputs plus a halo of 1 on both sides.
+const int TILE_X = (int(gl_WorkGroupSize.x) - 1) * int(STRIDE) + 3;
+const int TILE_Y = (int(gl_WorkGroupSize.y) - 1) * int(STRIDE) + 3;
+const uint INVOCATIONS = gl_WorkGroupSize.x * gl_WorkGroupSize.y;
+
+//[output channel][input channel of the group][kx × 3 + ky], then [output channel] of biases.
+//Too big for a uniform buffer with wide layers.
+layout(std430, set = 0, binding = 0) buffer restrict readonly Convs {
+    float convs[];
+};
+#ifdef IMAGE_INPUT
+layout(set = 1, binding = 0, rgba8) uniform restrict readonly image2D inImage;
+#else
+layout(std430, set = 1, binding = 0) buffer restrict readonly InTensor {
+    TENSOR_T inTensor[];
+};
+#endif
+layout(std430, set = 1, binding = 1) buffer restrict writeonly OutTensor {
+    TENSOR_T outTensor[];
+};
+
+shared float tile[TILE_X * TILE_Y * CHUNK];
+
+int padIndex(const in int i, const in int size) {
+    if (REFLECT) {
+        if (i < 0) return -i;
+        if (i >= size) return 2 * size - 2 - i;
+        return i;
+    }
+    return clamp(i, 0, size - 1);
+}
+
+float loadInput(const in ivec2 pos, const in uint c) {
+#ifdef IMAGE_INPUT
+    return imageLoad(inImage, pos)[c];
+#else
+    return float(inTensor[(pos.x * IN_HEIGHT + pos.y) * IN_CHANNELS + c]);
+#endif
+}
+
+void main() {
+    const uint li = gl_LocalInvocationIndex;
+    const ivec2 origin = ivec2(gl_WorkGroupID.xy * gl_WorkGroupSize.xy) * int(STRIDE) - 1;
+    const ivec2 base = ivec2(gl_LocalInvocationID.xy) * int(STRIDE);
+    const ivec2 pos = ivec2(gl_GlobalInvocationID.xy);
+    //Invocations outside of the output still take part in barriers.
+    const bool inside = pos.x < OUT_WIDTH && pos.y < OUT_HEIGHT;
+
+    float acc[OUT_CHANNELS];
+    for (uint o = 0; o < OUT_CHANNELS; o++) {
+        acc[o] = convs[BIAS_OFFSET + o];
+    }
+    for (uint chunk = 0; chunk < IN_CHANNELS; chunk += CHUNK) {
+        const uint chunkSize = min(CHUNK, IN_CHANNELS - chunk);
+        //Neighbouring invocations read neighbouring channels of a tensor pixel.
+        for (uint i = li; i < TILE_X * TILE_Y * CHUNK; i += INVOCATIONS) {
+            const uint c = i % CHUNK;
+            if (c < chunkSize) {
+                const int tx = int(i / CHUNK) / TILE_Y;
+                const int ty = int(i / CHUNK) % TILE_Y;
+                const ivec2 p = ivec2(padIndex(origin.x + tx, IN_WIDTH), padIndex(origin.y + ty, IN_HEIGHT));
+                tile[i] = loadInput(p, chunk + c);
+            }
+        }
+        barrier();
+        if (inside) {
+            //Only output channels of groups that overlap the chunk.
+            const uint firstGroup = chunk / IN_PER_GROUP;
+            const uint endGroup = (chunk + chunkSize - 1) / IN_PER_GROUP + 1;
+            for (uint o = firstGroup * OUT_PER_GROUP; o < endGroup * OUT_PER_GROUP; o++) {
+                const uint groupStart = o / OUT_PER_GROUP * IN_PER_GROUP;
+                const uint from = max(groupStart, chunk);
+                const uint to = min(groupStart + IN_PER_GROUP, chunk + chunkSize);
+                float sum = acc[o];
+                for (uint ic = from; ic < to; ic++) {
+                    const uint weights = (o * IN_PER_GROUP + ic - groupStart) * 9;
+                    for (int kx = 0; kx < 3; kx++) {
+                        for (int ky = 0; ky < 3; ky++) {
+                            const int t = (base.x + kx) * TILE_Y + base.y + ky;
+                            sum = fma(tile[t * CHUNK + ic - chunk], convs[weights + kx * 3 + ky], sum);
+                        }
+                    }
+                }
+                acc[o] = sum;
+            }
+        }
+        barrier();
+    }
+    if (!inside) return;
+
+    const uint outPos = (pos.x * OUT_HEIGHT + pos.y) * OUT_CHANNELS;
+    for (uint o = 0; o < OUT_CHANNELS; o++) {
+        outTensor[outPos + o] = TENSOR_T(acc[o]);
+    }
+}
@@ -0,0 +1,5 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+#include "consts.comp.glsl"
+#define IMAGE_INPUT
+#include "grouped_conv_common.comp.glsl"
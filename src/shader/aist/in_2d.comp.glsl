@@ -2,8 +2,21 @@
 #extension GL_GOOGLE_include_directive : require
 #include "consts.comp.glsl"
 layout(constant_id = 2) const uint SPATIAL_DIVISOR = 2;
-layout(constant_id = 3) const uint CHANNELS = 1;
-layout(local_size_x = 1, local_size_y = 1, local_size_z = 1) in;
+layout(constant_id = 3) const uint CHANNELS = 4;
+//Every invocation handles 4 adjacent channels, so CHANNELS must be a multiple of 4.
+layout(constant_id = 4) const uint QUADS = 1;
+//Power of two, QUADS × ROWS ≤ MAX_INVOCATIONS.
+layout(constant_id = 5) const uint ROWS = 1;
+layout(constant_id = 6) const uint REDUCE_GROUPS = 1;
+layout(constant_id = 7) const bool RELU = true;
+//Normalized values are added to Residual instead of replacing the input.
+layout(constant_id = 8) const bool RESIDUAL = false;
+//When not 0, REDUCE_GROUPS partials are first merged into this many, which finalization goes through instead.
+layout(constant_id = 9) const uint MERGE_GROUPS = 0;
+layout(local_size_x_id = 4, local_size_y_id = 5) in;
+
+const uint MAX_INVOCATIONS = 256;
+const float EPSILON = 0.00001;
 
 layout(push_constant) uniform PushConsts {
     uint substage;
@@ -15,36 +28,150 @@ layout(std430, set = 0, binding = 0) uniform restrict readonly Weights {
     float weights[CHANNELS * 2];
 };
 layout(std430, set = 1, binding = 0) buffer restrict Tensor {
-    float image[imageSize * CHANNELS];
+    TENSOR_VEC4 image[imageSize * QUADS];
 };
+//[0, QUADS) - shift, [QUADS, 2 × QUADS) - scale,
+//then REDUCE_GROUPS × QUADS of partial means, as many partial M2 and REDUCE_GROUPS of partial counts,
+//then the same for MERGE_GROUPS merged partials.
 layout(std430, set = 1, binding = 1) buffer restrict Stats {
-    float stats[CHANNELS * 2];
+    vec4 stats[];
+};
+layout(std430, set = 1, binding = 2) buffer restrict Residual {
+    TENSOR_VEC4 residual[imageSize * QUADS];
 };
 
+shared vec4 sharedMean[MAX_INVOCATIONS];
+shared vec4 sharedM2[MAX_INVOCATIONS];
+shared float sharedCount[MAX_INVOCATIONS];
+
+const uint meanBase = QUADS * 2;
+const uint mergedMeanBase = meanBase + REDUCE_GROUPS * (QUADS * 2 + 1);
+
+//Chan et al. pairwise update: merges (countB, meanB, m2B) into (count, mean, m2).
+void combine(inout float count, inout vec4 mean, inout vec4 m2, const in float countB, const in vec4 meanB, const in vec4 m2B) {
+    if (countB == 0.0) return;
+    const float total = count + countB;
+    const vec4 delta = meanB - mean;
+    const float weightB = countB / total;
+    mean = fma(delta, vec4(weightB), mean);
+    m2 += m2B + delta * delta * (count * weightB);
+    count = total;
+}
+
+//Partials starting at base: groups × QUADS means, as many M2, then groups counts.
+void combinePartial(const in uint base, const in uint groups, const in uint group, const in uint q,
+                    inout float count, inout vec4 mean, inout vec4 m2) {
+    combine(
+            count, mean, m2,
+            stats[base + groups * QUADS * 2 + group].x,
+            stats[base + group * QUADS + q],
+            stats[base + (groups + group) * QUADS + q]
+    );
+}
+
+void writePartial(const in uint base, const in uint groups, const in uint group, const in uint q,
+                  const in float count, const in vec4 mean, const in vec4 m2) {
+    stats[base + group * QUADS + q] = mean;
+    stats[base + (groups + group) * QUADS + q] = m2;
+    if (q == 0) {
+        stats[base + groups * QUADS * 2 + group] = vec4(count);
+    }
+}
+
+//Tree reduction over y for every quad, result ends up in row 0.
+void reduceRows(const in uint q, const in uint r, inout float count, inout vec4 mean, inout vec4 m2) {
+    const uint idx = r * QUADS + q;
+    sharedCount[idx] = count;
+    sharedMean[idx] = mean;
+    sharedM2[idx] = m2;
+    barrier();
+    for (uint stride = ROWS / 2; stride > 0; stride /= 2) {
+        if (r < stride) {
+            const uint other = idx + stride * QUADS;
+            combine(count, mean, m2, sharedCount[other], sharedMean[other], sharedM2[other]);
+            sharedCount[idx] = count;
+            sharedMean[idx] = mean;
+            sharedM2[idx] = m2;
+        }
+        barrier();
+    }
+}
+
 void main() {
-    const uint c = gl_GlobalInvocationID.z;
+    const uint q = gl_LocalInvocationID.x;
+    const uint r = gl_LocalInvocationID.y;
+    float count = 0.0;
+    vec4 mean = vec4(0.0);
+    vec4 m2 = vec4(0.0);
     switch (substage) {
-        case 0:
-        float mean = 0.0;
-        float deviation = 1.0;
-        for (uint i = 0; i < 1000; i++) {
-            float x = image[i * CHANNELS + c];
-            float deviates = x - mean;
-            mean += deviates;
-//            mean = fma(deviates, 1.0/(i + 1), mean);
-//            deviation = fma(deviates, x - mean, deviation);
+        case 0: {
+            //Welford over a contiguous range of pixels per workgroup.
+            const uint group = gl_WorkGroupID.x;
+            const uint chunk = (imageSize + REDUCE_GROUPS - 1) / REDUCE_GROUPS;
+            const uint end = min(imageSize, (group + 1) * chunk);
+            for (uint p = group * chunk + r; p < end; p += ROWS) {
+                const vec4 x = vec4(image[p * QUADS + q]);
+                count += 1.0;
+                const vec4 delta = x - mean;
+                mean += delta / count;
+                m2 = fma(delta, x - mean, m2);
+            }
+            reduceRows(q, r, count, mean, m2);
+            if (r == 0) {
+                writePartial(meanBase, REDUCE_GROUPS, group, q, count, mean, m2);
+            }
+            break;
+        }
+        case 1: {
+            //Chan's combine over a contiguous range of partials per workgroup.
+            const uint group = gl_WorkGroupID.x;
+            const uint chunk = (REDUCE_GROUPS + MERGE_GROUPS - 1) / max(MERGE_GROUPS, 1u);
+            const uint end = min(REDUCE_GROUPS, (group + 1) * chunk);
+            for (uint partial = group * chunk + r; partial < end; partial += ROWS) {
+                combinePartial(meanBase, REDUCE_GROUPS, partial, q, count, mean, m2);
+            }
+            reduceRows(q, r, count, mean, m2);
+            if (r == 0) {
+                writePartial(mergedMeanBase, MERGE_GROUPS, group, q, count, mean, m2);
+            }
+            break;
+        }
+        case 2: {
+            const uint base = MERGE_GROUPS > 0 ? mergedMeanBase : meanBase;
+            const uint groups = MERGE_GROUPS > 0 ? MERGE_GROUPS : REDUCE_GROUPS;
+            for (uint group = r; group < groups; group += ROWS) {
+                combinePartial(base, groups, group, q, count, mean, m2);
+            }
+            reduceRows(q, r, count, mean, m2);
+            if (r == 0) {
+                const uint c = q * 4;
+                //Biased variance, same as PyTorch InstanceNorm2d.
+                const vec4 scale = vec4(weights[c], weights[c + 1], weights[c + 2], weights[c + 3])
+                        * inversesqrt(m2 / max(count, 1.0) + EPSILON);
+                const vec4 bias = vec4(
+                        weights[CHANNELS + c], weights[CHANNELS + c + 1], weights[CHANNELS + c + 2], weights[CHANNELS + c + 3]
+                );
+                stats[q] = fma(-mean, scale, bias);
+                stats[QUADS + q] = scale;
+            }
+            break;
+        }
+        case 3: {
+            const uint invocations = QUADS * ROWS;
+            const uint stride = gl_NumWorkGroups.x * invocations;
+            for (uint i = gl_WorkGroupID.x * invocations + gl_LocalInvocationIndex; i < imageSize * QUADS; i += stride) {
+                const uint quad = i % QUADS;
+                vec4 x = fma(vec4(image[i]), stats[QUADS + quad], stats[quad]);
+                if (RELU) {
+                    x = max(x, vec4(0.0));
+                }
+                if (RESIDUAL) {
+                    residual[i] = TENSOR_VEC4(vec4(residual[i]) + x);
+                } else {
+                    image[i] = TENSOR_VEC4(x);
+                }
+            }
+            break;
         }
-        deviation = weights[c] / (sqrt(deviation / imageSize) + 0.00001);
-        stats[c] = - mean * deviation + weights[CHANNELS + c];
-        stats[CHANNELS + c] = deviation;
-        break;
-        case 1:
-        return;
-        uint pos = gl_GlobalInvocationID.x * (HEIGHT / SPATIAL_DIVISOR) * CHANNELS
-        + gl_LocalInvocationID.y * CHANNELS
-        + c;
-        float x = image[pos];
-        image[pos] = min(fma(x, stats[CHANNELS + c], stats[c]), 0.0);
-        break;
     }
 }
@@ -0,0 +1,91 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+#include "consts.comp.glsl"
+//Depthwise 3 × 3 convolution with reflect padding and bias, followed by pointwise 1 × 1 without bias.
+//Both run in one pass, depthwise results never leave registers.
+layout(constant_id = 2) const uint SPATIAL_DIVISOR = 4;
+layout(local_size_x = 8, local_size_y = 8) in;
+
+const uint CHANNELS = 64;
+const uint QUADS = CHANNELS / 4;
+//Channel quads loaded into shared memory at once.
+const uint CHUNK_QUADS = 4;
+const int TILE_X = int(gl_WorkGroupSize.x) + 2;
+const int TILE_Y = int(gl_WorkGroupSize.y) + 2;
+const uint INVOCATIONS = gl_WorkGroupSize.x * gl_WorkGroupSize.y;
+const int TENSOR_WIDTH = WIDTH / int(SPATIAL_DIVISOR);
+const int TENSOR_HEIGHT = HEIGHT / int(SPATIAL_DIVISOR);
+const uint imageSize = TENSOR_WIDTH * TENSOR_HEIGHT;
+
+layout(std430, set = 0, binding = 0) uniform restrict readonly Depthwise {
+    //Kernel index is kx × 3 + ky.
+    vec4 depthwise[3 * 3][QUADS];
+    vec4 depthwiseBias[QUADS];
+};
+layout(std430, set = 0, binding = 1) uniform restrict readonly Pointwise {
+    //[output channel][input quad].
+    vec4 pointwise[CHANNELS][QUADS];
+};
+layout(std430, set = 1, binding = 0) buffer restrict readonly InTensor {
+    TENSOR_VEC4 inTensor[imageSize * QUADS];
+};
+layout(std430, set = 1, binding = 1) buffer restrict writeonly OutTensor {
+    TENSOR_VEC4 outTensor[imageSize * QUADS];
+};
+
+shared vec4 tile[TILE_X][TILE_Y][CHUNK_QUADS];
+
+//Same as padding_mode='reflect': the edge pixel isn't repeated.
+int reflectIndex(const in int i, const in int size) {
+    if (i < 0) return -i;
+    if (i >= size) return 2 * size - 2 - i;
+    return i;
+}
+
+void main() {
+    const uint li = gl_LocalInvocationIndex;
+    const ivec2 origin = ivec2(gl_WorkGroupID.xy * gl_WorkGroupSize.xy) - 1;
+    const ivec2 local = ivec2(gl_LocalInvocationID.xy);
+    const ivec2 pos = ivec2(gl_GlobalInvocationID.xy);
+    //Invocations outside of the tensor still take part in barriers.
+    const bool inside = pos.x < TENSOR_WIDTH && pos.y < TENSOR_HEIGHT;
+
+    vec4 dw[QUADS];
+    for (uint chunk = 0; chunk < QUADS; chunk += CHUNK_QUADS) {
+        for (uint i = li; i < TILE_X * TILE_Y * CHUNK_QUADS; i += INVOCATIONS) {
+            const uint q = i % CHUNK_QUADS;
+            const int tx = int(i / CHUNK_QUADS) / TILE_Y;
+            const int ty = int(i / CHUNK_QUADS) % TILE_Y;
+            const int x = reflectIndex(origin.x + tx, TENSOR_WIDTH);
+            const int y = reflectIndex(origin.y + ty, TENSOR_HEIGHT);
+            tile[tx][ty][q] = vec4(inTensor[(x * TENSOR_HEIGHT + y) * QUADS + chunk + q]);
+        }
+        barrier();
+        if (inside) {
+            for (uint q = 0; q < CHUNK_QUADS; q++) {
+                vec4 acc = depthwiseBias[chunk + q];
+                for (int kx = 0; kx < 3; kx++) {
+                    for (int ky = 0; ky < 3; ky++) {
+                        acc = fma(tile[local.x + kx][local.y + ky][q], depthwise[kx * 3 + ky][chunk + q], acc);
+                    }
+                }
+                dw[chunk + q] = acc;
+            }
+        }
+        barrier();
+    }
+    if (!inside) return;
+
+    const uint outPos = (pos.x * TENSOR_HEIGHT + pos.y) * QUADS;
+    for (uint o = 0; o < QUADS; o++) {
+        vec4 res = vec4(0.0);
+        for (uint c = 0; c < 4; c++) {
+            float sum = 0.0;
+            for (uint q = 0; q < QUADS; q++) {
+                sum += dot(pointwise[o * 4 + c][q], dw[q]);
+            }
+            res[c] = sum;
+        }
+        outTensor[outPos + o] = TENSOR_VEC4(res);
+    }
+}
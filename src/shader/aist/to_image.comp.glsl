@@ -6,7 +6,7 @@ layout(local_size_x = 16, local_size_y = 16) in;
 const uint IN_CHANNELS = 3;
 layout(set = 0, binding = 0, rgba8) uniform restrict writeonly image2D outImage;
 layout(set = 0, binding = 1, std430) buffer restrict readonly InTensor {
-    float inTensor[WIDTH * HEIGHT][IN_CHANNELS];
+    TENSOR_T inTensor[WIDTH * HEIGHT][IN_CHANNELS];
 };
 
 float activate(in float res) {
@@ -17,6 +17,10 @@ void main() {
     const int sx = int(gl_GlobalInvocationID.x);
     const int sy = int(gl_GlobalInvocationID.y);
     if (sx >= WIDTH || sy >= HEIGHT) return;
-    float res[IN_CHANNELS] = inTensor[sx * HEIGHT + sy];
-    imageStore(outImage, ivec2(sx, sy), vec4(activate(res[0]), activate(res[1]), activate(res[2]), 1.0));
+    const uint pos = sx * HEIGHT + sy;
+    imageStore(
+            outImage,
+            ivec2(sx, sy),
+            vec4(activate(float(inTensor[pos][0])), activate(float(inTensor[pos][1])), activate(float(inTensor[pos][2])), 1.0)
+    );
 }
@@ -1,11 +1,10 @@
 #version 450
 #extension GL_GOOGLE_include_directive : require
 #include "consts.comp.glsl"
-layout(local_size_x = 4, local_size_y = 4) in;
+//Transposed convolution with stride 2, padding 1 and output padding 1.
+//Every invocation gathers one output pixel from the input pixels contributing to it.
+layout(local_size_x = 8, local_size_y = 8) in;
 
-layout(push_constant) uniform PushConsts {
-    uint substage;
-};
 const uint IN_CHANNELS = 32;
 const uint OUT_CHANNELS = 3;
 layout(std430, set = 0, binding = 0) uniform restrict readonly Convs {
@@ -13,56 +12,40 @@ layout(std430, set = 0, binding = 0) uniform restrict readonly Convs {
     float biases[OUT_CHANNELS];
 };
 layout(std430, set = 1, binding = 0) buffer restrict readonly InTensor {
-    float inTensor[(WIDTH / 2) * (HEIGHT / 2)][IN_CHANNELS];
+    TENSOR_T inTensor[(WIDTH / 2) * (HEIGHT / 2)][IN_CHANNELS];
 };
 //Can't have two SpecConstant-sized fields in one struct, because their offsets are calculated for just one element
-layout(std430, set = 1, binding = 1) buffer restrict OutTensor {
-    float outTensor[WIDTH * HEIGHT][OUT_CHANNELS];
+layout(std430, set = 1, binding = 1) buffer restrict writeonly OutTensor {
+    TENSOR_T outTensor[WIDTH * HEIGHT][OUT_CHANNELS];
 };
 
-void calcPixel(const in uint inPos, const in int dx, const in int dy, const in bool add) {
-    const int cx = int(gl_GlobalInvocationID.x) * 2 + dx;
-    const int cy = int(gl_GlobalInvocationID.y) * 2 + dy;
-    if (cx >= WIDTH || cy >= HEIGHT) return;
-    if (cx < 0 || cy < 0) return;
-    const int outPos = cx * HEIGHT + cy;
-    float[OUT_CHANNELS] buf;
-    if (add) {
-        buf = outTensor[outPos];
-    } else {
-        buf = biases;
-    }
-    const int convIndex = (dx + 1) * 3 + dy + 1;
+void accumulate(inout vec3 buf, const in int sx, const in int sy, const in uint convIndex) {
+    if (sx < 0 || sy < 0 || sx >= WIDTH / 2 || sy >= HEIGHT / 2) return;
+    const uint inPos = uint(sx) * HEIGHT / 2 + uint(sy);
     for (uint ic = 0; ic < IN_CHANNELS; ic++) {
-        for (uint oc = 0; oc < OUT_CHANNELS; oc++) {
-            buf[oc] = fma(inTensor[inPos][ic], convs[ic][oc][convIndex], buf[oc]);
-        }
+        buf = fma(
+                vec3(float(inTensor[inPos][ic])),
+                vec3(convs[ic][0][convIndex], convs[ic][1][convIndex], convs[ic][2][convIndex]),
+                buf
+        );
     }
-    outTensor[outPos] = buf;
 }
 
 void main() {
-    const uint sx = gl_GlobalInvocationID.x;
-    const uint sy = gl_GlobalInvocationID.y;
-    if (sx >= WIDTH / 2 || sy >= HEIGHT / 2) return;
-    const uint inPos = sx * HEIGHT / 2 + sy;
-    switch (substage) {
-        case 0:
-        calcPixel(inPos, 0, 0, false);
-        calcPixel(inPos, 0, 1, false);
-        calcPixel(inPos, 1, 1, false);
-        calcPixel(inPos, 1, 0, false);
-        break;
-        case 1:
-        calcPixel(inPos, 1, -1, true);
-        calcPixel(inPos, 0, -1, true);
-        break;
-        case 2:
-        calcPixel(inPos, -1, -1, true);
-        break;
-        case 3:
-        calcPixel(inPos, -1, 0, true);
-        calcPixel(inPos, -1, 1, true);
-        break;
+    const int cx = int(gl_GlobalInvocationID.x);
+    const int cy = int(gl_GlobalInvocationID.y);
+    if (cx >= WIDTH || cy >= HEIGHT) return;
+    vec3 buf = vec3(biases[0], biases[1], biases[2]);
+    //Input pixel s feeds outputs 2 × s + d for d in [-1, 1], so only the matching parity contributes.
+    for (int dx = -1; dx <= 1; dx++) {
+        if (((cx - dx) & 1) != 0) continue;
+        for (int dy = -1; dy <= 1; dy++) {
+            if (((cy - dy) & 1) != 0) continue;
+            accumulate(buf, (cx - dx) / 2, (cy - dy) / 2, (dx + 1) * 3 + dy + 1);
+        }
+    }
+    const uint outPos = cx * HEIGHT + cy;
+    for (uint oc = 0; oc < OUT_CHANNELS; oc++) {
+        outTensor[outPos][oc] = TENSOR_T(buf[oc]);
     }
 }
@@ -0,0 +1,553 @@
+#include "texture_loader.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "format.hpp"
+#include "logger.hpp"
+#include "util.hpp"
+
+#include "stb_image.h"
+#include "stb_image_dds.h"
+#include "stb_image_resize.h"
+
+namespace vkBasalt
+{
+    namespace
+    {
+        class WorkerPool
+        {
+        public:
+            static WorkerPool& get()
+            {
+                static WorkerPool workerPool;
+                return workerPool;
+            }
+
+            void run(std::function<void()> job)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    jobs.push_back(std::move(job));
+                    // Threads only get started once there is something to do, most configs have no textures.
+                    if (threads.size() < maxThreads && threads.size() < jobs.size() + busyThreads)
+                    {
+                        threads.emplace_back([this]() { work(); });
+                    }
+                }
+                jobAdded.notify_one();
+            }
+
+            ~WorkerPool()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    stop = true;
+                }
+                jobAdded.notify_all();
+                for (auto& thread : threads)
+                {
+                    thread.join();
+                }
+            }
+
+        private:
+            const size_t                      maxThreads = std::clamp(std::thread::hardware_concurrency(), 1u, 8u);
+            std::mutex                        mutex;
+            std::condition_variable           jobAdded;
+            std::deque<std::function<void()>> jobs;
+            std::vector<std::thread>          threads;
+            size_t                            busyThreads = 0;
+            bool                              stop        = false;
+
+            void work()
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                while (true)
+                {
+                    jobAdded.wait(lock, [this]() { return stop || !jobs.empty(); });
+                    if (stop)
+                    {
+                        return;
+                    }
+                    std::function<void()> job = std::move(jobs.front());
+                    jobs.pop_front();
+                    busyThreads++;
+                    lock.unlock();
+                    job();
+                    lock.lock();
+                    busyThreads--;
+                }
+            }
+        };
+
+        // Loads that haven't finished yet by what they load, so that effects asking for the same texture at once share one
+        // decode instead of both decoding it and writing the same cache file. Removed once finished, later loads map the cache.
+        std::mutex                                                          runningLoadsMutex;
+        std::unordered_map<std::string, std::shared_future<DecodedTexture>> runningLoads;
+
+        // Bump when the layout of the cache files or anything about decoding changes.
+        constexpr uint32_t cacheVersion = 2;
+        constexpr char     cacheMagic[] = "vkBasaltTEX";
+
+        // Start of the cache files, followed by the path of the source file and at pixelOffset by the pixels, in the same
+        // layout as DecodedTexture. width, height and levels are the ones the texture got requested with, the stored ones
+        // those of the pixels.
+        struct CacheHeader
+        {
+            char     magic[sizeof(cacheMagic)];
+            uint32_t version;
+            uint64_t sourceSize;
+            int64_t  sourceModified;
+            uint32_t format;
+            uint32_t width;
+            uint32_t height;
+            uint32_t levels;
+            uint32_t storedWidth;
+            uint32_t storedHeight;
+            uint32_t storedLevels;
+            uint32_t pathSize;
+            uint64_t pixelOffset;
+            uint64_t pixelSize;
+        };
+
+        constexpr uint32_t fourCC(const char (&code)[5])
+        {
+            return uint32_t(uint8_t(code[0])) | uint32_t(uint8_t(code[1])) << 8 | uint32_t(uint8_t(code[2])) << 16
+                   | uint32_t(uint8_t(code[3])) << 24;
+        }
+
+        uint32_t readUint32(const uint8_t* data)
+        {
+            uint32_t value;
+            std::memcpy(&value, data, sizeof(value));
+            return value;
+        }
+
+        // The BCn format of the blocks in a DDS file, VK_FORMAT_UNDEFINED if it isn't one of the formats that can stand in
+        // for format. header holds the magic number, DDS_HEADER and DDS_HEADER_DXT10, dataOffset is where the blocks start.
+        VkFormat ddsBlockFormat(const uint8_t* header, VkFormat format, size_t& dataOffset)
+        {
+            constexpr uint32_t ddsPixelFormatFourCC = 0x4;
+            constexpr uint32_t ddsCaps2CubeOrVolume = 0x200 | 0x200000;
+            constexpr uint32_t dxgiCubeFlag         = 0x4;
+            constexpr uint32_t dxgiTexture2D        = 3;
+
+            if (readUint32(header) != fourCC("DDS ") || readUint32(header + 4) != 124 || (readUint32(header + 112) & ddsCaps2CubeOrVolume)
+                || !(readUint32(header + 80) & ddsPixelFormatFourCC))
+            {
+                return VK_FORMAT_UNDEFINED;
+            }
+
+            VkFormat blockFormat;
+            dataOffset = 128;
+            switch (readUint32(header + 84))
+            {
+                case fourCC("DXT1"): blockFormat = VK_FORMAT_BC1_RGBA_UNORM_BLOCK; break;
+                case fourCC("DXT5"): blockFormat = VK_FORMAT_BC3_UNORM_BLOCK; break;
+                case fourCC("ATI1"):
+                case fourCC("BC4U"): blockFormat = VK_FORMAT_BC4_UNORM_BLOCK; break;
+                case fourCC("ATI2"):
+                case fourCC("BC5U"): blockFormat = VK_FORMAT_BC5_UNORM_BLOCK; break;
+                case fourCC("DX10"):
+                    dataOffset = 148;
+                    if (readUint32(header + 132) != dxgiTexture2D || (readUint32(header + 136) & dxgiCubeFlag) || readUint32(header + 140) > 1)
+                    {
+                        return VK_FORMAT_UNDEFINED;
+                    }
+                    // The sRGB variants hold the same blocks, the sampler of the effect decides how they get read.
+                    switch (readUint32(header + 128))
+                    {
+                        case 71: // DXGI_FORMAT_BC1_UNORM
+                        case 72: blockFormat = VK_FORMAT_BC1_RGBA_UNORM_BLOCK; break;
+                        case 77: // DXGI_FORMAT_BC3_UNORM
+                        case 78: blockFormat = VK_FORMAT_BC3_UNORM_BLOCK; break;
+                        case 80: blockFormat = VK_FORMAT_BC4_UNORM_BLOCK; break;
+                        case 83: blockFormat = VK_FORMAT_BC5_UNORM_BLOCK; break;
+                        case 98: // DXGI_FORMAT_BC7_UNORM
+                        case 99: blockFormat = VK_FORMAT_BC7_UNORM_BLOCK; break;
+                        default: return VK_FORMAT_UNDEFINED;
+                    }
+                    break;
+                default: return VK_FORMAT_UNDEFINED;
+            }
+
+            switch (format)
+            {
+                case VK_FORMAT_R8_UNORM: return blockFormat == VK_FORMAT_BC4_UNORM_BLOCK ? blockFormat : VK_FORMAT_UNDEFINED;
+                case VK_FORMAT_R8G8_UNORM: return blockFormat == VK_FORMAT_BC5_UNORM_BLOCK ? blockFormat : VK_FORMAT_UNDEFINED;
+                case VK_FORMAT_R8G8B8A8_UNORM:
+                    return blockFormat == VK_FORMAT_BC4_UNORM_BLOCK || blockFormat == VK_FORMAT_BC5_UNORM_BLOCK ? VK_FORMAT_UNDEFINED
+                                                                                                                  : blockFormat;
+                default: return VK_FORMAT_UNDEFINED;
+            }
+        }
+
+        uint32_t texelSize(VkFormat format)
+        {
+            switch (format)
+            {
+                case VK_FORMAT_R8_UNORM: return 1;
+                case VK_FORMAT_R8G8_UNORM: return 2;
+                default: return 4;
+            }
+        }
+
+        VkExtent3D levelExtent(VkExtent3D extent, uint32_t level)
+        {
+            return {std::max(extent.width >> level, 1u), std::max(extent.height >> level, 1u), 1};
+        }
+
+        size_t mipChainSize(VkExtent3D extent, VkFormat format, uint32_t levels)
+        {
+            uint32_t blockSize = getBlockSize(format);
+            size_t   size      = 0;
+            for (uint32_t i = 0; i < levels; i++)
+            {
+                VkExtent3D mipExtent = levelExtent(extent, i);
+                if (blockSize)
+                {
+                    size += size_t((mipExtent.width + 3) / 4) * ((mipExtent.height + 3) / 4) * blockSize;
+                }
+                else
+                {
+                    size += size_t(mipExtent.width) * mipExtent.height * texelSize(format);
+                }
+            }
+            return size;
+        }
+
+        // Maps the blocks of a BCn compressed DDS file, if they fit what the texture got declared as.
+        bool mapCompressedTexture(const std::string& filePath, VkExtent3D extent, VkFormat format, uint32_t levels, DecodedTexture& texture)
+        {
+            constexpr uint32_t ddsFlagMipMapCount = 0x20000;
+
+            int fd = open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+            {
+                return false;
+            }
+            uint8_t     header[148] = {};
+            struct stat fileStat;
+            size_t      dataOffset  = 0;
+            VkFormat    blockFormat = VK_FORMAT_UNDEFINED;
+            if (fstat(fd, &fileStat) == 0 && pread(fd, header, sizeof(header), 0) >= 128)
+            {
+                blockFormat = ddsBlockFormat(header, format, dataOffset);
+            }
+            uint32_t fileLevels = (readUint32(header + 8) & ddsFlagMipMapCount) ? std::max(readUint32(header + 28), 1u) : 1;
+            size_t   size       = mipChainSize(extent, blockFormat, levels);
+            // Blits can't write block compressed images, every level has to be in the file already.
+            if (blockFormat == VK_FORMAT_UNDEFINED || readUint32(header + 12) != extent.height || readUint32(header + 16) != extent.width
+                || fileLevels < levels || dataOffset + size > size_t(fileStat.st_size))
+            {
+                close(fd);
+                return false;
+            }
+            void* mapping = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+            close(fd);
+            if (mapping == MAP_FAILED)
+            {
+                return false;
+            }
+            size_t                         fileSize = fileStat.st_size;
+            std::shared_ptr<const uint8_t> file(static_cast<const uint8_t*>(mapping),
+                                                [fileSize](const uint8_t* pMapping) { munmap(const_cast<uint8_t*>(pMapping), fileSize); });
+            texture.pixels = std::shared_ptr<const uint8_t>(file, file.get() + dataOffset);
+            texture.size   = size;
+            texture.format = blockFormat;
+            texture.extent = extent;
+            texture.levels = levels;
+            return true;
+        }
+
+        bool describeSourceFile(const std::string& filePath, CacheHeader& header)
+        {
+            struct stat fileStat;
+            if (stat(filePath.c_str(), &fileStat) != 0)
+            {
+                return false;
+            }
+            header.sourceSize     = fileStat.st_size;
+            header.sourceModified = int64_t(fileStat.st_mtim.tv_sec) * 1000000000 + fileStat.st_mtim.tv_nsec;
+            return true;
+        }
+
+        std::string cacheFilePath(const std::string& filePath, VkExtent3D extent, VkFormat format, uint32_t levels)
+        {
+            std::string directory = cacheDirectory();
+            if (directory.empty())
+            {
+                return "";
+            }
+            directory += "/textures";
+            std::error_code error;
+            std::filesystem::create_directories(directory, error);
+            if (error)
+            {
+                return "";
+            }
+            // FNV-1a, the path and everything else in the key is stored in the header and compared as well.
+            std::string key = filePath + "|" + std::to_string(extent.width) + "x" + std::to_string(extent.height) + "|"
+                              + std::to_string(format) + "|" + std::to_string(levels);
+            uint64_t hash = 0xcbf29ce484222325ull;
+            for (char c : key)
+            {
+                hash = (hash ^ uint8_t(c)) * 0x100000001b3ull;
+            }
+            char name[32];
+            std::snprintf(name, sizeof(name), "%016llx.tex", (unsigned long long) hash);
+            return directory + "/" + name;
+        }
+
+        bool loadCachedTexture(const std::string& cachePath, const CacheHeader& expected, const std::string& filePath, DecodedTexture& texture)
+        {
+            int fd = open(cachePath.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+            {
+                return false;
+            }
+            struct stat fileStat;
+            void*       mapping = MAP_FAILED;
+            if (fstat(fd, &fileStat) == 0 && size_t(fileStat.st_size) >= sizeof(CacheHeader))
+            {
+                // Populated right away, so that the page faults happen on this thread and not while copying into the staging arena.
+                mapping = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+            }
+            close(fd);
+            if (mapping == MAP_FAILED)
+            {
+                return false;
+            }
+            size_t                         fileSize = fileStat.st_size;
+            std::shared_ptr<const uint8_t> file(static_cast<const uint8_t*>(mapping),
+                                                [fileSize](const uint8_t* pMapping) { munmap(const_cast<uint8_t*>(pMapping), fileSize); });
+
+            CacheHeader header;
+            std::memcpy(&header, file.get(), sizeof(header));
+            bool hit = std::memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) == 0 && header.version == cacheVersion
+                       && header.sourceSize == expected.sourceSize && header.sourceModified == expected.sourceModified
+                       && header.format == expected.format && header.width == expected.width && header.height == expected.height
+                       && header.levels == expected.levels && header.pathSize == filePath.size()
+                       && sizeof(header) + header.pathSize <= fileSize && header.pixelOffset <= fileSize
+                       && header.pixelSize <= fileSize - header.pixelOffset
+                       && std::memcmp(file.get() + sizeof(header), filePath.data(), filePath.size()) == 0;
+            // Only textures of the requested size come with their mip levels.
+            VkExtent3D storedExtent = {header.storedWidth, header.storedHeight, 1};
+            hit = hit && header.storedLevels == (header.storedWidth == header.width && header.storedHeight == header.height ? header.levels : 1)
+                  && header.pixelSize == mipChainSize(storedExtent, VkFormat(header.format), header.storedLevels);
+            if (!hit)
+            {
+                return false;
+            }
+            texture.pixels = std::shared_ptr<const uint8_t>(file, file.get() + header.pixelOffset);
+            texture.size   = header.pixelSize;
+            texture.extent = storedExtent;
+            texture.levels = header.storedLevels;
+            return true;
+        }
+
+        void saveCachedTexture(const std::string& cachePath, const CacheHeader& header, const std::string& filePath, const uint8_t* pixels)
+        {
+            std::vector<uint8_t> data(header.pixelOffset + header.pixelSize);
+            std::memcpy(data.data(), &header, sizeof(header));
+            std::memcpy(data.data() + sizeof(header), filePath.data(), filePath.size());
+            std::memcpy(data.data() + header.pixelOffset, pixels, header.pixelSize);
+            if (!writeFileAtomically(cachePath, data.data(), data.size()))
+            {
+                Logger::warn("can't write texture cache " + cachePath);
+            }
+        }
+
+        // Textures of the requested size get their smaller mip levels as well, the GPU resizes all others and generates
+        // their levels on the way.
+        bool decodeTexture(const std::string& filePath, VkExtent3D extent, VkFormat format, uint32_t levels, DecodedTexture& texture)
+        {
+            int desiredChannels;
+            switch (format)
+            {
+                case VK_FORMAT_R8_UNORM: desiredChannels = STBI_grey; break;
+                case VK_FORMAT_R8G8_UNORM:
+                    desiredChannels = STBI_rgb_alpha; // TODO why doesn't STBI_grey_alpha work?
+                    break;
+                case VK_FORMAT_R8G8B8A8_UNORM: desiredChannels = STBI_rgb_alpha; break;
+                default:
+                    Logger::err("unsupported texture upload format" + std::to_string(format));
+                    desiredChannels = 4;
+                    break;
+            }
+
+            FILE* const file = fopen(filePath.c_str(), "rb");
+            if (file == nullptr)
+            {
+                Logger::err("couldn't open texture: " + filePath);
+                return false;
+            }
+            stbi_uc* pixels;
+            int      width;
+            int      height;
+            int      channels;
+            if (stbi_dds_test_file(file))
+            {
+                pixels = stbi_dds_load_from_file(file, &width, &height, &channels, desiredChannels);
+            }
+            else
+            {
+                pixels = stbi_load_from_file(file, &width, &height, &channels, desiredChannels);
+            }
+            fclose(file);
+            if (pixels == nullptr)
+            {
+                Logger::err("couldn't decode texture: " + filePath);
+                return false;
+            }
+
+            // change RGBA to RG
+            uint32_t size = width * height * desiredChannels;
+            if (format == VK_FORMAT_R8G8_UNORM)
+            {
+                uint32_t pos = 0;
+                for (uint32_t j = 0; j < size; j += 4)
+                {
+                    pixels[pos] = pixels[j];
+                    pos++;
+                    pixels[pos] = pixels[j + 1];
+                    pos++;
+                }
+                size /= 2;
+                desiredChannels /= 2;
+            }
+
+            if (static_cast<uint32_t>(width) != extent.width || static_cast<uint32_t>(height) != extent.height)
+            {
+                extent = {static_cast<uint32_t>(width), static_cast<uint32_t>(height), 1};
+                levels = 1;
+            }
+            auto pixelsWithLevels = std::make_shared<std::vector<uint8_t>>(mipChainSize(extent, format, levels));
+            std::memcpy(pixelsWithLevels->data(), pixels, size);
+            stbi_image_free(pixels);
+
+            // The box filter halving each level gives the same result as the linear blits of generateMipMaps.
+            uint8_t* level = pixelsWithLevels->data();
+            for (uint32_t i = 1; i < levels; i++)
+            {
+                VkExtent3D sourceExtent = levelExtent(extent, i - 1);
+                VkExtent3D mipExtent    = levelExtent(extent, i);
+                uint8_t*   mip          = level + size_t(sourceExtent.width) * sourceExtent.height * desiredChannels;
+                stbir_resize_uint8_generic(level,
+                                           sourceExtent.width,
+                                           sourceExtent.height,
+                                           0,
+                                           mip,
+                                           mipExtent.width,
+                                           mipExtent.height,
+                                           0,
+                                           desiredChannels,
+                                           STBIR_ALPHA_CHANNEL_NONE,
+                                           0,
+                                           STBIR_EDGE_CLAMP,
+                                           STBIR_FILTER_BOX,
+                                           STBIR_COLORSPACE_LINEAR,
+                                           nullptr);
+                level = mip;
+            }
+
+            texture.pixels = std::shared_ptr<const uint8_t>(pixelsWithLevels, pixelsWithLevels->data());
+            texture.size   = pixelsWithLevels->size();
+            texture.extent = extent;
+            texture.levels = levels;
+            return true;
+        }
+
+        DecodedTexture
+        loadOrDecodeTexture(const std::string& filePath, VkExtent3D extent, VkFormat format, uint32_t levels, bool keepCompressed)
+        {
+            auto start = std::chrono::steady_clock::now();
+
+            DecodedTexture texture;
+            if (keepCompressed && mapCompressedTexture(filePath, extent, format, levels, texture))
+            {
+                Logger::debug("mapped compressed texture " + filePath + " as format " + std::to_string(texture.format));
+                return texture;
+            }
+            texture.format = format;
+
+            CacheHeader header = {};
+            std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+            header.version     = cacheVersion;
+            header.format      = format;
+            header.width       = extent.width;
+            header.height      = extent.height;
+            header.levels      = levels;
+            header.pathSize    = filePath.size();
+            header.pixelOffset = (sizeof(header) + filePath.size() + 15) / 16 * 16;
+
+            std::string cachePath = describeSourceFile(filePath, header) ? cacheFilePath(filePath, extent, format, levels) : "";
+            if (!cachePath.empty() && loadCachedTexture(cachePath, header, filePath, texture))
+            {
+                Logger::debug("loaded texture " + filePath + " from cache " + cachePath + " in "
+                              + std::to_string(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count())
+                              + " ms");
+                return texture;
+            }
+
+            if (!decodeTexture(filePath, extent, format, levels, texture))
+            {
+                return texture;
+            }
+            Logger::debug("decoded texture " + filePath + " in "
+                          + std::to_string(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count())
+                          + " ms");
+            if (!cachePath.empty())
+            {
+                header.storedWidth  = texture.extent.width;
+                header.storedHeight = texture.extent.height;
+                header.storedLevels = texture.levels;
+                header.pixelSize    = texture.size;
+                saveCachedTexture(cachePath, header, filePath, texture.pixels.get());
+            }
+            return texture;
+        }
+    } // namespace
+
+    std::shared_future<DecodedTexture>
+    loadTexture(const std::string& filePath, VkExtent3D extent, VkFormat format, uint32_t levels, bool keepCompressed)
+    {
+        levels          = std::max(levels, 1u);
+        std::string key = filePath + "|" + std::to_string(extent.width) + "x" + std::to_string(extent.height) + "|" + std::to_string(format)
+                          + "|" + std::to_string(levels) + "|" + std::to_string(keepCompressed);
+
+        std::lock_guard<std::mutex> lock(runningLoadsMutex);
+        auto                        running = runningLoads.find(key);
+        if (running != runningLoads.end())
+        {
+            return running->second;
+        }
+        auto task = std::make_shared<std::packaged_task<DecodedTexture()>>([filePath, extent, format, levels, keepCompressed]() {
+            return loadOrDecodeTexture(filePath, extent, format, levels, keepCompressed);
+        });
+        std::shared_future<DecodedTexture> texture = task->get_future().share();
+        runningLoads.emplace(key, texture);
+        WorkerPool::get().run([task, key]() {
+            (*task)();
+            std::lock_guard<std::mutex> lock(runningLoadsMutex);
+            runningLoads.erase(key);
+        });
+        return texture;
+    }
+} // namespace vkBasalt
@@ -0,0 +1,39 @@
+#ifndef TEXTURE_LOADER_HPP_INCLUDED
+#define TEXTURE_LOADER_HPP_INCLUDED
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "vulkan_include.hpp"
+
+namespace vkBasalt
+{
+    struct DecodedTexture
+    {
+        // Tightly packed rows of every mip level in format, the largest first. Points either into decoded pixels or into
+        // a mapped cache file, null if the file couldn't be loaded.
+        std::shared_ptr<const uint8_t> pixels;
+        size_t                         size = 0;
+        // The format the texture was asked for, or a BCn format if the blocks of a DDS file got kept as they are.
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        // Size of the first level. If it isn't the requested one, pixels holds just that level and it is up to the GPU to
+        // resize it and to generate the mip levels.
+        VkExtent3D extent = {};
+        uint32_t   levels = 0;
+    };
+
+    // Decodes a PNG or DDS file and, if it has the requested extent, generates the smaller mip levels on a pool of worker
+    // threads shared by all effects, so that an effect can start loading all of its textures at once and create its
+    // Vulkan objects meanwhile. The result is kept in $XDG_CACHE_HOME/vkBasalt/textures and gets mapped from there as
+    // long as size and modification time of the file stay the same.
+    // format has to be one of the 8 bit UNORM formats with one, two or four channels.
+    // With keepCompressed, DDS files with BC4, BC5 or for four channels BC1, BC3 or BC7 blocks, that match extent and
+    // have enough mip levels, get mapped as they are instead of decoded.
+    // Loads of the same file with the same parameters while one is still running share its result.
+    std::shared_future<DecodedTexture>
+    loadTexture(const std::string& filePath, VkExtent3D extent, VkFormat format, uint32_t levels, bool keepCompressed);
+} // namespace vkBasalt
+
+#endif // TEXTURE_LOADER_HPP_INCLUDED
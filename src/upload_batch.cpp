@@ -0,0 +1,205 @@
+#include "upload_batch.hpp"
+
+#include <algorithm>
+
+#include "buffer.hpp"
+#include "logger.hpp"
+
+namespace vkBasalt
+{
+    namespace
+    {
+        // Textures are mostly a few MiB, chunks this size share the blocks of the staging pool.
+        constexpr VkDeviceSize stagingChunkSize = 8 * 1024 * 1024;
+        // Enough for copies to images of any format, including block compressed ones.
+        constexpr VkDeviceSize stagingAlignment = 16;
+
+        thread_local UploadBatch* pCurrentBatch = nullptr;
+    } // namespace
+
+    UploadBatch::UploadBatch(LogicalDevice* pLogicalDevice) : pLogicalDevice(pLogicalDevice)
+    {
+    }
+
+    UploadBatch::~UploadBatch()
+    {
+        if (pCurrentBatch == this)
+        {
+            pCurrentBatch = nullptr;
+        }
+        if (fence != VK_NULL_HANDLE)
+        {
+            wait();
+            pLogicalDevice->vkd.DestroyFence(pLogicalDevice->device, fence, nullptr);
+            pLogicalDevice->vkd.DestroySemaphore(pLogicalDevice->device, semaphore, nullptr);
+        }
+        destroyStaging();
+    }
+
+    void UploadBatch::makeCurrent()
+    {
+        pCurrentBatch = this;
+    }
+
+    UploadBatch* UploadBatch::current(LogicalDevice* pLogicalDevice)
+    {
+        return pCurrentBatch && pCurrentBatch->pLogicalDevice == pLogicalDevice ? pCurrentBatch : nullptr;
+    }
+
+    VkCommandBuffer UploadBatch::commandBuffer()
+    {
+        if (recordingCommandBuffer != VK_NULL_HANDLE)
+        {
+            return recordingCommandBuffer;
+        }
+
+        // An own pool, so that recording doesn't need pLogicalDevice->queueLock.
+        VkCommandPoolCreateInfo poolInfo = {};
+        poolInfo.sType                   = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags                   = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        poolInfo.queueFamilyIndex        = pLogicalDevice->queueFamilyIndex;
+
+        VkResult result = pLogicalDevice->vkd.CreateCommandPool(pLogicalDevice->device, &poolInfo, nullptr, &commandPool);
+        ASSERT_VULKAN(result);
+
+        VkCommandBufferAllocateInfo allocInfo = {};
+        allocInfo.sType                       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level                       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool                 = commandPool;
+        allocInfo.commandBufferCount          = 1;
+
+        result = pLogicalDevice->vkd.AllocateCommandBuffers(pLogicalDevice->device, &allocInfo, &recordingCommandBuffer);
+        ASSERT_VULKAN(result);
+        // initialize dispatch table for commandBuffer since it is a dispatchable object
+        initializeDispatchTable(recordingCommandBuffer, pLogicalDevice->device);
+
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType                    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags                    = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        pLogicalDevice->vkd.BeginCommandBuffer(recordingCommandBuffer, &beginInfo);
+        return recordingCommandBuffer;
+    }
+
+    uint8_t* UploadBatch::stage(VkDeviceSize size, VkBuffer& buffer, VkDeviceSize& offset)
+    {
+        if (stagingChunks.empty() || stagingChunks.back().usedSize + size > stagingChunks.back().memory.size)
+        {
+            StagingChunk chunk;
+            createStagingBuffer(pLogicalDevice, std::max(size, stagingChunkSize), chunk.buffer, chunk.memory);
+            chunk.usedSize = 0;
+            stagingChunks.push_back(chunk);
+        }
+        StagingChunk& chunk = stagingChunks.back();
+        buffer              = chunk.buffer;
+        offset              = chunk.usedSize;
+        chunk.usedSize      = (chunk.usedSize + size + stagingAlignment - 1) / stagingAlignment * stagingAlignment;
+        return chunk.memory.mapped + offset;
+    }
+
+    void UploadBatch::destroyLater(VkImage image, const MemoryAllocation& memory)
+    {
+        transientImages.push_back({image, memory});
+    }
+
+    void UploadBatch::submit()
+    {
+        if (pCurrentBatch == this)
+        {
+            pCurrentBatch = nullptr;
+        }
+        if (empty())
+        {
+            return;
+        }
+        pLogicalDevice->vkd.EndCommandBuffer(recordingCommandBuffer);
+
+        VkFenceCreateInfo fenceInfo = {};
+        fenceInfo.sType             = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        VkResult result             = pLogicalDevice->vkd.CreateFence(pLogicalDevice->device, &fenceInfo, nullptr, &fence);
+        ASSERT_VULKAN(result);
+
+        VkSemaphoreCreateInfo semaphoreInfo = {};
+        semaphoreInfo.sType                 = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        result = pLogicalDevice->vkd.CreateSemaphore(pLogicalDevice->device, &semaphoreInfo, nullptr, &semaphore);
+        ASSERT_VULKAN(result);
+
+        VkSubmitInfo submitInfo         = {};
+        submitInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount   = 1;
+        submitInfo.pCommandBuffers      = &recordingCommandBuffer;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores    = &semaphore;
+
+        VkDeviceSize stagingSize = 0;
+        for (auto& chunk : stagingChunks)
+        {
+            stagingSize += chunk.usedSize;
+        }
+        Logger::debug("submitting uploads with " + std::to_string(stagingSize) + " bytes of staging");
+
+        std::lock_guard<std::mutex> lock(pLogicalDevice->queueLock);
+        result = pLogicalDevice->vkd.QueueSubmit(pLogicalDevice->queue, 1, &submitInfo, fence);
+        ASSERT_VULKAN(result);
+    }
+
+    bool UploadBatch::empty() const
+    {
+        return recordingCommandBuffer == VK_NULL_HANDLE;
+    }
+
+    VkSemaphore UploadBatch::takeSemaphore()
+    {
+        if (semaphoreTaken)
+        {
+            return VK_NULL_HANDLE;
+        }
+        semaphoreTaken = true;
+        return semaphore;
+    }
+
+    bool UploadBatch::releaseStaging()
+    {
+        if (commandPool == VK_NULL_HANDLE)
+        {
+            return true;
+        }
+        if (fence == VK_NULL_HANDLE || pLogicalDevice->vkd.GetFenceStatus(pLogicalDevice->device, fence) != VK_SUCCESS)
+        {
+            return false;
+        }
+        destroyStaging();
+        return true;
+    }
+
+    void UploadBatch::wait()
+    {
+        if (fence == VK_NULL_HANDLE)
+        {
+            return;
+        }
+        VkResult result = pLogicalDevice->vkd.WaitForFences(pLogicalDevice->device, 1, &fence, VK_TRUE, UINT64_MAX);
+        ASSERT_VULKAN(result);
+    }
+
+    void UploadBatch::destroyStaging()
+    {
+        if (commandPool != VK_NULL_HANDLE)
+        {
+            pLogicalDevice->vkd.DestroyCommandPool(pLogicalDevice->device, commandPool, nullptr);
+            commandPool = VK_NULL_HANDLE;
+        }
+        for (auto& chunk : stagingChunks)
+        {
+            pLogicalDevice->vkd.DestroyBuffer(pLogicalDevice->device, chunk.buffer, nullptr);
+            freeMemory(pLogicalDevice, chunk.memory);
+        }
+        stagingChunks.clear();
+        for (auto& transientImage : transientImages)
+        {
+            pLogicalDevice->vkd.DestroyImage(pLogicalDevice->device, transientImage.image, nullptr);
+            freeMemory(pLogicalDevice, transientImage.memory);
+        }
+        transientImages.clear();
+    }
+} // namespace vkBasalt
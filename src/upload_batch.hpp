@@ -0,0 +1,89 @@
+#ifndef UPLOAD_BATCH_HPP_INCLUDED
+#define UPLOAD_BATCH_HPP_INCLUDED
+#include <memory>
+#include <vector>
+
+#include "vulkan_include.hpp"
+
+#include "logical_device.hpp"
+#include "memory.hpp"
+
+namespace vkBasalt
+{
+    // Collects the uploads of textures, LUTs and weights while effects get created, into one staging arena and one
+    // command buffer that get submitted together, instead of one submit and QueueWaitIdle per upload. Whoever uses the
+    // uploaded resources first waits for the semaphore of the batch on the GPU.
+    class UploadBatch
+    {
+    public:
+        UploadBatch(LogicalDevice* pLogicalDevice);
+        // Waits for the GPU if the batch got submitted.
+        ~UploadBatch();
+
+        // uploadToImage, changeImageLayout and uploadToBuffer record into this batch when called from this thread,
+        // until it gets submitted or destroyed.
+        void makeCurrent();
+        // The batch of the calling thread, nullptr if uploads should be submitted right away.
+        static UploadBatch* current(LogicalDevice* pLogicalDevice);
+
+        // Begins the command buffer on the first call.
+        VkCommandBuffer commandBuffer();
+        // Host visible space for size bytes, to be copied from buffer at offset.
+        uint8_t* stage(VkDeviceSize size, VkBuffer& buffer, VkDeviceSize& offset);
+        // For images that are only needed by the recorded commands, they get destroyed together with the staging arena.
+        void destroyLater(VkImage image, const MemoryAllocation& memory);
+
+        // Takes pLogicalDevice->queueLock. Does nothing if nothing got recorded.
+        void submit();
+        bool empty() const;
+        // The semaphore the first submission using the uploaded resources has to wait for, VK_NULL_HANDLE after the
+        // first call. Submissions after that one are ordered after the uploads by the wait.
+        VkSemaphore takeSemaphore();
+        // Frees the staging arena if the GPU is done with it, returns true once that happened.
+        bool releaseStaging();
+        void wait();
+
+    private:
+        struct StagingChunk
+        {
+            VkBuffer         buffer;
+            MemoryAllocation memory;
+            VkDeviceSize     usedSize;
+        };
+
+        struct TransientImage
+        {
+            VkImage          image;
+            MemoryAllocation memory;
+        };
+
+        LogicalDevice*              pLogicalDevice;
+        VkCommandPool               commandPool = VK_NULL_HANDLE;
+        VkCommandBuffer             recordingCommandBuffer = VK_NULL_HANDLE;
+        std::vector<StagingChunk>   stagingChunks;
+        std::vector<TransientImage> transientImages;
+        VkFence                     fence     = VK_NULL_HANDLE;
+        VkSemaphore                 semaphore = VK_NULL_HANDLE;
+        bool                        semaphoreTaken = false;
+
+        void destroyStaging();
+    };
+
+    // Records into the batch of the calling thread, or submits right away and waits for the GPU without one.
+    template<typename Record>
+    void recordUpload(LogicalDevice* pLogicalDevice, Record record)
+    {
+        UploadBatch* pBatch = UploadBatch::current(pLogicalDevice);
+        if (pBatch)
+        {
+            record(*pBatch);
+            return;
+        }
+        UploadBatch batch(pLogicalDevice);
+        record(batch);
+        batch.submit();
+        batch.wait();
+    }
+} // namespace vkBasalt
+
+#endif // UPLOAD_BATCH_HPP_INCLUDED
@@ -1,5 +1,9 @@
 #include "util.hpp"
 
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
 #include <iostream>
 #include <unistd.h>
 
@@ -63,4 +67,62 @@ namespace vkBasalt
             std::cout << "\033[" << magicString << "m" << output << "\033[0m" << std::endl;
         }
     }
+
+    std::string cacheDirectory()
+    {
+        const char* cacheHomeEnv = std::getenv("XDG_CACHE_HOME");
+        const char* homeEnv      = std::getenv("HOME");
+        std::string directory;
+        if (cacheHomeEnv && *cacheHomeEnv)
+        {
+            directory = std::string(cacheHomeEnv) + "/vkBasalt";
+        }
+        else if (homeEnv && *homeEnv)
+        {
+            directory = std::string(homeEnv) + "/.cache/vkBasalt";
+        }
+        else
+        {
+            return "";
+        }
+
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        return error ? "" : directory;
+    }
+
+    bool writeFileAtomically(const std::string& path, const void* data, size_t size)
+    {
+        // mkstemp picks a name no other thread or process uses, several games and effect threads may write the same file at once.
+        std::string temporaryPath = path + ".XXXXXX";
+        int         fd            = mkstemp(temporaryPath.data());
+        if (fd == -1)
+        {
+            return false;
+        }
+
+        const char* bytes = static_cast<const char*>(data);
+        while (size > 0)
+        {
+            ssize_t written = write(fd, bytes, size);
+            if (written == -1 && errno == EINTR)
+            {
+                continue;
+            }
+            if (written <= 0)
+            {
+                close(fd);
+                std::remove(temporaryPath.c_str());
+                return false;
+            }
+            bytes += written;
+            size -= written;
+        }
+        if (close(fd) != 0 || std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+        {
+            std::remove(temporaryPath.c_str());
+            return false;
+        }
+        return true;
+    }
 } // namespace vkBasalt
@@ -25,6 +25,13 @@ namespace vkBasalt
 
     void outputInColor(std::string output, Color foreground = Color::defaultColor, Color background = Color::defaultColor);
 
+    // $XDG_CACHE_HOME/vkBasalt or ~/.cache/vkBasalt, created if it doesn't exist yet. Empty if it can't be created.
+    std::string cacheDirectory();
+
+    // Writes a uniquely named temporary file next to path and renames it, so that other threads and processes never read a
+    // partial file. Concurrent writers of the same path each leave a complete file, the last rename wins.
+    bool writeFileAtomically(const std::string& path, const void* data, size_t size);
+
     template<typename T>
     std::string convertToString(T object)
     {